@@ -0,0 +1,145 @@
+#include "actionmacro.h"
+
+#include <QKeySequence>
+
+namespace {
+
+// Windows 虚拟键码, 其他平台不发送按键, 只用于解析
+const quint8 VkShift = 0x10;
+const quint8 VkControl = 0x11;
+const quint8 VkMenu = 0x12;
+const quint8 VkLeftWin = 0x5B;
+
+quint8 virtualKey(int key)
+{
+    if ((key >= Qt::Key_A && key <= Qt::Key_Z) || (key >= Qt::Key_0 && key <= Qt::Key_9))
+        return quint8(key);
+    if (key >= Qt::Key_F1 && key <= Qt::Key_F24)
+        return quint8(0x70 + (key - Qt::Key_F1));
+    switch (key) {
+    case Qt::Key_Backspace: return 0x08;
+    case Qt::Key_Tab: return 0x09;
+    case Qt::Key_Return:
+    case Qt::Key_Enter: return 0x0D;
+    case Qt::Key_Escape: return 0x1B;
+    case Qt::Key_Space: return 0x20;
+    case Qt::Key_PageUp: return 0x21;
+    case Qt::Key_PageDown: return 0x22;
+    case Qt::Key_End: return 0x23;
+    case Qt::Key_Home: return 0x24;
+    case Qt::Key_Left: return 0x25;
+    case Qt::Key_Up: return 0x26;
+    case Qt::Key_Right: return 0x27;
+    case Qt::Key_Down: return 0x28;
+    case Qt::Key_Insert: return 0x2D;
+    case Qt::Key_Delete: return 0x2E;
+    default: return 0;
+    }
+}
+
+ActionMacro::Step step(ActionMacro::Kind kind, int ms = 0)
+{
+    ActionMacro::Step step;
+    step.kind = kind;
+    step.ms = ms;
+    return step;
+}
+
+ActionMacro::Step inject(const QString &chord)
+{
+    ActionMacro::Step step;
+    step.kind = ActionMacro::Inject;
+    step.text = chord;
+    ActionMacro::parseChord(chord, step.modifiers, step.key);
+    return step;
+}
+
+} // namespace
+
+bool ActionMacro::parseChord(const QString &text, QVector<quint8> &modifiers, quint8 &key)
+{
+    const QKeySequence sequence = QKeySequence::fromString(text, QKeySequence::PortableText);
+    if (sequence.count() != 1)
+        return false;
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const int combined = sequence[0].toCombined();
+#else
+    const int combined = sequence[0];
+#endif
+    modifiers.clear();
+    if (combined & Qt::ControlModifier)
+        modifiers.append(VkControl);
+    if (combined & Qt::ShiftModifier)
+        modifiers.append(VkShift);
+    if (combined & Qt::AltModifier)
+        modifiers.append(VkMenu);
+    if (combined & Qt::MetaModifier)
+        modifiers.append(VkLeftWin);
+    key = virtualKey(combined & ~int(Qt::KeyboardModifierMask));
+    return key != 0;
+}
+
+bool ActionMacro::parse(const QJsonArray &config, ActionMacro &macro, QString *error)
+{
+    macro.steps.clear();
+    for (int i = 0; i < config.size(); ++i) {
+        const QString text = config.at(i).toString().trimmed();
+        const int space = text.indexOf(' ');
+        const QString name = space < 0 ? text : text.left(space);
+        const QString argument = space < 0 ? QString() : text.mid(space + 1).trimmed();
+        bool ok = true;
+        const int ms = argument.isEmpty() ? -1 : argument.toInt(&ok);
+
+        Step step;
+        if (name == "clipboard" && argument.isEmpty()) {
+            step.kind = Clipboard;
+        } else if (name == "ready" && ok) {
+            step.kind = Ready;
+            step.ms = ms < 0 ? DefaultReadyTimeoutMs : ms;
+        } else if (name == "delay" && ok && ms >= 0) {
+            step.kind = Delay;
+            step.ms = ms;
+        } else if (name == "release" && ok) {
+            step.kind = Release;
+            step.ms = ms < 0 ? DefaultReleaseTimeoutMs : ms;
+        } else if (name == "inject" && parseChord(argument, step.modifiers, step.key)) {
+            step.kind = Inject;
+            step.text = argument;
+        } else {
+            if (error)
+                *error = QString("第 %1 步无效: %2").arg(i + 1).arg(text);
+            return false;
+        }
+        macro.steps.append(step);
+    }
+    return true;
+}
+
+ActionMacro ActionMacro::paste(int keyIntervalMs)
+{
+    ActionMacro macro = copy();
+    macro.steps.append(step(Release, DefaultReleaseTimeoutMs));
+    macro.steps.append(inject(QStringLiteral("Ctrl+V")));
+    macro.steps.append(step(Delay, keyIntervalMs));
+    macro.steps.append(inject(QStringLiteral("Ctrl+A")));
+    macro.steps.append(step(Delay, keyIntervalMs));
+    macro.steps.append(inject(QStringLiteral("Ctrl+C")));
+    return macro;
+}
+
+bool ActionMacro::writesClipboard(const Step &step)
+{
+    if (step.kind != Inject || step.modifiers.size() != 1)
+        return false;
+    if (step.modifiers.first() == VkControl)
+        return step.key == 'C' || step.key == 'X' || step.key == 0x2D;
+    return step.modifiers.first() == VkShift && step.key == 0x2E;
+}
+
+ActionMacro ActionMacro::copy()
+{
+    ActionMacro macro;
+    macro.steps.append(step(Clipboard));
+    macro.steps.append(step(Ready, DefaultReadyTimeoutMs));
+    return macro;
+}
@@ -0,0 +1,106 @@
+#ifndef ACTIONMACRO_H
+#define ACTIONMACRO_H
+
+#include <QJsonArray>
+#include <QString>
+#include <QVector>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+/**
+ * 动作宏: 生成时间戳后在 GUI 事件循环中依次执行的步骤
+ *
+ * 配置为字符串数组, 每个字符串一步:
+ *   "clipboard"          把时间戳写入剪贴板
+ *   "ready [超时 ms]"    等剪贴板确认(读回一致); 超时后读回仍不一致则结束宏, 不粘贴旧内容
+ *   "delay <ms>"         等待
+ *   "inject <组合键>"    发送组合键, 如 "inject Ctrl+V"(QKeySequence 的 PortableText)
+ *   "release [超时 ms]"  等物理修饰键与触发的热键全部松开; 超时仍未松开则结束宏,
+ *                        不再发送按键(否则会与按住的键组合), 剪贴板中已是新内容
+ * 例: ["clipboard", "ready", "release", "inject Ctrl+V", "delay 125", "inject Ctrl+A"]
+ */
+class ActionMacro
+{
+public:
+    enum Kind {
+        Clipboard,
+        Ready,
+        Delay,
+        Inject,
+        Release
+    };
+
+    struct Step {
+        Kind kind = Delay;
+        int ms = 0;
+        // Windows 虚拟键码
+        QVector<quint8> modifiers;
+        quint8 key = 0;
+        QString text;
+    };
+
+    static constexpr int DefaultReadyTimeoutMs = 500;
+    static constexpr int DefaultReleaseTimeoutMs = 400;
+
+    QVector<Step> steps;
+
+    static bool parse(const QJsonArray &config, ActionMacro &macro, QString *error = nullptr);
+    // 组合键文本 -> 修饰键与主键的虚拟键码; 不认识的键返回 false
+    static bool parseChord(const QString &text, QVector<quint8> &modifiers, quint8 &key);
+    // 目标程序收到后会改写剪贴板的组合键: Ctrl+C、Ctrl+X、Ctrl+Insert、Shift+Delete
+    static bool writesClipboard(const Step &step);
+
+    // 内置宏: 写入并等就绪、等按键松开后依次 Ctrl+V、Ctrl+A、Ctrl+C, 间隔 keyIntervalMs
+    static ActionMacro paste(int keyIntervalMs);
+    // 内置宏: 只写入剪贴板并等就绪
+    static ActionMacro copy();
+};
+
+/**
+ * 执行一次宏的协程
+ *
+ * 创建后挂起, 由调用方 resume; 结束时也挂起, 协程帧随对象析构释放.
+ * 各步的等待对象都在帧内, 除帧本身外每步不再分配内存.
+ */
+class ActionTask
+{
+public:
+    struct promise_type {
+        ActionTask get_return_object() { return ActionTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    ActionTask() = default;
+    ActionTask(ActionTask &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    ActionTask &operator=(ActionTask &&other) noexcept
+    {
+        if (this != &other) {
+            if (m_handle)
+                m_handle.destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ActionTask(const ActionTask &) = delete;
+    ActionTask &operator=(const ActionTask &) = delete;
+    ~ActionTask()
+    {
+        if (m_handle)
+            m_handle.destroy();
+    }
+
+    bool isValid() const { return bool(m_handle); }
+    bool isDone() const { return !m_handle || m_handle.done(); }
+    void resume() { m_handle.resume(); }
+
+private:
+    explicit ActionTask(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+#endif // ACTIONMACRO_H
@@ -5,6 +5,7 @@
 #include <QMetaMethod>
 #include <QThread>
 #include <QDebug>
+#include <chrono>
 
 Q_LOGGING_CATEGORY(logQHotkey, "QHotkey")
 
@@ -27,6 +28,78 @@ bool QHotkey::isPlatformSupported()
     return QHotkeyPrivate::isPlatformSupported();
 }
 
+QPair<quint64, quint64> QHotkey::nativeCallCounts()
+{
+    QHotkeyPrivate *d = QHotkeyPrivate::instance();
+    return {d->nativeRegisterCalls(), d->nativeUnregisterCalls()};
+}
+
+void QHotkey::setTimestampClock(QHotkey::TimestampClock clock)
+{
+    QHotkeyPrivate::instance()->setTimestampClock(clock);
+}
+
+bool QHotkey::startListenerThread()
+{
+    return QHotkeyPrivate::instance()->startListenerThread();
+}
+
+void QHotkey::stopListenerThread()
+{
+    QHotkeyPrivate::instance()->stopListenerThread();
+}
+
+QThread *QHotkey::listenerThread()
+{
+    return QHotkeyPrivate::instance()->dedicatedThread();
+}
+
+QHotkey::FilterStats QHotkey::nativeFilterStats()
+{
+    return QHotkeyPrivate::instance()->filterStats();
+}
+
+void QHotkey::resetNativeFilterStats()
+{
+    QHotkeyPrivate::instance()->resetFilterStats();
+}
+
+void QHotkey::setNativeFilterTiming(bool enabled)
+{
+    QHotkeyPrivate::instance()->setFilterTiming(enabled);
+}
+
+bool QHotkey::filterNativeEvent(const QByteArray &eventType, void *message)
+{
+    _NATIVE_EVENT_RESULT result = 0;
+    return QHotkeyPrivate::instance()->nativeEventFilter(eventType, message, &result);
+}
+
+int QHotkey::heldShortcutCount()
+{
+    return QHotkeyPrivate::instance()->heldShortcutCount();
+}
+
+void QHotkey::setHeadless(bool headless)
+{
+    QHotkeyPrivate::instance()->setHeadless(headless);
+}
+
+void QHotkey::postNativeEvent(QHotkey::NativeShortcut shortcut)
+{
+    QHotkeyPrivate::instance()->postNativeEvent(shortcut);
+}
+
+void QHotkey::postNativeHold(QHotkey::NativeShortcut shortcut)
+{
+    QHotkeyPrivate::instance()->postNativeHold(shortcut);
+}
+
+void QHotkey::postNativeRelease(QHotkey::NativeShortcut shortcut)
+{
+    QHotkeyPrivate::instance()->postNativeRelease(shortcut);
+}
+
 QHotkey::QHotkey(QObject *parent) :
     QObject(parent),
     _keyCode(Qt::Key_unknown),
@@ -197,7 +270,9 @@ bool QHotkey::setRegistered(bool registered)
 
 // ---------- QHotkeyPrivate implementation ----------
 
-QHotkeyPrivate::QHotkeyPrivate()
+QHotkeyPrivate::QHotkeyPrivate() :
+    timestampClock(nullptr),
+    filterTiming(false)
 {
     Q_ASSERT_X(qApp, Q_FUNC_INFO, "QHotkey requires QCoreApplication to be instantiated");
     qApp->eventDispatcher()->installNativeEventFilter(this);
@@ -207,10 +282,110 @@ QHotkeyPrivate::~QHotkeyPrivate()
 {
     if(!shortcuts.isEmpty())
         qCWarning(logQHotkey) << "QHotkeyPrivate destroyed with registered shortcuts!";
-    if(qApp && qApp->eventDispatcher())
+    // the listener thread is stopped on aboutToQuit; without an application there is nothing left to clean up
+    if(listenerThread)
+        qCWarning(logQHotkey) << "QHotkeyPrivate destroyed while the listener thread is running";
+    else if(qApp && qApp->eventDispatcher())
         qApp->eventDispatcher()->removeNativeEventFilter(this);
 }
 
+void QHotkeyPrivate::setTimestampClock(QHotkey::TimestampClock clock)
+{
+    timestampClock.store(clock, std::memory_order_relaxed);
+}
+
+qint64 QHotkeyPrivate::timestampNow() const
+{
+    QHotkey::TimestampClock clock = timestampClock.load(std::memory_order_relaxed);
+    if(clock)
+        return clock();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+qint64 QHotkeyPrivate::pressTimestamp(qint64 eventAgeNs, qint64 eventClockResolutionNs)
+{
+    const qint64 nowNs = timestampNow();
+    // a negative age is clock jitter between the two time bases
+    eventAgeNs = qMax<qint64>(0, eventAgeNs);
+    skewSamples.storeRelaxed(skewSamples.loadRelaxed() + 1);
+    skewTotalNs.storeRelaxed(skewTotalNs.loadRelaxed() + eventAgeNs);
+    skewLastNs.storeRelaxed(eventAgeNs);
+    if(eventAgeNs > skewMaxNs.loadRelaxed())
+        skewMaxNs.storeRelaxed(eventAgeNs);
+    if(eventAgeNs <= eventClockResolutionNs)
+        return nowNs;
+    skewCorrected.storeRelaxed(skewCorrected.loadRelaxed() + 1);
+    return nowNs - eventAgeNs;
+}
+
+bool QHotkeyPrivate::startListenerThread()
+{
+    if(listenerThread)
+        return true;
+    if(QThread::currentThread() != thread()) {
+        qCWarning(logQHotkey) << "startListenerThread must be called from the thread owning QHotkeyPrivate";
+        return false;
+    }
+    // native registrations belong to the thread that made them, so they cannot be moved
+    if(!shortcuts.isEmpty()) {
+        qCWarning(logQHotkey) << "startListenerThread must be called before any hotkey is registered";
+        return false;
+    }
+
+    if(qApp->eventDispatcher())
+        qApp->eventDispatcher()->removeNativeEventFilter(this);
+
+    listenerThread = new QThread();
+    listenerThread->setObjectName(QStringLiteral("QHotkey listener"));
+    moveToThread(listenerThread);
+    listenerThread->start(QThread::TimeCriticalPriority);
+    // stopped while the application still exists, not during static destruction
+    quitConnection = connect(qApp, &QCoreApplication::aboutToQuit, qApp, [this]() { stopListenerThread(); });
+
+    return QMetaObject::invokeMethod(this, "installFilterInvoked", Qt::BlockingQueuedConnection);
+}
+
+void QHotkeyPrivate::stopListenerThread()
+{
+    if(!listenerThread)
+        return;
+    if(QThread::currentThread() == listenerThread) {
+        qCWarning(logQHotkey) << "stopListenerThread must not be called from the listener thread";
+        return;
+    }
+
+    disconnect(quitConnection);
+    QMetaObject::invokeMethod(this, "stopListeningInvoked", Qt::BlockingQueuedConnection,
+                              Q_ARG(QThread*, QThread::currentThread()));
+    listenerThread->quit();
+    listenerThread->wait();
+    delete listenerThread;
+    listenerThread = nullptr;
+    if(QAbstractEventDispatcher::instance())
+        QAbstractEventDispatcher::instance()->installNativeEventFilter(this);
+}
+
+void QHotkeyPrivate::installFilterInvoked()
+{
+    QAbstractEventDispatcher::instance()->installNativeEventFilter(this);
+}
+
+void QHotkeyPrivate::stopListeningInvoked(QThread *target)
+{
+    QAbstractEventDispatcher::instance()->removeNativeEventFilter(this);
+    // native registrations belong to this thread and must be released here
+    if(!headless) {
+        for(const QHotkey::NativeShortcut &shortcut : shortcuts.uniqueKeys()) {
+            unregisterCalls.fetchAndAddRelaxed(1);
+            if(!unregisterShortcut(shortcut))
+                qCWarning(logQHotkey) << "Failed to release a native registration of the listener thread:" << error;
+            releasedShortcuts.insert(shortcut);
+        }
+    }
+    moveToThread(target);
+}
+
 QHotkey::NativeShortcut QHotkeyPrivate::nativeShortcut(Qt::Key keycode, Qt::KeyboardModifiers modifiers)
 {
     Qt::ConnectionType conType = (QThread::currentThread() == thread() ?
@@ -266,18 +441,104 @@ bool QHotkeyPrivate::removeShortcut(QHotkey *hotkey)
     return res;
 }
 
-void QHotkeyPrivate::activateShortcut(QHotkey::NativeShortcut shortcut)
+quint64 QHotkeyPrivate::nativeRegisterCalls() const
 {
-    QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::activated);
-    for(QHotkey *hkey : shortcuts.values(shortcut))
-        signal.invoke(hkey, Qt::QueuedConnection);
+    return registerCalls.loadRelaxed();
+}
+
+quint64 QHotkeyPrivate::nativeUnregisterCalls() const
+{
+    return unregisterCalls.loadRelaxed();
+}
+
+QHotkey::FilterStats QHotkeyPrivate::filterStats() const
+{
+    QHotkey::FilterStats stats;
+    stats.eventsSeen = filterSeen.loadRelaxed();
+    stats.eventsAccepted = filterAccepted.loadRelaxed();
+    stats.filterNs = filterNs.loadRelaxed();
+    stats.skewSamples = skewSamples.loadRelaxed();
+    stats.skewCorrected = skewCorrected.loadRelaxed();
+    stats.skewTotalNs = skewTotalNs.loadRelaxed();
+    stats.skewMaxNs = skewMaxNs.loadRelaxed();
+    stats.skewLastNs = skewLastNs.loadRelaxed();
+    return stats;
+}
+
+void QHotkeyPrivate::resetFilterStats()
+{
+    filterSeen.storeRelaxed(0);
+    filterAccepted.storeRelaxed(0);
+    filterNs.storeRelaxed(0);
+    skewSamples.storeRelaxed(0);
+    skewCorrected.storeRelaxed(0);
+    skewTotalNs.storeRelaxed(0);
+    skewMaxNs.storeRelaxed(0);
+    skewLastNs.storeRelaxed(0);
+}
+
+void QHotkeyPrivate::setFilterTiming(bool enabled)
+{
+    filterTiming.store(enabled, std::memory_order_relaxed);
+}
+
+void QHotkeyPrivate::postNativeEvent(QHotkey::NativeShortcut shortcut)
+{
+    // goes through the thread's event queue like a platform message would
+    QMetaObject::invokeMethod(this, [this, shortcut]() { dispatchPosted(shortcut); }, Qt::QueuedConnection);
+}
+
+void QHotkeyPrivate::postNativeHold(QHotkey::NativeShortcut shortcut)
+{
+    // counted as held from the same dispatch that activates it, as the Windows backend does
+    QMetaObject::invokeMethod(this, [this, shortcut]() {
+        dispatchPosted(shortcut);
+        if(!shortcut.isValid())
+            return;
+        postedHeld.append(shortcut);
+        setHeldShortcutCount(postedHeld.size());
+    }, Qt::QueuedConnection);
+}
+
+void QHotkeyPrivate::postNativeRelease(QHotkey::NativeShortcut shortcut)
+{
+    QMetaObject::invokeMethod(this, [this, shortcut]() {
+        if(!postedHeld.removeOne(shortcut))
+            return;
+        setHeldShortcutCount(postedHeld.size());
+        releaseShortcut(shortcut);
+    }, Qt::QueuedConnection);
+}
+
+void QHotkeyPrivate::dispatchPosted(QHotkey::NativeShortcut shortcut)
+{
+    FilterTimer timer(this);
+    countFilterEvent(shortcut.isValid());
+    if(shortcut.isValid())
+        activateShortcut(shortcut);
+}
+
+void QHotkeyPrivate::activateShortcut(QHotkey::NativeShortcut shortcut, qint64 timestampNs)
+{
+    dispatchShortcut(shortcut, QMetaMethod::fromSignal(&QHotkey::activated), timestampNs);
 }
 
 void QHotkeyPrivate::releaseShortcut(QHotkey::NativeShortcut shortcut)
 {
-    QMetaMethod signal = QMetaMethod::fromSignal(&QHotkey::released);
+    dispatchShortcut(shortcut, QMetaMethod::fromSignal(&QHotkey::released));
+}
+
+void QHotkeyPrivate::dispatchShortcut(QHotkey::NativeShortcut shortcut, QMetaMethod signal, qint64 timestampNs)
+{
+    // backends pass the native event time when they have one
+    if(timestampNs == 0)
+        timestampNs = timestampNow();
+    // On the listener thread the signal is emitted right away: receivers living there run
+    // immediately, receivers on other threads are queued by Qt. On the GUI thread the
+    // emission is deferred until we are out of the native event filter.
+    const Qt::ConnectionType conType = listenerThread ? Qt::DirectConnection : Qt::QueuedConnection;
     for(QHotkey *hkey : shortcuts.values(shortcut))
-        signal.invoke(hkey, Qt::QueuedConnection);
+        signal.invoke(hkey, conType, Q_ARG(qint64, timestampNs));
 }
 
 void QHotkeyPrivate::addMappingInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut nativeShortcut)
@@ -289,11 +550,13 @@ bool QHotkeyPrivate::addShortcutInvoked(QHotkey *hotkey)
 {
     QHotkey::NativeShortcut shortcut = hotkey->_nativeShortcut;
 
-    if(!shortcuts.contains(shortcut)) {
-        if(!registerShortcut(shortcut)) {
+    if(!shortcuts.contains(shortcut) || releasedShortcuts.contains(shortcut)) {
+        registerCalls.fetchAndAddRelaxed(1);
+        if(!headless && !registerShortcut(shortcut)) {
             qCWarning(logQHotkey) << QHotkey::tr("Failed to register %1. Error: %2").arg(hotkey->shortcut().toString(), error);
             return false;
         }
+        releasedShortcuts.remove(shortcut);
     }
 
     shortcuts.insert(shortcut, hotkey);
@@ -310,6 +573,11 @@ bool QHotkeyPrivate::removeShortcutInvoked(QHotkey *hotkey)
     hotkey->_registered = false;
     emit hotkey->registeredChanged(true);
     if(shortcuts.count(shortcut) == 0) {
+        if(releasedShortcuts.remove(shortcut))
+            return true;
+        unregisterCalls.fetchAndAddRelaxed(1);
+        if(headless)
+            return true;
         if (!unregisterShortcut(shortcut)) {
             qCWarning(logQHotkey) << QHotkey::tr("Failed to unregister %1. Error: %2").arg(hotkey->shortcut().toString(), error);
             return false;
@@ -66,6 +66,61 @@ public:
     //! Checks if global shortcuts are supported by the current platform
     static bool isPlatformSupported();
 
+    //! Returns how many native register (first) and unregister (second) calls were made so far; in headless mode, how many would have been made
+    static QPair<quint64, quint64> nativeCallCounts();
+
+    //! Function returning the current time in nanoseconds since the epoch
+    typedef qint64 (*TimestampClock)();
+    //! Sets the clock used to timestamp activations and releases
+    static void setTimestampClock(TimestampClock clock);
+
+    //! Moves native event listening and dispatch onto a dedicated thread
+    //! The thread is stopped again on QCoreApplication::aboutToQuit
+    static bool startListenerThread();
+    //! Releases the native registrations made on the listener thread, stops it and moves listening back to the calling thread
+    //! Hotkeys that are still registered stay registered inside QHotkey; register them again to reach the platform
+    static void stopListenerThread();
+    //! Returns the dedicated listener thread, or nullptr when listening on the GUI thread
+    static QThread *listenerThread();
+
+    //! Counters of the native event filter
+    struct FilterStats {
+        //! Native events that reached the filter
+        quint64 eventsSeen = 0;
+        //! Events that passed the fast reject check and were handled as hotkey events
+        quint64 eventsAccepted = 0;
+        //! Time spent inside the filter, only counted while timing is enabled
+        qint64 filterNs = 0;
+        //! Presses whose native event time was compared with the time the filter saw them
+        quint64 skewSamples = 0;
+        //! Presses stamped with the native event time because the filter saw them late
+        quint64 skewCorrected = 0;
+        //! Sum, maximum and most recent delay from native event time to filter time
+        qint64 skewTotalNs = 0;
+        qint64 skewMaxNs = 0;
+        qint64 skewLastNs = 0;
+    };
+    //! Returns the native event filter counters
+    static FilterStats nativeFilterStats();
+    //! Resets the native event filter counters to zero
+    static void resetNativeFilterStats();
+    //! Enables or disables measuring the time spent in the native event filter (off by default)
+    static void setNativeFilterTiming(bool enabled);
+    //! Passes a native event through the hotkey filter as if the platform had delivered it; call on the listening thread
+    static bool filterNativeEvent(const QByteArray &eventType, void *message);
+
+    //! Returns how many activated shortcuts are still physically held (key or any of its modifiers down)
+    static int heldShortcutCount();
+
+    //! Keeps registrations inside QHotkey without calling the platform; set before registering any hotkey
+    static void setHeadless(bool headless);
+    //! Queues a native shortcut press to the thread the event filter runs on and dispatches it there like a native event; an invalid shortcut counts as a rejected event
+    static void postNativeEvent(NativeShortcut shortcut);
+    //! Like postNativeEvent, but the shortcut then counts as held (see heldShortcutCount) until postNativeRelease; for headless use
+    static void postNativeHold(NativeShortcut shortcut);
+    //! Queues the release of a shortcut posted with postNativeHold; emits released once it is dispatched
+    static void postNativeRelease(NativeShortcut shortcut);
+
     //! Default Constructor
     explicit QHotkey(QObject *parent = nullptr);
     //! Constructs a hotkey with a shortcut and optionally registers it
@@ -103,11 +158,11 @@ public Q_SLOTS:
     bool setNativeShortcut(QHotkey::NativeShortcut nativeShortcut, bool autoRegister = false);
 
 Q_SIGNALS:
-    //! Will be emitted if the shortcut is pressed
-    void activated(QPrivateSignal);
+    //! Will be emitted if the shortcut is pressed, with the time the press was seen
+    void activated(qint64 timestampNs, QPrivateSignal);
 
-    //! Will be emitted if the shortcut press is released
-    void released(QPrivateSignal);
+    //! Will be emitted once the shortcut key and its modifiers are all released, with the time the release was seen
+    void released(qint64 timestampNs, QPrivateSignal);
 
     //! @notifyAcFn{QHotkey::registered}
     void registeredChanged(bool registered);
@@ -0,0 +1,59 @@
+#include "qhotkey.h"
+#include "qhotkey_p.h"
+
+// Fallback backend for platforms without a native implementation (e.g. headless
+// builds of the core library). Mapping works, registration always fails.
+class QHotkeyPrivateDummy : public QHotkeyPrivate
+{
+public:
+    // QAbstractNativeEventFilter interface
+    bool nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result) override;
+
+protected:
+    // QHotkeyPrivate interface
+    quint32 nativeKeycode(Qt::Key keycode, bool &ok) Q_DECL_OVERRIDE;
+    quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) Q_DECL_OVERRIDE;
+    bool registerShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+    bool unregisterShortcut(QHotkey::NativeShortcut shortcut) Q_DECL_OVERRIDE;
+};
+NATIVE_INSTANCE(QHotkeyPrivateDummy)
+
+bool QHotkeyPrivate::isPlatformSupported()
+{
+    return false;
+}
+
+bool QHotkeyPrivateDummy::nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result)
+{
+    Q_UNUSED(eventType)
+    Q_UNUSED(message)
+    Q_UNUSED(result)
+    // nothing is ever registered, so every event is rejected
+    countFilterEvent(false);
+    return false;
+}
+
+quint32 QHotkeyPrivateDummy::nativeKeycode(Qt::Key keycode, bool &ok)
+{
+    ok = true;
+    return static_cast<quint32>(keycode);
+}
+
+quint32 QHotkeyPrivateDummy::nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok)
+{
+    ok = true;
+    return static_cast<quint32>(modifiers);
+}
+
+bool QHotkeyPrivateDummy::registerShortcut(QHotkey::NativeShortcut shortcut)
+{
+    Q_UNUSED(shortcut)
+    error = QStringLiteral("Global hotkeys are not supported on this platform");
+    return false;
+}
+
+bool QHotkeyPrivateDummy::unregisterShortcut(QHotkey::NativeShortcut shortcut)
+{
+    Q_UNUSED(shortcut)
+    return true;
+}
@@ -5,7 +5,13 @@
 #include <QAbstractNativeEventFilter>
 #include <QMultiHash>
 #include <QMutex>
+#include <QSet>
+#include <QAtomicInteger>
 #include <QGlobalStatic>
+#include <QMetaMethod>
+#include <QThread>
+#include <atomic>
+#include <chrono>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #define _NATIVE_EVENT_RESULT qintptr
@@ -29,9 +35,66 @@ public:
     bool addShortcut(QHotkey *hotkey);
     bool removeShortcut(QHotkey *hotkey);
 
+    quint64 nativeRegisterCalls() const;
+    quint64 nativeUnregisterCalls() const;
+
+    void setTimestampClock(QHotkey::TimestampClock clock);
+    bool startListenerThread();
+    void stopListenerThread();
+    QThread *dedicatedThread() const { return listenerThread; }
+
+    QHotkey::FilterStats filterStats() const;
+    void resetFilterStats();
+    void setFilterTiming(bool enabled);
+
+    int heldShortcutCount() const { return heldShortcuts.loadRelaxed(); }
+
+    void setHeadless(bool headless) { this->headless = headless; }
+    void postNativeEvent(QHotkey::NativeShortcut shortcut);
+    void postNativeHold(QHotkey::NativeShortcut shortcut);
+    void postNativeRelease(QHotkey::NativeShortcut shortcut);
+
 protected:
-    void activateShortcut(QHotkey::NativeShortcut shortcut);
+    void activateShortcut(QHotkey::NativeShortcut shortcut, qint64 timestampNs = 0);
     void releaseShortcut(QHotkey::NativeShortcut shortcut);
+    // Published by the backend whenever its set of pressed, not yet released shortcuts changes
+    void setHeldShortcutCount(int count) { heldShortcuts.storeRelaxed(count); }
+
+    qint64 timestampNow() const;
+    // Maps a native event that happened eventAgeNs before the filter saw it to a timestamp.
+    // The native event clock is coarse, so the event time is only used when the delay
+    // exceeds its resolution; otherwise the precise filter time is kept.
+    qint64 pressTimestamp(qint64 eventAgeNs, qint64 eventClockResolutionNs);
+
+    // Filter counters are only written from the thread the filter runs on, so the
+    // increments are plain relaxed load/store pairs without a locked instruction.
+    inline void countFilterEvent(bool accepted) {
+        filterSeen.storeRelaxed(filterSeen.loadRelaxed() + 1);
+        if(accepted)
+            filterAccepted.storeRelaxed(filterAccepted.loadRelaxed() + 1);
+    }
+
+    // Adds the time from construction to destruction to the filter time, when timing is on
+    class FilterTimer
+    {
+    public:
+        inline explicit FilterTimer(QHotkeyPrivate *d) :
+            d(d->filterTiming.load(std::memory_order_relaxed) ? d : nullptr)
+        {
+            if(this->d)
+                start = std::chrono::steady_clock::now();
+        }
+        inline ~FilterTimer() {
+            if(d) {
+                const qint64 ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                d->filterNs.storeRelaxed(d->filterNs.loadRelaxed() + ns);
+            }
+        }
+
+    private:
+        QHotkeyPrivate *d;
+        std::chrono::steady_clock::time_point start;
+    };
 
     virtual quint32 nativeKeycode(Qt::Key keycode, bool &ok) = 0;//platform implement
     virtual quint32 nativeModifiers(Qt::KeyboardModifiers modifiers, bool &ok) = 0;//platform implement
@@ -44,11 +107,36 @@ protected:
 private:
     QHash<QPair<Qt::Key, Qt::KeyboardModifiers>, QHotkey::NativeShortcut> mapping;
     QMultiHash<QHotkey::NativeShortcut, QHotkey*> shortcuts;
+    QAtomicInteger<quint64> registerCalls;
+    QAtomicInteger<quint64> unregisterCalls;
+    std::atomic<QHotkey::TimestampClock> timestampClock;
+    QThread *listenerThread = nullptr;
+    QMetaObject::Connection quitConnection;
+    // Shortcuts whose native registration ended with the listener thread
+    QSet<QHotkey::NativeShortcut> releasedShortcuts;
+    QAtomicInteger<quint64> filterSeen;
+    QAtomicInteger<quint64> filterAccepted;
+    QAtomicInteger<qint64> filterNs;
+    std::atomic<bool> filterTiming;
+    QAtomicInteger<quint64> skewSamples;
+    QAtomicInteger<quint64> skewCorrected;
+    QAtomicInteger<qint64> skewTotalNs;
+    QAtomicInteger<qint64> skewMaxNs;
+    QAtomicInteger<qint64> skewLastNs;
+    QAtomicInt heldShortcuts;
+    bool headless = false;
+    // Shortcuts held through postNativeHold, only touched on the thread the filter runs on
+    QList<QHotkey::NativeShortcut> postedHeld;
+
+    void dispatchShortcut(QHotkey::NativeShortcut shortcut, QMetaMethod signal, qint64 timestampNs = 0);
+    void dispatchPosted(QHotkey::NativeShortcut shortcut);
 
     Q_INVOKABLE void addMappingInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers, QHotkey::NativeShortcut nativeShortcut);
     Q_INVOKABLE bool addShortcutInvoked(QHotkey *hotkey);
     Q_INVOKABLE bool removeShortcutInvoked(QHotkey *hotkey);
     Q_INVOKABLE QHotkey::NativeShortcut nativeShortcutInvoked(Qt::Key keycode, Qt::KeyboardModifiers modifiers);
+    Q_INVOKABLE void installFilterInvoked();
+    Q_INVOKABLE void stopListeningInvoked(QThread *target);
 };
 
 #define NATIVE_INSTANCE(ClassName) \
@@ -31,11 +31,22 @@ private:
     static QString formatWinError(DWORD winError);
     QTimer pollTimer;
     QList<QHotkey::NativeShortcut> polledShortcuts;
+    qint64 tickResolutionNs;
 };
 NATIVE_INSTANCE(QHotkeyPrivateWin)
 
-QHotkeyPrivateWin::QHotkeyPrivateWin(){
-    pollTimer.setInterval(50);
+QHotkeyPrivateWin::QHotkeyPrivateWin() :
+    pollTimer(this), // parented so it follows us onto the listener thread
+    tickResolutionNs(16000000)
+{
+    // GetTickCount advances once per clock interrupt (typically 15.6 ms)
+    DWORD adjustment = 0, increment = 0;
+    BOOL disabled = FALSE;
+    if(GetSystemTimeAdjustment(&adjustment, &increment, &disabled) && increment > 0)
+        tickResolutionNs = qint64(increment) * 100 + 1000000;
+    // Only runs while a hotkey is held, so a short interval costs no idle wakeups
+    pollTimer.setObjectName(QStringLiteral("QHotkey release poll"));
+    pollTimer.setInterval(10);
     connect(&pollTimer, &QTimer::timeout, this, &QHotkeyPrivateWin::pollForHotkeyRelease);
 }
 
@@ -46,30 +57,53 @@ bool QHotkeyPrivate::isPlatformSupported()
 
 bool QHotkeyPrivateWin::nativeEventFilter(const QByteArray &eventType, void *message, _NATIVE_EVENT_RESULT *result)
 {
-    Q_UNUSED(eventType)
     Q_UNUSED(result)
+    // Both "windows_generic_MSG" and "windows_dispatcher_MSG" carry a MSG, so the
+    // event type string never needs to be compared: one integer test rejects
+    // everything that is not WM_HOTKEY (mouse moves, paint, tray, clipboard...).
+    Q_UNUSED(eventType)
 
+    FilterTimer timer(this);
     MSG* msg = static_cast<MSG*>(message);
-    if(msg->message == WM_HOTKEY) {
-        QHotkey::NativeShortcut shortcut = {HIWORD(msg->lParam), LOWORD(msg->lParam)};
-        this->activateShortcut(shortcut);
-        if (this->polledShortcuts.empty())
-            this->pollTimer.start();
-        this->polledShortcuts.append(shortcut);
+    if(Q_LIKELY(msg->message != WM_HOTKEY)) {
+        countFilterEvent(false);
+        return false;
     }
 
+    countFilterEvent(true);
+    // MSG::time is the GetTickCount() value when the key was pressed; the unsigned
+    // difference stays correct across the 49.7 day wrap-around
+    const DWORD ageMs = GetTickCount() - msg->time;
+    const qint64 pressNs = pressTimestamp(qint64(ageMs) * 1000000, tickResolutionNs);
+    QHotkey::NativeShortcut shortcut = {HIWORD(msg->lParam), LOWORD(msg->lParam)};
+    this->activateShortcut(shortcut, pressNs);
+    if (this->polledShortcuts.empty())
+        this->pollTimer.start();
+    this->polledShortcuts.append(shortcut);
+    this->setHeldShortcutCount(this->polledShortcuts.size());
+
     return false;
 }
 
 void QHotkeyPrivateWin::pollForHotkeyRelease()
 {
-    auto it = std::remove_if(this->polledShortcuts.begin(), this->polledShortcuts.end(), [this](const QHotkey::NativeShortcut &shortcut) {
-        bool pressed = (GetAsyncKeyState(shortcut.key) & (1 << 15)) != 0;
+    // A shortcut counts as held until its key and every one of its modifiers are up,
+    // so keys injected after the release cannot combine with a physically held Ctrl
+    auto isDown = [](int virtualKey) {
+        return (GetAsyncKeyState(virtualKey) & (1 << 15)) != 0;
+    };
+    auto it = std::remove_if(this->polledShortcuts.begin(), this->polledShortcuts.end(), [this, isDown](const QHotkey::NativeShortcut &shortcut) {
+        const bool pressed = isDown(shortcut.key)
+                             || ((shortcut.modifier & MOD_CONTROL) && isDown(VK_CONTROL))
+                             || ((shortcut.modifier & MOD_SHIFT) && isDown(VK_SHIFT))
+                             || ((shortcut.modifier & MOD_ALT) && isDown(VK_MENU))
+                             || ((shortcut.modifier & MOD_WIN) && (isDown(VK_LWIN) || isDown(VK_RWIN)));
         if (!pressed)
             this->releaseShortcut(shortcut);
         return !pressed;
     });
     this->polledShortcuts.erase(it, this->polledShortcuts.end());
+    this->setHeldShortcutCount(this->polledShortcuts.size());
     if (this->polledShortcuts.empty())
         this->pollTimer.stop();
 }
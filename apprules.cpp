@@ -0,0 +1,69 @@
+#include "apprules.h"
+
+#include <QJsonObject>
+
+bool AppRules::parse(const QJsonArray &config, AppRules &rules, QString *error)
+{
+    rules = AppRules();
+    rules.m_rules.reserve(config.size());
+    for (int i = 0; i < config.size(); ++i) {
+        const QJsonObject object = config.at(i).toObject();
+
+        Rule rule;
+        rule.process = object.value("process").toString().toLower();
+        rule.windowClass = object.value("class").toString().toLower();
+        rule.shortcut = QKeySequence::fromString(object.value("shortcut").toString(), QKeySequence::PortableText);
+        rule.hasFormat = object.contains("format");
+        if (rule.hasFormat)
+            rule.formatter = TimestampFormatter(object.value("format").toString());
+        rule.action = object.value("action").toString();
+        if (rule.process.isEmpty() && rule.windowClass.isEmpty()) {
+            if (error)
+                *error = QString("程序规则第 %1 项没有 process 或 class").arg(i + 1);
+            return false;
+        }
+        if (rule.hasFormat && !rule.formatter.isValid()) {
+            if (error)
+                *error = QString("程序规则第 %1 项: %2").arg(i + 1).arg(rule.formatter.errorString());
+            return false;
+        }
+
+        const int index = rules.m_rules.size();
+        if (!rule.process.isEmpty())
+            rules.m_byProcess[rule.process].append(index);
+        else
+            rules.m_byClass[rule.windowClass].append(index);
+        rules.m_rules.append(rule);
+    }
+    return true;
+}
+
+const AppRules::Rule *AppRules::match(const ForegroundApp::Window &window, const QKeySequence &shortcut) const
+{
+    if (m_rules.isEmpty())
+        return nullptr;
+    const QVector<int> byProcess = m_byProcess.value(window.process);
+    const QVector<int> byClass = m_byClass.value(window.windowClass);
+
+    // 两个候选列表都按下标升序, 归并着找第一条相符的
+    int p = 0;
+    int c = 0;
+    while (p < byProcess.size() || c < byClass.size()) {
+        int index;
+        if (c == byClass.size() || (p < byProcess.size() && byProcess.at(p) < byClass.at(c)))
+            index = byProcess.at(p++);
+        else
+            index = byClass.at(c++);
+        const Rule &rule = m_rules.at(index);
+        if (matches(rule, window, shortcut))
+            return &rule;
+    }
+    return nullptr;
+}
+
+bool AppRules::matches(const Rule &rule, const ForegroundApp::Window &window, const QKeySequence &shortcut)
+{
+    return (rule.process.isEmpty() || rule.process == window.process)
+           && (rule.windowClass.isEmpty() || rule.windowClass == window.windowClass)
+           && (rule.shortcut.isEmpty() || rule.shortcut == shortcut);
+}
@@ -0,0 +1,57 @@
+#ifndef APPRULES_H
+#define APPRULES_H
+
+#include <QHash>
+#include <QJsonArray>
+#include <QKeySequence>
+#include <QString>
+#include <QVector>
+#include "foregroundapp.h"
+#include "timestampformatter.h"
+
+/**
+ * 按前台程序覆盖热键的格式与动作
+ *
+ * 配置为 "apps" 数组, 每条规则至少指定 "process"(进程名)或 "class"(窗口类名), 不区分大小写:
+ *   { "process": "windowsterminal.exe", "action": "copy" }
+ *   { "process": "excel.exe", "format": "yyyy-MM-dd'T'HH:mm:ss.zzzttt" }
+ *   { "class": "notepad", "shortcut": "Ctrl+`", "action": "enter" }
+ * "action" 为 "paste"、"copy" 或 "macros" 中定义的宏名(见 HotkeyProfile), 上例的 "enter" 须定义为如
+ *   "macros": { "enter": ["clipboard", "ready", "release", "inject Ctrl+V", "delay 50", "inject Return"] }
+ * 否则配置加载失败. "shortcut" 限定只作用于某个热键; "format"、"action" 省略时沿用热键自身的设置.
+ * 多条规则都匹配时按文件中的顺序取第一条.
+ *
+ * 规则按进程名与类名建哈希索引, 匹配只查两次表再比较少数候选, 与规则总数无关.
+ */
+class AppRules
+{
+public:
+    struct Rule {
+        QString process;
+        QString windowClass;
+        QKeySequence shortcut;
+        bool hasFormat = false;
+        TimestampFormatter formatter;
+        // 动作或宏名, 为空时沿用热键的动作
+        QString action;
+    };
+
+    static bool parse(const QJsonArray &config, AppRules &rules, QString *error = nullptr);
+
+    // 第一条与窗口及热键都相符的规则; 没有时返回 nullptr
+    const Rule *match(const ForegroundApp::Window &window, const QKeySequence &shortcut) const;
+
+    bool isEmpty() const { return m_rules.isEmpty(); }
+    int size() const { return m_rules.size(); }
+    const QVector<Rule> &rules() const { return m_rules; }
+
+private:
+    static bool matches(const Rule &rule, const ForegroundApp::Window &window, const QKeySequence &shortcut);
+
+    QVector<Rule> m_rules;
+    // 进程名/类名 -> 规则下标(升序); 两者都指定的规则只放在进程名索引中
+    QHash<QString, QVector<int>> m_byProcess;
+    QHash<QString, QVector<int>> m_byClass;
+};
+
+#endif // APPRULES_H
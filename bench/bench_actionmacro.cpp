@@ -0,0 +1,81 @@
+#include <QEventLoop>
+#include <QTest>
+#include <QTimer>
+#include <functional>
+#include "actionmacro.h"
+#include "pastesequence.h"
+#include "testregistry.h"
+
+/**
+ * 动作宏调度开销: N 步 "delay 0" 的宏(一个协程帧, 共用一个定时器)与原先的写法
+ * (每步一个 QTimer::singleShot 回调, 在回调中再排下一步)比较每轮耗时.
+ *
+ * N 默认 10 万步; 可由环境变量 TIMESTAMPHOTKEY_MACRO_STEPS 调整.
+ */
+class BenchActionMacro : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void delaySteps_data();
+    void delaySteps();
+
+private:
+    int m_steps = 100000;
+};
+
+void BenchActionMacro::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_MACRO_STEPS"))
+        m_steps = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_MACRO_STEPS"));
+}
+
+void BenchActionMacro::delaySteps_data()
+{
+    QTest::addColumn<bool>("chain");
+    QTest::newRow("coroutine macro") << false;
+    QTest::newRow("singleShot chain") << true;
+}
+
+void BenchActionMacro::delaySteps()
+{
+    QFETCH(bool, chain);
+    QEventLoop loop;
+
+    if (chain) {
+        int remaining = 0;
+        std::function<void()> next = [&]() {
+            if (--remaining > 0)
+                QTimer::singleShot(0, next);
+            else
+                loop.quit();
+        };
+        QBENCHMARK {
+            remaining = m_steps;
+            QTimer::singleShot(0, next);
+            loop.exec();
+        }
+        QCOMPARE(remaining, 0);
+        return;
+    }
+
+    PasteSequence sequence;
+    ActionMacro macro;
+    macro.steps.resize(m_steps);
+    for (ActionMacro::Step &step : macro.steps) {
+        step.kind = ActionMacro::Delay;
+        step.ms = 0;
+    }
+    connect(&sequence, &PasteSequence::finished, &loop, &QEventLoop::quit);
+    QBENCHMARK {
+        sequence.runMacro(QString(), macro);
+        if (sequence.isRunning())
+            loop.exec();
+    }
+    QVERIFY(!sequence.isRunning());
+}
+
+REGISTER_TEST(BenchActionMacro)
+
+#include "bench_actionmacro.moc"
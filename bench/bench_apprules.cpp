@@ -0,0 +1,115 @@
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTest>
+#include "apprules.h"
+#include "foregroundapp.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 程序规则: 配置 N 条规则(按进程名、按类名、限定热键的各占一部分), 测量按下热键时的
+ * 规则匹配(索引/逐条比较)与前台窗口查询(命中缓存/不经缓存)的耗时.
+ *
+ * N 默认 500; 可由环境变量 TIMESTAMPHOTKEY_RULES 调整. 前台窗口两项只在 Windows 上有意义.
+ */
+class BenchAppRules : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void match_data();
+    void match();
+    void foreground_data();
+    void foreground();
+
+private:
+    QKeySequence m_shortcut{QStringLiteral("Ctrl+`")};
+    AppRules m_rules;
+    QVector<ForegroundApp::Window> m_windows;
+};
+
+void BenchAppRules::initTestCase()
+{
+    int count = 500;
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_RULES"))
+        count = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_RULES"));
+
+    QJsonArray config;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject rule;
+        if (i % 2 == 0)
+            rule.insert("process", QString("App%1.exe").arg(i));
+        else
+            rule.insert("class", QString("Class%1").arg(i));
+        if (i % 5 == 0)
+            rule.insert("shortcut", "Ctrl+Shift+`");
+        rule.insert("format", TimestampFormatter::IsoPattern);
+        config.append(rule);
+    }
+    QString error;
+    QVERIFY2(AppRules::parse(config, m_rules, &error), qPrintable(error));
+
+    // 一半的窗口能匹配到规则
+    m_windows.resize(256);
+    for (int i = 0; i < m_windows.size(); ++i) {
+        const int target = (i * 7919) % (count * 2);
+        m_windows[i].process = QString("app%1.exe").arg(target);
+        m_windows[i].windowClass = QString("class%1").arg(target + 1);
+    }
+}
+
+void BenchAppRules::match_data()
+{
+    QTest::addColumn<bool>("linear");
+    QTest::newRow("indexed") << false;
+    QTest::newRow("linear") << true;
+}
+
+void BenchAppRules::match()
+{
+    QFETCH(bool, linear);
+    int matched = 0;
+    QBENCHMARK {
+        matched = 0;
+        for (const ForegroundApp::Window &window : std::as_const(m_windows)) {
+            if (!linear) {
+                matched += m_rules.match(window, m_shortcut) != nullptr;
+                continue;
+            }
+            for (const AppRules::Rule &rule : m_rules.rules()) {
+                if ((rule.process.isEmpty() || rule.process == window.process)
+                    && (rule.windowClass.isEmpty() || rule.windowClass == window.windowClass)
+                    && (rule.shortcut.isEmpty() || rule.shortcut == m_shortcut)) {
+                    ++matched;
+                    break;
+                }
+            }
+        }
+    }
+    QVERIFY(matched > 0);
+}
+
+void BenchAppRules::foreground_data()
+{
+    QTest::addColumn<bool>("cached");
+    QTest::newRow("cached") << true;
+    QTest::newRow("query") << false;
+}
+
+void BenchAppRules::foreground()
+{
+    QFETCH(bool, cached);
+    ForegroundApp *foreground = ForegroundApp::instance();
+    foreground->setTracking(cached);
+    int found = 0;
+    QBENCHMARK {
+        found += cached ? !foreground->current().process.isEmpty() : !ForegroundApp::query().process.isEmpty();
+    }
+    foreground->setTracking(false);
+    Q_UNUSED(found)
+}
+
+REGISTER_TEST(BenchAppRules)
+
+#include "bench_apprules.moc"
@@ -0,0 +1,99 @@
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTest>
+#include <algorithm>
+#include <qhotkey.h>
+#include "chordmatcher.h"
+#include "clocksource.h"
+#include "testregistry.h"
+
+/**
+ * 多段热键增加的延迟: 单段热键从 postNativeEvent 到 matched 的耗时, 与两段热键中第二段
+ * 从送入到 matched 的耗时(第一段按下后等匹配器进入等待再送入, 不计入)比较.
+ * 第二段需先在临时注册的后续热键中查找, 再从前缀树的下一层取值.
+ *
+ * 每行按 N 次, 默认 1000; 可由环境变量 TIMESTAMPHOTKEY_CHORD_PRESSES 调整.
+ */
+class BenchChordMatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void pressToMatched_data();
+    void pressToMatched();
+    void cleanupTestCase();
+
+private:
+    int m_presses = 1000;
+    qint64 m_singleMedianNs = 0;
+};
+
+void BenchChordMatcher::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_CHORD_PRESSES"))
+        m_presses = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_CHORD_PRESSES"));
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+void BenchChordMatcher::pressToMatched_data()
+{
+    QTest::addColumn<QString>("shortcut");
+    // 第一行作为基准
+    QTest::newRow("single chord") << QString("Ctrl+`");
+    QTest::newRow("second stroke") << QString("Ctrl+`, D");
+}
+
+void BenchChordMatcher::pressToMatched()
+{
+    QFETCH(QString, shortcut);
+    const QKeySequence sequence(shortcut, QKeySequence::PortableText);
+    ChordTrie trie;
+    trie.insert(sequence, 1);
+    ChordMatcher matcher;
+    matcher.setTrie(trie);
+    QVERIFY(matcher.failedShortcuts().isEmpty());
+
+    QVector<QHotkey::NativeShortcut> strokes;
+    for (int i = 0; i < sequence.count(); ++i) {
+        const int chord = ChordTrie::chordAt(sequence, i);
+        const QHotkey hotkey(Qt::Key(chord & ~Qt::KeyboardModifierMask), Qt::KeyboardModifiers(chord & Qt::KeyboardModifierMask));
+        strokes.append(hotkey.currentNativeShortcut());
+    }
+
+    QEventLoop loop;
+    connect(&matcher, &ChordMatcher::matched, &loop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    QVector<qint64> latencies;
+    latencies.reserve(m_presses);
+    for (int i = 0; i < m_presses; ++i) {
+        for (int stroke = 0; stroke + 1 < strokes.size(); ++stroke) {
+            QHotkey::postNativeEvent(strokes.at(stroke));
+            QVERIFY(QTest::qWaitFor([&matcher]() { return matcher.isPending(); }, 1000));
+        }
+        timer.start();
+        QHotkey::postNativeEvent(strokes.last());
+        loop.exec();
+        latencies.append(timer.nsecsElapsed());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const qint64 medianNs = latencies.at(latencies.size() / 2);
+    const qint64 p99Ns = latencies.at(latencies.size() * 99 / 100);
+    if (sequence.count() == 1)
+        m_singleMedianNs = medianNs;
+    qInfo("送入到 matched 中位数 %.1f us, p99 %.1f us, 比单段多 %.1f us; 匹配器记录的末段按下到匹配 %.1f us",
+          medianNs / 1000.0, p99Ns / 1000.0, (medianNs - m_singleMedianNs) / 1000.0, matcher.lastMatchLatencyNs() / 1000.0);
+    QTest::setBenchmarkResult(medianNs / 1000000.0, QTest::WalltimeMilliseconds);
+}
+
+void BenchChordMatcher::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(BenchChordMatcher)
+
+#include "bench_chordmatcher.moc"
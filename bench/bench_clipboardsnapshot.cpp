@@ -0,0 +1,91 @@
+#include <QClipboard>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QImage>
+#include <QTest>
+#include <algorithm>
+#include <cmath>
+#include "clipboardsnapshot.h"
+#include "pastesequence.h"
+#include "testregistry.h"
+
+/**
+ * 恢复剪贴板的代价: 剪贴板中放一张约 N MB 的图片, 分别在关闭与打开恢复时写入时间戳,
+ * 测量从开始写入到剪贴板就绪的耗时(即按下热键到可以粘贴), 打开时图片须被原样放回.
+ *
+ * N 默认 50; 可由环境变量 TIMESTAMPHOTKEY_RESTORE_MB 调整.
+ */
+class BenchClipboardSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void writeToReady_data();
+    void writeToReady();
+
+private:
+    QImage m_image;
+};
+
+void BenchClipboardSnapshot::initTestCase()
+{
+    int megabytes = 50;
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_RESTORE_MB"))
+        megabytes = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_RESTORE_MB"));
+    const int side = int(std::sqrt(double(megabytes) * 1024 * 1024 / 4));
+    m_image = QImage(side, side, QImage::Format_ARGB32);
+    m_image.fill(QColor(70, 130, 180));
+}
+
+void BenchClipboardSnapshot::writeToReady_data()
+{
+    QTest::addColumn<bool>("restore");
+    QTest::newRow("no restore") << false;
+    QTest::newRow("restore") << true;
+}
+
+void BenchClipboardSnapshot::writeToReady()
+{
+    QFETCH(bool, restore);
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    PasteSequence sequence;
+    sequence.setRestoreClipboard(restore);
+    QEventLoop loop;
+    QElapsedTimer timer;
+    qint64 readyNs = 0;
+    connect(&sequence, &PasteSequence::clipboardReady, &sequence, [&]() { readyNs = timer.nsecsElapsed(); });
+    connect(&sequence, &PasteSequence::finished, &loop, &QEventLoop::quit);
+
+    // 每轮之前重新放入图片, 只计写入到就绪; 取中位数
+    const int runs = 10;
+    QVector<qint64> samples;
+    for (int i = 0; i < runs; ++i) {
+        // 先取下再放回一次, 让剪贴板持有原生格式的数据, 与从其他程序复制来的图片一样
+        clipboard->setImage(m_image);
+        ClipboardSnapshot seed;
+        if (seed.capture())
+            seed.restore();
+
+        timer.start();
+        sequence.run(QString("restore-bench #%1").arg(i), false);
+        if (sequence.isRunning())
+            loop.exec();
+        samples.append(readyNs);
+        if (restore)
+            QCOMPARE(clipboard->image().size(), m_image.size());
+    }
+    std::sort(samples.begin(), samples.end());
+    QTest::setBenchmarkResult(samples.at(runs / 2) / 1000000.0, QTest::WalltimeMilliseconds);
+    if (restore) {
+        const PasteSequence::Stats stats = sequence.stats();
+        QCOMPARE(stats.restored, quint64(runs));
+        qInfo("保存原有内容 %.2f ms (%lld MB)", stats.lastCaptureNs / 1000000.0, stats.lastCaptureBytes / (1024 * 1024));
+    }
+}
+
+REGISTER_TEST(BenchClipboardSnapshot)
+
+#include "bench_clipboardsnapshot.moc"
@@ -0,0 +1,41 @@
+#include <QTest>
+#include "clocksource.h"
+#include "testregistry.h"
+
+/**
+ * 各时钟源单次读取的耗时; 操作系统声明的分辨率与实际观察到的步进一并输出
+ */
+class BenchClockSource : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void nowNs_data();
+    void nowNs();
+};
+
+void BenchClockSource::nowNs_data()
+{
+    QTest::addColumn<int>("kind");
+    for (ClockSource::Kind kind : ClockSource::available())
+        QTest::newRow(qPrintable(ClockSource::kindName(kind))) << int(kind);
+}
+
+void BenchClockSource::nowNs()
+{
+    QFETCH(int, kind);
+    const ClockSource *source = ClockSource::get(ClockSource::Kind(kind));
+    const ClockSource::Stats stats = source->measure(1000000);
+    qInfo("%s: 标称分辨率 %lld ns, 实际步进 %lld ns", qPrintable(source->name()), source->nominalResolutionNs(),
+          stats.granularityNs);
+
+    qint64 sink = 0;
+    QBENCHMARK {
+        sink += source->nowNs();
+    }
+    QVERIFY(sink != 0);
+}
+
+REGISTER_TEST(BenchClockSource)
+
+#include "bench_clocksource.moc"
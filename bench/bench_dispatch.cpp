@@ -0,0 +1,90 @@
+#include <QEventLoop>
+#include <QTest>
+#include <memory>
+#include <qhotkey.h>
+#include <vector>
+#include "clocksource.h"
+#include "testregistry.h"
+
+/**
+ * 热键分发延迟: 从原生按键进入监听线程的事件队列, 到 GUI 线程中的接收方收到 activated.
+ * 无头模式, 按键由 postNativeEvent 送入; 另注册若干不相干的热键, 看查找表大小的影响
+ */
+class BenchDispatch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void postToSlot_data();
+    void postToSlot();
+    void stampToSlot();
+    void cleanupTestCase();
+};
+
+void BenchDispatch::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+void BenchDispatch::postToSlot_data()
+{
+    QTest::addColumn<int>("registered");
+    QTest::newRow("1") << 1;
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+}
+
+void BenchDispatch::postToSlot()
+{
+    QFETCH(int, registered);
+    std::vector<std::unique_ptr<QHotkey>> others;
+    for (int i = 1; i < registered; ++i)
+        others.emplace_back(new QHotkey(QHotkey::NativeShortcut(0x1000 + i, 0x2), true));
+
+    const QHotkey::NativeShortcut shortcut(0x41, 0x2);
+    QHotkey hotkey(shortcut, true);
+    QEventLoop loop;
+    connect(&hotkey, &QHotkey::activated, &loop, &QEventLoop::quit);
+
+    QBENCHMARK {
+        QHotkey::postNativeEvent(shortcut);
+        loop.exec();
+    }
+}
+
+void BenchDispatch::stampToSlot()
+{
+    // 按下时刻(监听线程记录的时间戳)到接收方执行的间隔, 即 GUI 线程空闲时的排队延迟
+    const QHotkey::NativeShortcut shortcut(0x41, 0x2);
+    QHotkey hotkey(shortcut, true);
+    QEventLoop loop;
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+    int presses = 0;
+    connect(&hotkey, &QHotkey::activated, &loop, [&](qint64 timestampNs) {
+        const qint64 delayNs = ClockSource::current()->nowNs() - timestampNs;
+        totalNs += delayNs;
+        maxNs = qMax(maxNs, delayNs);
+        ++presses;
+        loop.quit();
+    });
+
+    QBENCHMARK {
+        QHotkey::postNativeEvent(shortcut);
+        loop.exec();
+    }
+    qInfo("按下到接收方 平均 %.1f us, 最大 %.1f us (%d 次)", totalNs / 1000.0 / qMax(1, presses), maxNs / 1000.0, presses);
+}
+
+void BenchDispatch::cleanupTestCase()
+{
+    // 过滤器回到 GUI 线程, 后续的测试类在自己的线程上调用它
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(BenchDispatch)
+
+#include "bench_dispatch.moc"
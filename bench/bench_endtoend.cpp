@@ -0,0 +1,154 @@
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QLineEdit>
+#include <QProcess>
+#include <QScopeGuard>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <algorithm>
+#include "hotkeyprofile.h"
+#include "pastesequence.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+/**
+ * 端到端粘贴: 以临时配置与历史目录另起一个托盘程序实例(TIMESTAMPHOTKEY_APP, 由构建给出),
+ * 在本进程中放一个探测输入框并置于前台, 用 SendInput 按下 Ctrl+`, 记录从按下到输入框内容
+ * 变化的耗时. 经过真实的热键后端、剪贴板与按键注入, 任何一环变慢或出错都会反映在结果中.
+ * 每次等宏发送完 Ctrl+A/Ctrl+C 后检查内容: 不是一个时间戳或与按下时刻相差超过 1 秒的计为错误,
+ * 比一个时间戳长的计为重复粘贴, 超时未变化的计为丢失; 三者都须为 0.
+ *
+ * 仅 Windows, 需要可交互的桌面且没有其他实例占用 Ctrl+`. 按下次数默认 1000,
+ * 可由环境变量 TIMESTAMPHOTKEY_E2E_PRESSES 调整.
+ */
+class BenchEndToEnd : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void pressToText();
+};
+
+void BenchEndToEnd::pressToText()
+{
+#ifdef Q_OS_WIN
+    int iterations = 1000;
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_E2E_PRESSES"))
+        iterations = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_E2E_PRESSES"));
+
+    const QString pattern = QString::fromLatin1(TimestampFormatter::DefaultPattern);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString profilePath = dir.filePath("profile.json");
+    QVERIFY(HotkeyProfile::writeDefault(profilePath));
+
+    QProcess app;
+    app.start(QStringLiteral(TIMESTAMPHOTKEY_APP), {"--profile", profilePath, "--history", dir.filePath("history")});
+    QVERIFY2(app.waitForStarted(), qPrintable(app.errorString()));
+    auto stopApp = qScopeGuard([&app]() {
+        app.kill();
+        app.waitForFinished();
+    });
+
+    QLineEdit probe;
+    probe.setWindowTitle("端到端粘贴探测");
+    probe.resize(400, 40);
+    probe.show();
+
+    QEventLoop loop;
+    QTimer deadline;
+    deadline.setSingleShot(true);
+    connect(&deadline, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QElapsedTimer timer;
+    qint64 changedNs = -1;
+    connect(&probe, &QLineEdit::textChanged, &probe, [&](const QString &text) {
+        if (changedNs < 0 && !text.isEmpty()) {
+            changedNs = timer.nsecsElapsed();
+            loop.quit();
+        }
+    });
+    auto wait = [&](int ms) {
+        deadline.start(ms);
+        loop.exec();
+        deadline.stop();
+    };
+
+    // 返回内容变化的耗时, 未变化为 -1; 之后等宏发送完其余组合键
+    auto press = [&](int timeoutMs) {
+        probe.clear();
+        const HWND window = HWND(probe.winId());
+        if (GetForegroundWindow() != window) {
+            SetForegroundWindow(window);
+            wait(50);
+        }
+        INPUT inputs[4] = {};
+        const WORD keys[4] = {VK_CONTROL, VK_OEM_3, VK_OEM_3, VK_CONTROL};
+        for (int i = 0; i < 4; ++i) {
+            inputs[i].type = INPUT_KEYBOARD;
+            inputs[i].ki.wVk = keys[i];
+            inputs[i].ki.dwFlags = i < 2 ? 0 : KEYEVENTF_KEYUP;
+        }
+        changedNs = -1;
+        timer.start();
+        SendInput(4, inputs, sizeof(INPUT));
+        wait(timeoutMs);
+        wait(2 * PasteSequence::KeyIntervalMs + 150);
+        return changedNs;
+    };
+
+    // 等被测程序注册好热键
+    bool ready = false;
+    for (int attempt = 0; attempt < 20 && !ready; ++attempt) {
+        wait(500);
+        ready = press(1000) >= 0;
+    }
+    QVERIFY2(ready, "被测程序没有响应 Ctrl+`, 请先退出正在运行的实例");
+
+    QVector<qint64> latencies;
+    latencies.reserve(iterations);
+    int missed = 0;
+    int wrong = 0;
+    int duplicated = 0;
+    QString previous;
+    for (int i = 0; i < iterations; ++i) {
+        const qint64 pressMs = QDateTime::currentMSecsSinceEpoch();
+        const qint64 latencyNs = press(2000);
+        const QString text = probe.text();
+        if (latencyNs < 0) {
+            ++missed;
+            continue;
+        }
+        latencies.append(latencyNs);
+        const QDateTime stamp = QDateTime::fromString(text.left(pattern.size()), pattern);
+        if (text.size() > pattern.size())
+            ++duplicated;
+        else if (!stamp.isValid() || qAbs(stamp.toMSecsSinceEpoch() - pressMs) > 1000 || text == previous)
+            ++wrong;
+        previous = text;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto ms = [&](int permille) {
+        return latencies.isEmpty() ? 0.0
+                                   : latencies.at(qMin(latencies.size() - 1, latencies.size() * permille / 1000)) / 1000000.0;
+    };
+    qInfo("%d 次按下: 丢失 %d, 内容错误 %d, 重复粘贴 %d", iterations, missed, wrong, duplicated);
+    qInfo("按下到出现 中位数 %.2f ms, p90 %.2f ms, p99 %.2f ms, 最大 %.2f ms", ms(500), ms(900), ms(990), ms(1000));
+    QTest::setBenchmarkResult(ms(500), QTest::WalltimeMilliseconds);
+    QCOMPARE(missed, 0);
+    QCOMPARE(wrong, 0);
+    QCOMPARE(duplicated, 0);
+#else
+    QSKIP("端到端测试需要 Windows 的热键后端与 SendInput");
+#endif
+}
+
+REGISTER_TEST(BenchEndToEnd)
+
+#include "bench_endtoend.moc"
@@ -0,0 +1,128 @@
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QTest>
+#include <limits>
+#include "clocksource.h"
+#include "historymerger.h"
+#include "stamphistory.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 历史归并: 每台机器各自按随机间隔生成有序的历史(起点错开, 区间大部分重叠),
+ * 再整体归并, 输出吞吐与峰值内存, 检查条数与输出顺序.
+ * 生成输入本身会推高本进程的峰值, 因此分两行: 本进程内归并(Linux 上先重置峰值, 报告归并期间的增量),
+ * 与另起只做归并的 TimestampHotkey_cli --merge-history(由构建给出路径), 其峰值只属于归并.
+ *
+ * 默认 200 台 x 1000 万条, 约需 10 GB 临时磁盘空间; 可由环境变量
+ * TIMESTAMPHOTKEY_MERGE_HOSTS 与 TIMESTAMPHOTKEY_MERGE_ENTRIES 调小.
+ */
+class BenchHistoryMerger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void merge_data();
+    void merge();
+
+private:
+    QTemporaryDir m_dir;
+    QList<HistoryMerger::Input> m_inputs;
+    int m_hosts = 200;
+    qint64 m_entries = 10000000;
+};
+
+void BenchHistoryMerger::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_MERGE_HOSTS"))
+        m_hosts = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_MERGE_HOSTS"));
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_MERGE_ENTRIES"))
+        m_entries = qMax<qint64>(1, qgetenv("TIMESTAMPHOTKEY_MERGE_ENTRIES").toLongLong());
+    QVERIFY(m_dir.isValid());
+
+    const QString formats[] = {TimestampFormatter::DefaultPattern, "yyyy-MM-dd", TimestampFormatter::IsoPattern};
+    const QString sources[] = {"Ctrl+`", "Ctrl+Shift+`", "Ctrl+`, D"};
+    const qint64 baseNs = ClockSource::current()->nowNs() - m_entries * 5000000000ll;
+    QElapsedTimer timer;
+    timer.start();
+    for (int host = 0; host < m_hosts; ++host) {
+        const QString name = QString("host%1").arg(host, 3, 10, QLatin1Char('0'));
+        StampHistory history(m_dir.filePath(name));
+        QString error;
+        QVERIFY2(history.open(&error), qPrintable(error));
+        history.setWriteAheadLog(false);
+        quint64 random = 88172645463325252ull + quint64(host) * 7919;
+        qint64 timeNs = baseNs + host * 1000000000ll;
+        for (qint64 i = 0; i < m_entries; ++i) {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            timeNs += 1000000 + qint64(random % 10000000000ull);
+            history.append(timeNs, formats[random % 3], sources[(random >> 8) % 3]);
+        }
+        history.compact();
+        history.waitForCompaction();
+        m_inputs.append({name, history.directory()});
+    }
+    qInfo("生成 %d x %lld 条, %lld s", m_hosts, m_entries, timer.elapsed() / 1000);
+}
+
+void BenchHistoryMerger::merge_data()
+{
+    QTest::addColumn<bool>("childProcess");
+    QTest::newRow("in process") << false;
+    QTest::newRow("cli process") << true;
+}
+
+void BenchHistoryMerger::merge()
+{
+    QFETCH(bool, childProcess);
+    const QString outputDir = m_dir.filePath(childProcess ? "merged-cli" : "merged");
+
+    if (childProcess) {
+        QStringList arguments{"--merge-history", outputDir};
+        for (const HistoryMerger::Input &input : std::as_const(m_inputs))
+            arguments.append(input.host + QLatin1Char('=') + input.directory);
+        QProcess cli;
+        cli.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        QBENCHMARK_ONCE {
+            cli.start(QStringLiteral(TIMESTAMPHOTKEY_CLI), arguments);
+            QVERIFY2(cli.waitForFinished(-1), qPrintable(cli.errorString()));
+        }
+        QCOMPARE(cli.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(cli.exitCode(), 0);
+        qInfo("%s", cli.readAllStandardOutput().trimmed().constData());
+    } else {
+        StampHistory output(outputDir);
+        HistoryMerger merger(m_inputs);
+        QString error;
+        QVERIFY2(output.open(&error), qPrintable(error));
+        bool merged = false;
+        QBENCHMARK_ONCE {
+            merged = merger.merge(&output, &error);
+        }
+        QVERIFY2(merged, qPrintable(error));
+        qInfo("%s", qPrintable(HistoryMerger::formatStats(merger.stats())));
+    }
+
+    // 各段内有序且段与段首尾相接时, 全量查询的时间单调不减
+    StampHistory output(outputDir);
+    QString error;
+    QVERIFY2(output.open(&error), qPrintable(error));
+    qint64 previousNs = std::numeric_limits<qint64>::min();
+    qint64 disorder = 0;
+    const qint64 total = output.query(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                                      [&](qint64 timeNs, const QString &, const QString &) {
+                                          if (timeNs < previousNs)
+                                              ++disorder;
+                                          previousNs = timeNs;
+                                      });
+    QCOMPARE(total, qint64(m_hosts) * m_entries);
+    QCOMPARE(disorder, qint64(0));
+}
+
+REGISTER_TEST(BenchHistoryMerger)
+
+#include "bench_historymerger.moc"
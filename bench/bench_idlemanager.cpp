@@ -0,0 +1,91 @@
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <algorithm>
+#include "clocksource.h"
+#include "idlemanager.h"
+#include "stamphistory.h"
+#include "testregistry.h"
+#include "timewindow.h"
+#include "worldclock.h"
+
+/**
+ * 空闲释放: 与托盘程序相同, 时间窗口按需创建, IdleManager 判定空闲后销毁窗口并 releaseMemory().
+ * 每轮显示窗口(到窗口可见为止计时), 关闭后等空闲, 记录释放前后的常驻内存;
+ * 输出首次显示与空闲后重建显示的耗时, 以及每次空闲归还的内存.
+ * 多轮之后空闲时的内存应回到首轮空闲时附近, 不随轮数增长.
+ *
+ * 默认 20 轮; 可由环境变量 TIMESTAMPHOTKEY_IDLE_ROUNDS 调整.
+ */
+class BenchIdleManager : public QObject
+{
+    Q_OBJECT
+
+    // 空闲判定等待的毫秒数, 托盘程序默认 300 s, 这里缩短
+    static constexpr int IdleTimeoutMs = 50;
+
+private slots:
+    void releaseAndReshow();
+};
+
+void BenchIdleManager::releaseAndReshow()
+{
+    int rounds = 20;
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_IDLE_ROUNDS"))
+        rounds = qMax(2, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_IDLE_ROUNDS"));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StampHistory history(dir.filePath("history"));
+    QString error;
+    QVERIFY2(history.open(&error), qPrintable(error));
+    const qint64 nowNs = ClockSource::current()->nowNs();
+    for (int i = 0; i < 10000; ++i)
+        history.append(nowNs - qint64(i) * 60000000000ll, TimestampFormatter::DefaultPattern, "Ctrl+`");
+    WorldClock worldClock(WorldClock::defaultZones());
+
+    QPointer<TimeWindow> timeWindow;
+    IdleManager idleManager(IdleTimeoutMs);
+    QVector<qint64> releasedBytes;
+    QVector<qint64> idleRss;
+    connect(&idleManager, &IdleManager::idle, this, [&]() {
+        const qint64 shownRss = IdleManager::memoryUsage().currentRss;
+        delete timeWindow;
+        IdleManager::releaseMemory();
+        const qint64 rss = IdleManager::memoryUsage().currentRss;
+        releasedBytes.append(shownRss - rss);
+        idleRss.append(rss);
+    });
+
+    IdleManager::releaseMemory();
+    const qint64 baseRss = IdleManager::memoryUsage().currentRss;
+    QVector<qint64> showNs;
+    QElapsedTimer timer;
+    for (int round = 0; round < rounds; ++round) {
+        timer.start();
+        timeWindow = new TimeWindow(&worldClock, &history);
+        timeWindow->show();
+        QVERIFY(QTest::qWaitForWindowExposed(timeWindow));
+        showNs.append(timer.nsecsElapsed());
+
+        timeWindow->hide();
+        idleManager.touch();
+        QVERIFY(QTest::qWaitFor([&timeWindow]() { return timeWindow.isNull(); }, IdleTimeoutMs + 5000));
+    }
+    QCOMPARE(idleRss.size(), rounds);
+
+    const qint64 firstShowNs = showNs.takeFirst();
+    std::sort(showNs.begin(), showNs.end());
+    std::sort(releasedBytes.begin(), releasedBytes.end());
+    const qint64 reshowMedianNs = showNs.at(showNs.size() / 2);
+    qInfo("首次显示 %.2f ms, 空闲后重建显示 中位数 %.2f ms; 每次空闲归还 中位数 %.1f MB",
+          firstShowNs / 1e6, reshowMedianNs / 1e6, releasedBytes.at(releasedBytes.size() / 2) / 1048576.0);
+    qInfo("空闲内存: 开始 %.1f MB, 首轮后 %.1f MB, 末轮后 %.1f MB",
+          baseRss / 1048576.0, idleRss.first() / 1048576.0, idleRss.last() / 1048576.0);
+    QTest::setBenchmarkResult(reshowMedianNs / 1e6, QTest::WalltimeMilliseconds);
+}
+
+REGISTER_TEST(BenchIdleManager)
+
+#include "bench_idlemanager.moc"
@@ -0,0 +1,157 @@
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimeZone>
+#include "logrestamper.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 日志时间戳转换: 合成的多 GB 日志(每行一个时间戳)转为 ISO 8601 的吞吐,
+ * 与 sed -E / gawk gensub 的正则替换对比. 脚本只做字段重排, 不校验日期也不换算时区,
+ * 对应 "固定偏移" 两行; 按时区一行额外做每个时间戳的偏移查表.
+ * 找不到 sed / gawk 的行跳过.
+ *
+ * 默认 2048 MB, 约需两倍的临时磁盘空间; 可由环境变量 TIMESTAMPHOTKEY_RESTAMP_MB 调小.
+ */
+class BenchLogRestamper : public QObject
+{
+    Q_OBJECT
+
+    static constexpr const char *StampRegex = "([0-9]{4})([0-9]{2})([0-9]{2})-([0-9]{2})([0-9]{2})([0-9]{2})([0-9]{3})";
+
+private slots:
+    void initTestCase();
+    void restamp_data();
+    void restamp();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_input;
+    qint64 m_bytes = 0;
+    qint64 m_stamps = 0;
+};
+
+void BenchLogRestamper::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    qint64 megabytes = 2048;
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_RESTAMP_MB"))
+        megabytes = qMax<qint64>(1, qgetenv("TIMESTAMPHOTKEY_RESTAMP_MB").toLongLong());
+
+    // 先生成约 1 MB 的行块, 时间戳按随机间隔递增, 再整块重复写到目标大小
+    const TimestampFormatter formatter;
+    const char *levels[] = {"INFO", "WARN", "DEBUG"};
+    QByteArray block;
+    qint64 blockStamps = 0;
+    quint64 random = 88172645463325252ull;
+    qint64 timeNs = 1735689600ll * 1000000000ll; // 2025-01-01
+    while (block.size() < 1024 * 1024) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        timeNs += qint64(random % 600000000000ull);
+        block += levels[random % 3];
+        block += " worker[";
+        block += QByteArray::number(int(random >> 8) % 64);
+        block += "] request ";
+        block += formatter.formatUtf8(timeNs, 0);
+        block += " handled in ";
+        block += QByteArray::number(int(random >> 16) % 1000);
+        block += " ms\n";
+        ++blockStamps;
+    }
+
+    m_input = m_dir.filePath("in.log");
+    QFile file(m_input);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QElapsedTimer timer;
+    timer.start();
+    while (m_bytes < megabytes * 1024 * 1024) {
+        QCOMPARE(file.write(block), qint64(block.size()));
+        m_bytes += block.size();
+        m_stamps += blockStamps;
+    }
+    file.close();
+    qInfo("生成 %lld MB, %lld 个时间戳, %lld s", m_bytes >> 20, m_stamps, timer.elapsed() / 1000);
+}
+
+void BenchLogRestamper::restamp_data()
+{
+    QTest::addColumn<QString>("tool");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<QByteArray>("zone");
+
+    QTest::newRow("restamper, fixed offset") << QString() << 0 << QByteArray();
+    QTest::newRow("restamper, fixed offset, 1 thread") << QString() << 1 << QByteArray();
+    QTest::newRow("restamper, Europe/Berlin") << QString() << 0 << QByteArray("Europe/Berlin");
+    QTest::newRow("sed -E") << "sed" << 1 << QByteArray();
+    QTest::newRow("gawk gensub") << "gawk" << 1 << QByteArray();
+}
+
+void BenchLogRestamper::restamp()
+{
+    QFETCH(QString, tool);
+    QFETCH(int, threads);
+    QFETCH(QByteArray, zone);
+
+    const QString output = m_dir.filePath("out.log");
+    QFile::remove(output);
+    // 18 字节的时间戳换成 29 字节的 ISO 8601; 按时区时偏移随夏令时变化, 长度不变
+    const qint64 expectedBytes = m_bytes + m_stamps * 11;
+    QElapsedTimer timer;
+
+    if (tool.isEmpty()) {
+        LogRestamper::Options options;
+        options.inputPath = m_input;
+        options.outputPath = output;
+        options.outputFormat = "iso";
+        options.threads = threads;
+        if (!zone.isEmpty()) {
+            if (!QTimeZone::isTimeZoneIdAvailable(zone))
+                QSKIP(qPrintable("时区不可用: " + QString::fromLatin1(zone)));
+            options.inputZone = QTimeZone(zone);
+            options.outputZone = QTimeZone(zone);
+        }
+        LogRestamper::Stats stats;
+        QString error;
+        bool ok = false;
+        QBENCHMARK_ONCE {
+            timer.start();
+            ok = LogRestamper(options).run(&stats, &error);
+        }
+        QVERIFY2(ok, qPrintable(error));
+        QCOMPARE(stats.stamps, m_stamps);
+    } else {
+        const QString program = QStandardPaths::findExecutable(tool);
+        if (program.isEmpty())
+            QSKIP(qPrintable("找不到 " + tool));
+        const QString replacement = tool == "sed" ? "\\1-\\2-\\3T\\4:\\5:\\6.\\7+00:00" : "\\\\1-\\\\2-\\\\3T\\\\4:\\\\5:\\\\6.\\\\7+00:00";
+        const QStringList arguments = tool == "sed"
+            ? QStringList{"-E", QString("s/%1/%2/g").arg(StampRegex, replacement)}
+            : QStringList{QString("{ print gensub(/%1/, \"%2\", \"g\") }").arg(StampRegex, replacement)};
+        QProcess process;
+        process.setStandardInputFile(m_input);
+        process.setStandardOutputFile(output);
+        QBENCHMARK_ONCE {
+            timer.start();
+            process.start(program, arguments);
+            QVERIFY(process.waitForFinished(-1));
+        }
+        QCOMPARE(process.exitStatus(), QProcess::NormalExit);
+        QCOMPARE(process.exitCode(), 0);
+    }
+
+    const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+    QCOMPARE(QFileInfo(output).size(), expectedBytes);
+    qInfo("%.2f GB/s", double(m_bytes) / elapsedMs / 1e6);
+    QFile::remove(output);
+}
+
+REGISTER_TEST(BenchLogRestamper)
+
+#include "bench_logrestamper.moc"
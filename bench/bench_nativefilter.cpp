@@ -0,0 +1,130 @@
+#include <QTest>
+#include <QVector>
+#include <qhotkey.h>
+#include "testregistry.h"
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+/**
+ * 原生事件过滤器压力测试: 以鼠标移动为主、不含 WM_HOTKEY 的模拟消息流, 比较原先的过滤器
+ * (忽略事件类型, 一次比较 msg->message == WM_HOTKEY)与现在带计数、带计数并计时的过滤器
+ * 拒绝非热键消息的开销. 拒绝路径原本就只有一次整数比较, 这里衡量的是加上计数后的代价.
+ * 接受路径(WM_HOTKEY)另行测量, 之后等释放轮询清空按住状态, 不影响后续测试的等待松开.
+ *
+ * 过滤器须在其所属线程调用: 开始前停止监听线程, 让过滤器回到本线程.
+ * 每次迭代处理 Events 条消息; 过滤器只在 Windows 上有实际实现
+ */
+class BenchNativeFilter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void reject_data();
+    void reject();
+    void accept();
+    void cleanupTestCase();
+
+private:
+    static constexpr int Events = 100000;
+    static constexpr int Hotkeys = 1000;
+
+#ifdef Q_OS_WIN
+    QVector<MSG> m_messages;
+#endif
+};
+
+void BenchNativeFilter::initTestCase()
+{
+#ifdef Q_OS_WIN
+    if (QHotkey::listenerThread())
+        QHotkey::stopListenerThread();
+    static const UINT flood[] = {WM_MOUSEMOVE, WM_MOUSEMOVE, WM_MOUSEMOVE, WM_PAINT, WM_TIMER,
+                                 WM_NCHITTEST, WM_SETCURSOR, WM_CLIPBOARDUPDATE};
+    m_messages.resize(Events);
+    for (int i = 0; i < Events; ++i) {
+        MSG &msg = m_messages[i];
+        msg = MSG();
+        msg.message = flood[i % 8];
+        msg.lParam = MAKELPARAM(0, 0);
+    }
+#else
+    QSKIP("原生事件过滤器压力测试仅支持 Windows");
+#endif
+}
+
+void BenchNativeFilter::reject_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("original filter") << 0;
+    QTest::newRow("counted") << 1;
+    QTest::newRow("counted, timed") << 2;
+}
+
+void BenchNativeFilter::reject()
+{
+#ifdef Q_OS_WIN
+    QFETCH(int, mode);
+    const QByteArray eventType("windows_dispatcher_MSG");
+    if (mode == 0) {
+        // 原先 QHotkeyPrivateWin::nativeEventFilter 的判断: 事件类型不看, 只比较消息号
+        qint64 accepted = 0;
+        QBENCHMARK {
+            for (const MSG &msg : std::as_const(m_messages)) {
+                if (msg.message == WM_HOTKEY)
+                    ++accepted;
+            }
+        }
+        QCOMPARE(accepted, qint64(0));
+        return;
+    }
+
+    QHotkey::setNativeFilterTiming(mode == 2);
+    QHotkey::resetNativeFilterStats();
+    QBENCHMARK {
+        for (MSG &msg : m_messages)
+            QHotkey::filterNativeEvent(eventType, &msg);
+    }
+    const QHotkey::FilterStats stats = QHotkey::nativeFilterStats();
+    QHotkey::setNativeFilterTiming(false);
+    QCOMPARE(stats.eventsSeen % Events, quint64(0));
+    QCOMPARE(stats.eventsAccepted, quint64(0));
+    if (mode == 2)
+        qInfo("过滤器内 %.2f ns/条", double(stats.filterNs) / qMax<quint64>(1, stats.eventsSeen));
+#endif
+}
+
+void BenchNativeFilter::accept()
+{
+#ifdef Q_OS_WIN
+    // 没有按下的键: 释放轮询下一次即判为松开
+    MSG msg = MSG();
+    msg.message = WM_HOTKEY;
+    msg.lParam = MAKELPARAM(0, VK_F24);
+    const QByteArray eventType("windows_dispatcher_MSG");
+    QHotkey::setNativeFilterTiming(true);
+    QHotkey::resetNativeFilterStats();
+    for (int i = 0; i < Hotkeys; ++i) {
+        msg.time = GetTickCount();
+        QHotkey::filterNativeEvent(eventType, &msg);
+    }
+    const QHotkey::FilterStats stats = QHotkey::nativeFilterStats();
+    QHotkey::setNativeFilterTiming(false);
+    QCOMPARE(stats.eventsAccepted, quint64(Hotkeys));
+    qInfo("接受 WM_HOTKEY %.2f ns/条", double(stats.filterNs) / Hotkeys);
+    QTest::setBenchmarkResult(double(stats.filterNs) / Hotkeys / 1000000.0, QTest::WalltimeMilliseconds);
+
+    QVERIFY(QTest::qWaitFor([]() { return QHotkey::heldShortcutCount() == 0; }, 1000));
+#endif
+}
+
+void BenchNativeFilter::cleanupTestCase()
+{
+    QHotkey::setNativeFilterTiming(false);
+}
+
+REGISTER_TEST(BenchNativeFilter)
+
+#include "bench_nativefilter.moc"
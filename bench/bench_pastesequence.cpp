@@ -0,0 +1,49 @@
+#include <QClipboard>
+#include <QEventLoop>
+#include <QGuiApplication>
+#include <QTest>
+#include "pastesequence.h"
+#include "testregistry.h"
+
+/**
+ * 剪贴板从写入到可以粘贴的耗时: 等 dataChanged 且读回一致(PasteSequence 的 "copy" 宏),
+ * 与原先写入后固定等待 125 ms 比较. 在 Xvfb 等真实平台上运行才有意义, offscreen 平台的
+ * 剪贴板是进程内的
+ */
+class BenchPasteSequence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void handshake();
+    void fixedDelay();
+};
+
+void BenchPasteSequence::handshake()
+{
+    PasteSequence sequence;
+    QEventLoop loop;
+    connect(&sequence, &PasteSequence::finished, &loop, &QEventLoop::quit);
+
+    int i = 0;
+    QBENCHMARK {
+        sequence.run(QString("stamp #%1").arg(i++), false);
+        if (sequence.isRunning())
+            loop.exec();
+    }
+    QCOMPARE(sequence.stats().stale, quint64(0));
+}
+
+void BenchPasteSequence::fixedDelay()
+{
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    int i = 0;
+    QBENCHMARK {
+        clipboard->setText(QString("stamp #%1").arg(i++));
+        QTest::qWait(125);
+    }
+}
+
+REGISTER_TEST(BenchPasteSequence)
+
+#include "bench_pastesequence.moc"
@@ -0,0 +1,111 @@
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include "clocksource.h"
+#include "stamphistory.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 时间戳历史: 写入 N 条模拟历史(间隔 1 ms 至 10 s, 3 种格式与来源)并封存,
+ * 输出压缩比与写入耗时, 再测全量扫描、1 小时区间计数与 1 小时区间解码.
+ *
+ * N 默认 1 亿条, 约需 1 GB 临时磁盘空间与数分钟; 可由环境变量
+ * TIMESTAMPHOTKEY_HISTORY_ENTRIES 调小.
+ */
+class BenchStampHistory : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fullScan();
+    void hourCount();
+    void hourQuery();
+    void cleanupTestCase();
+
+private:
+    qint64 m_entries = 100000000;
+    qint64 m_startNs = 0;
+    qint64 m_endNs = 0;
+    QScopedPointer<QTemporaryDir> m_dir;
+    QScopedPointer<StampHistory> m_history;
+};
+
+void BenchStampHistory::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_HISTORY_ENTRIES"))
+        m_entries = qMax<qint64>(1, qgetenv("TIMESTAMPHOTKEY_HISTORY_ENTRIES").toLongLong());
+
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+    m_history.reset(new StampHistory(m_dir->path()));
+    QString error;
+    QVERIFY2(m_history->open(&error), qPrintable(error));
+
+    const QString formats[] = {TimestampFormatter::DefaultPattern, "yyyy-MM-dd", TimestampFormatter::IsoPattern};
+    const QString sources[] = {"Ctrl+`", "Ctrl+Shift+`", "Ctrl+`, D"};
+    quint64 random = 88172645463325252ull;
+    qint64 timeNs = ClockSource::current()->nowNs() - m_entries * 5000000000ll;
+    m_startNs = timeNs;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < m_entries; ++i) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        timeNs += 1000000 + qint64(random % 10000000000ull);
+        m_history->append(timeNs, formats[random % 3], sources[(random >> 8) % 3]);
+    }
+    m_history->compact();
+    m_history->waitForCompaction();
+    m_endNs = timeNs + 1;
+
+    const StampHistory::Stats stats = m_history->stats();
+    qInfo("%lld 条, %lld 个段, 原始 %lld 字节, 段 %lld 字节, 压缩比 %.2f; 写入并封存 %lld ms", stats.entries,
+          stats.segments, stats.rawBytes, stats.segmentBytes, double(stats.rawBytes) / qMax<qint64>(1, stats.segmentBytes),
+          timer.elapsed());
+    QCOMPARE(stats.segmentEntries, m_entries);
+}
+
+void BenchStampHistory::fullScan()
+{
+    qint64 scanned = 0;
+    QBENCHMARK_ONCE {
+        scanned = m_history->scanCount(m_startNs, m_endNs);
+    }
+    QCOMPARE(scanned, m_entries);
+}
+
+void BenchStampHistory::hourCount()
+{
+    const qint64 fromNs = m_startNs + (m_endNs - m_startNs) / 2;
+    qint64 counted = 0;
+    QBENCHMARK {
+        counted = m_history->count(fromNs, fromNs + 3600ll * 1000000000);
+    }
+    QCOMPARE(counted, m_history->scanCount(fromNs, fromNs + 3600ll * 1000000000));
+}
+
+void BenchStampHistory::hourQuery()
+{
+    const qint64 fromNs = m_startNs + (m_endNs - m_startNs) / 2;
+    qint64 visited = 0;
+    QBENCHMARK {
+        visited = m_history->query(fromNs, fromNs + 3600ll * 1000000000,
+                                   [](qint64, const QString &, const QString &) {});
+    }
+    QVERIFY(visited > 0);
+}
+
+void BenchStampHistory::cleanupTestCase()
+{
+    m_history.reset();
+    m_dir.reset();
+}
+
+REGISTER_TEST(BenchStampHistory)
+
+#include "bench_stamphistory.moc"
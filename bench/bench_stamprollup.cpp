@@ -0,0 +1,114 @@
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include "clocksource.h"
+#include "stamphistory.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 计数汇总: 生成 N 天、平均每 3 秒一条的历史(约每年 1000 万条), 测重新打开(读入汇总)
+ * 的耗时, 以及随机区间(最长 30 天)由汇总计数与逐条扫描的耗时; 两者结果须一致.
+ *
+ * N 默认 365 天; 可由环境变量 TIMESTAMPHOTKEY_ROLLUP_DAYS 调小.
+ */
+class BenchStampRollup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void reopen();
+    void rangeCount_data();
+    void rangeCount();
+    void cleanupTestCase();
+
+private:
+    static constexpr int Ranges = 200;
+
+    int m_days = 365;
+    qint64 m_startNs = 0;
+    qint64 m_spanNs = 0;
+    qint64 m_entries = 0;
+    qint64 m_rangeTotal = -1;
+    QScopedPointer<QTemporaryDir> m_dir;
+    QScopedPointer<StampHistory> m_history;
+};
+
+void BenchStampRollup::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_ROLLUP_DAYS"))
+        m_days = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_ROLLUP_DAYS"));
+
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+    m_spanNs = m_days * StampRollup::widthNs(StampRollup::Day);
+    m_startNs = ClockSource::current()->nowNs() - m_spanNs;
+
+    StampHistory history(m_dir->path());
+    QVERIFY(history.open());
+    quint64 random = 88172645463325252ull;
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 timeNs = m_startNs; timeNs < m_startNs + m_spanNs; ++m_entries) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        timeNs += 1000000 + qint64(random % 6000000000ull);
+        history.append(timeNs, TimestampFormatter::DefaultPattern, "Ctrl+`");
+    }
+    history.compact();
+    history.waitForCompaction();
+    qInfo("生成 %d 天 %lld 条, %lld ms", m_days, m_entries, timer.elapsed());
+}
+
+void BenchStampRollup::reopen()
+{
+    QBENCHMARK_ONCE {
+        m_history.reset(new StampHistory(m_dir->path()));
+        QVERIFY(m_history->openReadOnly());
+    }
+    QCOMPARE(m_history->count(m_startNs, m_startNs + 2 * m_spanNs), m_entries);
+}
+
+void BenchStampRollup::rangeCount_data()
+{
+    QTest::addColumn<bool>("scan");
+    QTest::newRow("rollup") << false;
+    QTest::newRow("scan") << true;
+}
+
+void BenchStampRollup::rangeCount()
+{
+    QFETCH(bool, scan);
+    QVERIFY(m_history);
+    const qint64 maxNs = 30 * StampRollup::widthNs(StampRollup::Day);
+    qint64 total = 0;
+    QBENCHMARK {
+        quint64 random = 2463534242ull;
+        total = 0;
+        for (int i = 0; i < Ranges; ++i) {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            const qint64 fromNs = m_startNs + qint64(random % quint64(m_spanNs));
+            const qint64 toNs = fromNs + qint64((random >> 16) % quint64(maxNs));
+            total += scan ? m_history->scanCount(fromNs, toNs) : m_history->count(fromNs, toNs);
+        }
+    }
+    // 两行用同一组区间, 合计须相同
+    if (m_rangeTotal < 0)
+        m_rangeTotal = total;
+    QCOMPARE(total, m_rangeTotal);
+}
+
+void BenchStampRollup::cleanupTestCase()
+{
+    m_history.reset();
+    m_dir.reset();
+}
+
+REGISTER_TEST(BenchStampRollup)
+
+#include "bench_stamprollup.moc"
@@ -0,0 +1,69 @@
+#include <QTemporaryDir>
+#include <QTest>
+#include <QThread>
+#include "clocksource.h"
+#include "stampsinks.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+namespace {
+
+/**
+ * 每次写入固定耗时 20 ms 的输出, 用于验证慢输出不会拖慢发布
+ */
+class SlowSink : public StampSink
+{
+public:
+    SlowSink() : StampSink(QStringLiteral("slow")) {}
+    bool write(const QVector<Stamp> &) override
+    {
+        QThread::msleep(20);
+        return true;
+    }
+};
+
+} // namespace
+
+/**
+ * 输出管线: 只有文件(组提交)与文件加一个慢输出时, publish 本身的耗时应当相同;
+ * 慢输出的队列满后丢弃, 各输出的写入/丢弃与延迟统计在结束时输出
+ */
+class BenchStampSinks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void publish_data();
+    void publish();
+};
+
+void BenchStampSinks::publish_data()
+{
+    QTest::addColumn<bool>("slow");
+    QTest::newRow("file") << false;
+    QTest::newRow("file + slow sink") << true;
+}
+
+void BenchStampSinks::publish()
+{
+    QFETCH(bool, slow);
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StampPipeline pipeline;
+    pipeline.addSink(new FileSink(dir.filePath("stamps.log")));
+    if (slow)
+        pipeline.addSink(new SlowSink, 16);
+
+    const TimestampFormatter formatter(TimestampFormatter::DefaultPattern);
+    const QString text = formatter.formatLocal(ClockSource::current()->nowNs());
+    QBENCHMARK {
+        pipeline.publish(text, 0, false);
+    }
+    pipeline.drain();
+    qInfo("%s", qPrintable(pipeline.report()));
+    QCOMPARE(pipeline.sinks().first()->counters().failed, quint64(0));
+}
+
+REGISTER_TEST(BenchStampSinks)
+
+#include "bench_stampsinks.moc"
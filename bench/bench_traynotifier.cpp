@@ -0,0 +1,123 @@
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QPixmap>
+#include <QSystemTrayIcon>
+#include <QTest>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+#include "pastesequence.h"
+#include "testregistry.h"
+#include "traynotifier.h"
+
+/**
+ * 通知调度: 以 5 次一组(组内间隔 30 ms, 组间约 1 秒)的节奏写入 N 个时间戳, 测量从计划的
+ * 按下时刻到剪贴板就绪的耗时. 比较关闭通知与经托盘图标显示(与程序相同的 trayPresenter),
+ * 后者的 p99 比前者多出 5 ms 以上即为被通知拖慢.
+ * 另一行以每次阻塞 200 ms 的回调代替无响应的通知服务: 气泡在 GUI 线程中显示, 显示期间
+ * 按下的热键要等它返回, 这一行只报告 p99 的增加, 不作判定.
+ *
+ * N 默认 200; 可由环境变量 TIMESTAMPHOTKEY_NOTIFY_PRESSES 调整.
+ */
+class BenchTrayNotifier : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void pressToReady_data();
+    void pressToReady();
+
+private:
+    int m_presses = 200;
+    qint64 m_baselineP99Ns = 0;
+};
+
+void BenchTrayNotifier::initTestCase()
+{
+    if (qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_NOTIFY_PRESSES"))
+        m_presses = qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_NOTIFY_PRESSES"));
+}
+
+void BenchTrayNotifier::pressToReady_data()
+{
+    QTest::addColumn<bool>("enabled");
+    QTest::addColumn<int>("serviceMs");
+    // 第一行作为基准; serviceMs 为 0 时经托盘图标显示
+    QTest::newRow("notifications off") << false << 0;
+    QTest::newRow("tray icon") << true << 0;
+    QTest::newRow("service blocks 200 ms") << true << 200;
+}
+
+void BenchTrayNotifier::pressToReady()
+{
+    QFETCH(bool, enabled);
+    QFETCH(int, serviceMs);
+
+    PasteSequence sequence;
+    QSystemTrayIcon icon;
+    QPixmap pixmap(16, 16);
+    pixmap.fill(Qt::darkCyan);
+    icon.setIcon(QIcon(pixmap));
+    icon.show();
+    TrayNotifier::Presenter presenter = TrayNotifier::trayPresenter(&icon);
+    if (serviceMs > 0)
+        presenter = [serviceMs](const QString &, const QString &) { QThread::msleep(serviceMs); };
+    TrayNotifier notifier(presenter);
+    notifier.setEnabled(enabled);
+    notifier.setBusy([&sequence]() { return sequence.isRunning(); });
+    connect(&sequence, &PasteSequence::finished, &notifier, &TrayNotifier::resume, Qt::QueuedConnection);
+
+    // 以计划时刻为起点: GUI 线程被通知阻塞时, 按键的处理推迟也计入
+    QElapsedTimer clock;
+    qint64 scheduledNs = 0;
+    QVector<qint64> latencies;
+    latencies.reserve(m_presses);
+    connect(&sequence, &PasteSequence::clipboardReady, this, [&](qint64, bool, bool) {
+        latencies.append(clock.nsecsElapsed() - scheduledNs);
+    });
+
+    QEventLoop loop;
+    QTimer tick;
+    tick.setSingleShot(true);
+    tick.setTimerType(Qt::PreciseTimer);
+    int index = 0;
+    connect(&tick, &QTimer::timeout, this, [&]() {
+        const QString text = QString("notify-bench #%1").arg(index);
+        notifier.addStamp(text);
+        sequence.run(text, false);
+        if (++index == m_presses) {
+            // 等最后一个气泡显示完
+            QTimer::singleShot(TrayNotifier::MinIntervalMs + serviceMs + 500, &loop, &QEventLoop::quit);
+            return;
+        }
+        scheduledNs += qint64(index % 5 ? 30 : 970 + index % 7 * 20) * 1000000;
+        tick.start(int(qMax<qint64>(0, (scheduledNs - clock.nsecsElapsed()) / 1000000)));
+    });
+    clock.start();
+    tick.start(0);
+    loop.exec();
+
+    QCOMPARE(latencies.size(), m_presses);
+    std::sort(latencies.begin(), latencies.end());
+    const qint64 medianNs = latencies.at(latencies.size() / 2);
+    const qint64 p99Ns = latencies.at(latencies.size() * 99 / 100);
+    if (!enabled)
+        m_baselineP99Ns = p99Ns;
+    const TrayNotifier::Stats stats = notifier.stats();
+    qInfo("按下到就绪 中位数 %.2f ms, p99 %.2f ms, 气泡 %llu 个 / %llu 个时间戳, 显示最长 %.2f ms", medianNs / 1000000.0,
+          p99Ns / 1000000.0, stats.shown, stats.stamps, stats.maxShowNs / 1000000.0);
+    QTest::setBenchmarkResult(medianNs / 1000000.0, QTest::WalltimeMilliseconds);
+    if (enabled)
+        QVERIFY(stats.shown > 0);
+    if (serviceMs > 0) {
+        qInfo("显示阻塞时 p99 增加 %.2f ms", (p99Ns - m_baselineP99Ns) / 1000000.0);
+        return;
+    }
+    // 允许定时器抖动
+    QVERIFY2(p99Ns - m_baselineP99Ns < 5000000, "按下到就绪被通知拖慢");
+}
+
+REGISTER_TEST(BenchTrayNotifier)
+
+#include "bench_traynotifier.moc"
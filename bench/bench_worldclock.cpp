@@ -0,0 +1,52 @@
+#include <QTest>
+#include <QTimeZone>
+#include "clocksource.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+#include "worldclock.h"
+
+/**
+ * 世界时钟同时渲染 1/20 个时区的耗时; 切换表预先计算, 只测每次渲染
+ */
+class BenchWorldClock : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void render_data();
+    void render();
+};
+
+void BenchWorldClock::render_data()
+{
+    QTest::addColumn<int>("zones");
+    QTest::newRow("1") << 1;
+    QTest::newRow("20") << 20;
+}
+
+void BenchWorldClock::render()
+{
+    QFETCH(int, zones);
+    QStringList ids;
+    for (const QByteArray &id : QTimeZone::availableTimeZoneIds()) {
+        if (ids.size() == zones)
+            break;
+        ids.append(QString::fromUtf8(id));
+    }
+
+    WorldClock worldClock(ids);
+    QCOMPARE(worldClock.zoneCount(), zones);
+    const TimestampFormatter formatter("yyyy-MM-dd HH:mm:ss ttt");
+    const ClockSource *clock = ClockSource::current();
+    worldClock.render(clock->nowNs(), formatter);
+
+    qint64 sink = 0;
+    QBENCHMARK {
+        sink += worldClock.render(clock->nowNs(), formatter).size();
+    }
+    QVERIFY(sink > 0);
+}
+
+REGISTER_TEST(BenchWorldClock)
+
+#include "bench_worldclock.moc"
@@ -0,0 +1,33 @@
+#include <QApplication>
+#include <QStandardPaths>
+#include "testregistry.h"
+
+/**
+ * 基准测试: 运行 bench/ 下登记的全部 QBENCHMARK 类
+ *
+ * 用法: TimestampHotkey_bench [-results <目录>] [类名...] [QTest 参数...]
+ * 每个类的结果除输出到终端外, 另以 QtTest XML 写入 <目录>/<类名>.xml(默认 ./bench_results),
+ * 便于前后两次比较. 平台插件的选择与单元测试相同.
+ */
+int main(int argc, char *argv[])
+{
+#ifndef Q_OS_WIN
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+#endif
+    // 端到端基准的探测输入框是控件
+    QApplication app(argc, argv);
+    app.setOrganizationName("TimestampHotkey");
+    app.setApplicationName("TimestampHotkey_bench");
+    QStandardPaths::setTestModeEnabled(true);
+
+    QStringList arguments = app.arguments();
+    QString resultsDir = QStringLiteral("bench_results");
+    const int index = arguments.indexOf("-results");
+    if (index > 0 && index + 1 < arguments.size()) {
+        resultsDir = arguments.at(index + 1);
+        arguments.removeAt(index);
+        arguments.removeAt(index);
+    }
+    return TestRegistry::run(arguments, resultsDir);
+}
@@ -0,0 +1,198 @@
+#include "chordmatcher.h"
+
+#include <QDebug>
+#include <qhotkey.h>
+#include "clocksource.h"
+
+namespace {
+
+QKeySequence chordToSequence(int chord)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return QKeySequence(QKeyCombination::fromCombined(chord));
+#else
+    return QKeySequence(chord);
+#endif
+}
+
+} // namespace
+
+// ---------- ChordTrie ----------
+
+ChordTrie::ChordTrie()
+{
+    clear();
+}
+
+void ChordTrie::clear()
+{
+    nodes.clear();
+    nodes.append(Node());
+}
+
+void ChordTrie::insert(const QKeySequence &sequence, int value)
+{
+    int node = root();
+    for (int i = 0; i < sequence.count(); ++i) {
+        const int chord = chordAt(sequence, i);
+        int next = child(node, chord);
+        if (next == NoNode) {
+            next = nodes.size();
+            Node created;
+            created.depth = nodes.at(node).depth + 1;
+            nodes.append(created);
+            nodes[node].children.insert(chord, next);
+        }
+        node = next;
+    }
+    if (node != root())
+        nodes[node].value = value;
+}
+
+int ChordTrie::chordAt(const QKeySequence &sequence, int index)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return sequence[index].toCombined();
+#else
+    return sequence[index];
+#endif
+}
+
+// ---------- ChordMatcher ----------
+
+ChordMatcher::ChordMatcher(QObject *parent) :
+    QObject(parent),
+    m_timeouts({1000})
+{
+    m_timeout.setObjectName(QStringLiteral("chordTimeout"));
+    m_timeout.setSingleShot(true);
+    connect(&m_timeout, &QTimer::timeout, this, [this]() {
+        // 前缀本身绑定了动作: 超时无后续按键即视为匹配
+        finish(m_trie.value(m_node), m_pendingPressNs);
+    });
+}
+
+ChordMatcher::~ChordMatcher()
+{
+    reset();
+}
+
+void ChordMatcher::setTrie(const ChordTrie &trie)
+{
+    reset();
+    m_trie = trie;
+
+    QHash<int, QHotkey *> roots;
+    for (int chord : m_trie.childChords(m_trie.root())) {
+        QHotkey *hotkey = m_rootHotkeys.take(chord);
+        if (!hotkey)
+            hotkey = createHotkey(chord, true);
+        else if (!hotkey->isRegistered())
+            hotkey->setRegistered(true);
+        roots.insert(chord, hotkey);
+    }
+    // 剩余的是已不再使用的首段按键
+    qDeleteAll(m_rootHotkeys);
+    m_rootHotkeys = roots;
+}
+
+void ChordMatcher::setLevelTimeouts(const QList<int> &timeoutsMs)
+{
+    m_timeouts = timeoutsMs.isEmpty() ? QList<int>{1000} : timeoutsMs;
+}
+
+void ChordMatcher::press(int chord, qint64 pressNs)
+{
+    int next = m_trie.child(m_node, chord);
+    if (next == ChordTrie::NoNode && m_node != m_trie.root()) {
+        // 序列中途按了不相关的键: 放弃当前序列, 再按首段重新尝试
+        reset();
+        next = m_trie.child(m_node, chord);
+    }
+    if (next == ChordTrie::NoNode)
+        return;
+
+    enter(next, pressNs);
+}
+
+void ChordMatcher::reset()
+{
+    m_timeout.stop();
+    releaseFollowUps();
+    m_node = m_trie.root();
+    m_pendingPressNs = 0;
+}
+
+QStringList ChordMatcher::failedShortcuts() const
+{
+    QStringList failed;
+    for (auto it = m_rootHotkeys.cbegin(); it != m_rootHotkeys.cend(); ++it) {
+        if (!it.value()->isRegistered())
+            failed.append(chordToSequence(it.key()).toString(QKeySequence::NativeText));
+    }
+    return failed;
+}
+
+void ChordMatcher::enter(int node, qint64 pressNs)
+{
+    if (!m_trie.hasChildren(node)) {
+        finish(m_trie.value(node), pressNs);
+        return;
+    }
+
+    m_node = node;
+    m_pendingPressNs = pressNs;
+    releaseFollowUps();
+    grabFollowUps(node);
+    m_timeout.start(timeoutForDepth(m_trie.depth(node)));
+}
+
+void ChordMatcher::finish(int value, qint64 pressNs)
+{
+    // pressNs 由监听线程以 QHotkey 的时间戳时钟(即 ClockSource)记录
+    m_lastLatencyNs = ClockSource::current()->nowNs() - pressNs;
+    reset();
+    if (value != ChordTrie::NoValue)
+        emit matched(value, pressNs);
+}
+
+void ChordMatcher::grabFollowUps(int node)
+{
+    for (int chord : m_trie.childChords(node)) {
+        // 首段热键常驻注册, 其触发同样会进入 press()
+        if (m_rootHotkeys.contains(chord))
+            continue;
+        QHotkey *hotkey = createHotkey(chord, true);
+        if (!hotkey->isRegistered())
+            qDebug() << "临时热键注册失败:" << chordToSequence(chord).toString(QKeySequence::NativeText);
+        m_followUps.append(hotkey);
+    }
+}
+
+void ChordMatcher::releaseFollowUps()
+{
+    // 可能在临时热键自身的 activated 中被调用, 立即注销但延迟释放对象
+    for (QHotkey *hotkey : std::as_const(m_followUps)) {
+        hotkey->setRegistered(false);
+        hotkey->deleteLater();
+    }
+    m_followUps.clear();
+}
+
+QHotkey *ChordMatcher::createHotkey(int chord, bool registerNow)
+{
+    QHotkey *hotkey = new QHotkey(Qt::Key(chord & ~Qt::KeyboardModifierMask),
+                                  Qt::KeyboardModifiers(chord & Qt::KeyboardModifierMask),
+                                  registerNow,
+                                  this);
+    // 按下时刻由监听线程在收到系统消息时记录, 不受 GUI 线程排队延迟影响
+    connect(hotkey, &QHotkey::activated, this, [this, chord](qint64 timestampNs) {
+        press(chord, timestampNs);
+    });
+    return hotkey;
+}
+
+int ChordMatcher::timeoutForDepth(int depth) const
+{
+    return m_timeouts.at(qBound(0, depth - 1, m_timeouts.size() - 1));
+}
@@ -0,0 +1,106 @@
+#ifndef CHORDMATCHER_H
+#define CHORDMATCHER_H
+
+#include <QHash>
+#include <QKeySequence>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+class QHotkey;
+
+/**
+ * 按键序列前缀树
+ *
+ * 每个节点的子节点以组合键(key | modifiers)为键存放在哈希表中,
+ * 因此每次按键的查找为 O(1).
+ */
+class ChordTrie
+{
+public:
+    static constexpr int NoNode = -1;
+    static constexpr int NoValue = -1;
+
+    ChordTrie();
+
+    void clear();
+    // 插入一个序列, 已存在时覆盖其值
+    void insert(const QKeySequence &sequence, int value);
+
+    int root() const { return 0; }
+    int child(int node, int chord) const { return nodes.at(node).children.value(chord, NoNode); }
+    int value(int node) const { return nodes.at(node).value; }
+    int depth(int node) const { return nodes.at(node).depth; }
+    bool hasChildren(int node) const { return !nodes.at(node).children.isEmpty(); }
+    QList<int> childChords(int node) const { return nodes.at(node).children.keys(); }
+
+    static int chordAt(const QKeySequence &sequence, int index);
+
+private:
+    struct Node {
+        QHash<int, int> children;
+        int value = NoValue;
+        int depth = 0;
+    };
+    QVector<Node> nodes;
+};
+
+/**
+ * 多段热键匹配器 (Emacs 风格, 例如 Ctrl+` 之后按 D)
+ *
+ * 第一段按键常驻注册为全局热键; 进入某个前缀后, 仅临时注册该节点的后续按键,
+ * 匹配完成、超时或输入不匹配时立即注销.
+ * 若某个前缀本身也绑定了动作, 则等到该层超时仍无后续按键时再触发.
+ */
+class ChordMatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ChordMatcher(QObject *parent = nullptr);
+    ~ChordMatcher() override;
+
+    // 替换前缀树, 常驻热键按差量注册/注销
+    void setTrie(const ChordTrie &trie);
+    // 各层等待下一段按键的超时(毫秒), 超出列表长度的层使用最后一个值
+    void setLevelTimeouts(const QList<int> &timeoutsMs);
+
+    // 处理一次按键, pressNs 为按下时刻
+    void press(int chord, qint64 pressNs);
+    // 放弃当前进行中的序列
+    void reset();
+    // 已按下前缀, 正在等待下一段
+    bool isPending() const { return m_node != m_trie.root(); }
+
+    // 注册失败的常驻热键
+    QStringList failedShortcuts() const;
+    // 最近一次匹配从最后一段按下(监听线程记录的时刻)到发出 matched 的耗时, 即匹配本身
+    // 增加的延迟; 前缀本身绑定了动作、超时才触发的, 其中包含该层的超时
+    qint64 lastMatchLatencyNs() const { return m_lastLatencyNs; }
+
+signals:
+    // 匹配到序列, value 为插入时的值, pressNs 为最后一段按键的按下时刻
+    void matched(int value, qint64 pressNs);
+
+private:
+    void enter(int node, qint64 pressNs);
+    void finish(int value, qint64 pressNs);
+    void grabFollowUps(int node);
+    void releaseFollowUps();
+    QHotkey *createHotkey(int chord, bool registerNow);
+    int timeoutForDepth(int depth) const;
+
+    ChordTrie m_trie;
+    QHash<int, QHotkey *> m_rootHotkeys;
+    QList<QHotkey *> m_followUps;
+    QList<int> m_timeouts;
+    QTimer m_timeout;
+
+    int m_node = 0;
+    qint64 m_pendingPressNs = 0;
+    qint64 m_lastLatencyNs = 0;
+};
+
+#endif // CHORDMATCHER_H
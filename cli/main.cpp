@@ -0,0 +1,241 @@
+/**
+ * @file cli/main.cpp
+ * @brief 时间戳热键的命令行工具
+ *
+ * 托盘程序是 Windows 窗口程序, 没有控制台, 标准输出会丢失; 需要在终端中使用、
+ * 输出到标准输出的功能放在这个控制台程序中. 使用与托盘程序相同的设置与数据目录.
+ *
+ * 命令行:
+ *   --convert <日志> [--output <文件>] [--to iso|epoch-ms|<格式>]
+ *                   [--from-offset +08:00] [--to-offset Z] [--threads N]
+ *                   转换日志中的 yyyyMMdd-HHmmsszzz 时间戳后退出; 未指定偏移的一侧按本机时区
+ *                   逐个时间戳取偏移(含夏令时)
+ *   --replay-trace <文件> [--speed X]
+ *                   以无头模式按原始节奏(或 X 倍速, 0 为不等待)重放托盘程序 --record-trace
+ *                   记录的热键事件, 输出送达延迟与丢失数后退出, 有丢失则以 1 退出
+ *   --merge-history <输出目录> <[机器名=]历史目录>...
+ *                   按时间归并多台机器的历史到输出目录(须为空), 来源记为 "机器名:来源"
+ *   --history-rollup <minute|hour|day> [--days N] [--history <目录>]
+ *                   按本地时间输出最近 N 天(默认 7)每分钟/小时/天的时间戳数; 只读打开历史,
+ *                   托盘程序运行中也可使用
+ *   --memory-report  查询正在运行的托盘程序的当前与峰值常驻内存(经本地套接字), 未运行时以 1 退出
+ */
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTextStream>
+#include <QTimeZone>
+#include <qhotkey.h>
+#include "clocksource.h"
+#include "historymerger.h"
+#include "hotkeytrace.h"
+#include "logrestamper.h"
+#include "stamphistory.h"
+#include "statusserver.h"
+#include "timestampformatter.h"
+
+/**
+ * 日志时间戳转换模式, 结束后在标准错误输出吞吐量
+ */
+int runConverter(const QCommandLineParser &parser)
+{
+    QTextStream err(stderr);
+
+    LogRestamper::Options options;
+    options.inputPath = parser.value("convert");
+    options.outputPath = parser.value("output");
+    if (parser.isSet("to"))
+        options.outputFormat = parser.value("to");
+    if (parser.isSet("threads"))
+        options.threads = parser.value("threads").toInt();
+
+    // 未指定偏移时按本机时区逐个时间戳换算, 跨夏令时切换的日志也不会错一小时
+    options.inputZone = QTimeZone::systemTimeZone();
+    options.outputZone = QTimeZone::systemTimeZone();
+    if (parser.isSet("from-offset")) {
+        if (!LogRestamper::parseOffset(parser.value("from-offset"), options.inputOffsetSecs)) {
+            err << "无效的偏移: " << parser.value("from-offset") << "\n";
+            return 2;
+        }
+        options.inputZone = QTimeZone();
+    }
+    if (parser.isSet("to-offset")) {
+        if (!LogRestamper::parseOffset(parser.value("to-offset"), options.outputOffsetSecs)) {
+            err << "无效的偏移: " << parser.value("to-offset") << "\n";
+            return 2;
+        }
+        options.outputZone = QTimeZone();
+    }
+
+    LogRestamper::Stats stats;
+    QString error;
+    if (!LogRestamper(options).run(&stats, &error)) {
+        err << error << "\n";
+        return 1;
+    }
+
+    err << "转换 " << stats.stamps << " 个时间戳, 输入 " << stats.bytesIn << " 字节, 输出 "
+        << stats.bytesOut << " 字节, 耗时 " << stats.elapsedNs / 1000000 << " ms, "
+        << QString::number(stats.gigabytesPerSecond(), 'f', 2) << " GB/s\n";
+    return 0;
+}
+
+/**
+ * 重放热键事件记录, 输出延迟与丢失统计
+ */
+int runTraceReplay(const QCommandLineParser &parser)
+{
+    QTextStream out(stdout);
+    HotkeyTrace trace;
+    QString error;
+    if (!trace.load(parser.value("replay-trace"), &error)) {
+        out << error << "\n";
+        return 2;
+    }
+
+    HotkeyTrace::ReplayOptions options;
+    if (parser.isSet("speed"))
+        options.speed = qMax(0.0, parser.value("speed").toDouble());
+    // 与正常运行相同, 在独立监听线程中分发
+    if (QSettings().value("listenerThread", true).toBool())
+        QHotkey::startListenerThread();
+
+    const HotkeyTrace::ReplayStats stats = trace.replay(options);
+    // 不进入事件循环, 没有 aboutToQuit, 在这里停止监听线程
+    QHotkey::stopListenerThread();
+    out << HotkeyTrace::formatStats(stats) << "\n";
+    return stats.dropped == 0 ? 0 : 1;
+}
+
+/**
+ * 归并多台机器的历史, 结束后输出吞吐与峰值内存
+ */
+int runHistoryMerge(const QCommandLineParser &parser)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QString outputDir = parser.value("merge-history");
+    QList<HistoryMerger::Input> inputs;
+    for (const QString &argument : parser.positionalArguments()) {
+        inputs.append(HistoryMerger::parseInput(argument));
+        if (QFileInfo(inputs.last().directory).absoluteFilePath() == QFileInfo(outputDir).absoluteFilePath()) {
+            err << "输出目录不能同时是输入: " << outputDir << "\n";
+            return 2;
+        }
+    }
+    if (inputs.isEmpty()) {
+        err << "没有指定要归并的历史目录\n";
+        return 2;
+    }
+
+    StampHistory output(outputDir);
+    HistoryMerger merger(inputs);
+    QString error;
+    if (!output.open(&error) || !merger.merge(&output, &error)) {
+        err << error << "\n";
+        return 1;
+    }
+    out << HistoryMerger::formatStats(merger.stats()) << "\n";
+    return 0;
+}
+
+/**
+ * 向正在运行的托盘程序查询内存占用
+ */
+int printMemoryReport()
+{
+    QString reply;
+    QString error;
+    if (!StatusServer::query(QStringLiteral("memory"), reply, &error)) {
+        QTextStream(stderr) << error << "\n";
+        return 1;
+    }
+    QTextStream(stdout) << "内存: " << reply << "\n";
+    return 0;
+}
+
+/**
+ * 按本地时间输出最近 days 天每个桶的时间戳数
+ *
+ * 历史目录可能正被托盘程序写入: 只读打开, 不重新封存日志、不重写 rollup.idx
+ */
+int printHistoryRollup(const QCommandLineParser &parser)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    static const QStringList levels = {"minute", "hour", "day"};
+    const QString levelName = parser.value("history-rollup");
+    const int level = levels.indexOf(levelName);
+    if (level < 0) {
+        err << "无效的粒度: " << levelName << "\n";
+        return 2;
+    }
+    const int days = qMax(1, parser.value("days").toInt());
+
+    StampHistory history(parser.isSet("history") ? parser.value("history") : StampHistory::defaultDirectory());
+    QString error;
+    if (!history.openReadOnly(&error)) {
+        err << "无法打开时间戳历史: " << error << "\n";
+        return 1;
+    }
+
+    // 桶按本地时间对齐, 每桶一次 O(log n) 计数
+    const qint64 widthNs = StampRollup::widthNs(StampRollup::Level(level));
+    const qint64 dayNs = StampRollup::widthNs(StampRollup::Day);
+    const qint64 nowNs = ClockSource::current()->nowNs();
+    const qint64 offsetNs = TimestampFormatter::localUtcOffset(nowNs) * 1000000000ll;
+    const qint64 todayNs = nowNs - (nowNs + offsetNs) % dayNs;
+    const TimestampFormatter formatter(level == StampRollup::Day ? "yyyy-MM-dd" : "yyyy-MM-dd HH:mm");
+    qint64 total = 0;
+    for (qint64 startNs = todayNs - (days - 1) * dayNs; startNs <= nowNs; startNs += widthNs) {
+        const qint64 count = history.count(startNs, startNs + widthNs);
+        if (count == 0)
+            continue;
+        total += count;
+        out << formatter.formatLocal(startNs) << "  " << count << "\n";
+    }
+    out << "合计 " << total << "\n";
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    app.setOrganizationName("TimestampHotkey");
+    app.setApplicationName("TimestampHotkey");
+    app.setApplicationVersion("1.1");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({"convert", "转换日志文件中的时间戳", "日志"});
+    parser.addOption({"output", "转换结果输出文件, 默认为标准输出", "文件"});
+    parser.addOption({"to", "输出格式: iso、epoch-ms 或格式串", "格式"});
+    parser.addOption({"from-offset", "日志中时间戳的 UTC 偏移, 默认本机时区", "偏移"});
+    parser.addOption({"to-offset", "输出时间的 UTC 偏移, 默认本机时区", "偏移"});
+    parser.addOption({"threads", "转换使用的线程数", "N"});
+    parser.addOption({"replay-trace", "重放热键事件记录并输出延迟统计", "文件"});
+    parser.addOption({"speed", "重放速度倍数, 0 为不等待", "X"});
+    parser.addOption({"merge-history", "按时间归并多台机器的历史到输出目录", "输出目录"});
+    parser.addOption({"history-rollup", "按本地时间输出最近几天每分钟/小时/天的时间戳数", "粒度"});
+    parser.addOption({"days", "--history-rollup 统计的天数", "N", "7"});
+    parser.addOption({"history", "时间戳历史目录, 默认与托盘程序相同", "目录"});
+    parser.addOption({"memory-report", "查询正在运行的托盘程序的当前与峰值常驻内存"});
+    parser.addPositionalArgument("历史目录", "--merge-history 的输入, 可写作 机器名=目录", "[[机器名=]目录...]");
+    parser.process(app);
+
+    if (parser.isSet("convert"))
+        return runConverter(parser);
+    if (parser.isSet("replay-trace"))
+        return runTraceReplay(parser);
+    if (parser.isSet("merge-history"))
+        return runHistoryMerge(parser);
+    if (parser.isSet("history-rollup"))
+        return printHistoryRollup(parser);
+    if (parser.isSet("memory-report"))
+        return printMemoryReport();
+
+    parser.showHelp(2);
+}
@@ -0,0 +1,255 @@
+#include "clipboardsnapshot.h"
+
+#include <QClipboard>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QMimeData>
+#include <utility>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <cstring>
+
+namespace {
+
+// EmptyClipboard 后 SetClipboardData 需要剪贴板有所有者窗口, 用一个仅消息窗口
+HWND ownerWindow()
+{
+    static const HWND window = CreateWindowExW(0, L"STATIC", L"ClipboardSnapshot", 0, 0, 0, 0, 0,
+                                               HWND_MESSAGE, nullptr, GetModuleHandleW(nullptr), nullptr);
+    return window;
+}
+
+// 其他程序可能正打开着剪贴板, 稍等重试
+bool openClipboard()
+{
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        if (OpenClipboard(ownerWindow()))
+            return true;
+        Sleep(2);
+    }
+    return false;
+}
+
+// 可互相合成的格式组, 同组只取枚举时先出现的(程序原本放入的); 0 表示不参与合成
+int synthesisGroup(UINT format)
+{
+    switch (format) {
+    case CF_UNICODETEXT:
+    case CF_TEXT:
+    case CF_OEMTEXT:
+        return 1;
+    case CF_DIB:
+    case CF_DIBV5:
+    case CF_BITMAP:
+        return 2;
+    case CF_ENHMETAFILE:
+    case CF_METAFILEPICT:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+// OLE 嵌入/链接格式: 总是延迟渲染, 数据引用所有者进程中的对象
+bool isOwnerBound(UINT format)
+{
+    if (format < 0xC000)
+        return false;
+    static const QStringList names = {"Embed Source", "Embedded Object", "Link Source", "Link Source Descriptor",
+                                      "Object Descriptor", "ObjectLink", "OwnerLink", "Native", "DataObject",
+                                      "Ole Private Data"};
+    wchar_t name[64];
+    const int length = GetClipboardFormatNameW(format, name, 64);
+    return length > 0 && names.contains(QString::fromWCharArray(name, length));
+}
+
+// 复制一个格式的数据; 返回新句柄, 不支持的格式返回 nullptr
+HANDLE duplicate(UINT format, HANDLE source, qint64 *bytes)
+{
+    switch (format) {
+    case CF_BITMAP: {
+        BITMAP info;
+        if (GetObjectW(source, sizeof(info), &info))
+            *bytes = qint64(info.bmWidthBytes) * info.bmHeight;
+        return CopyImage(source, IMAGE_BITMAP, 0, 0, 0);
+    }
+    case CF_ENHMETAFILE:
+        *bytes = GetEnhMetaFileBits(HENHMETAFILE(source), 0, nullptr);
+        return CopyEnhMetaFile(HENHMETAFILE(source), nullptr);
+    case CF_METAFILEPICT:
+    case CF_PALETTE:
+    case CF_OWNERDISPLAY:
+    case CF_DSPBITMAP:
+    case CF_DSPENHMETAFILE:
+    case CF_DSPMETAFILEPICT:
+        // 内含其他句柄或依赖所有者窗口; 图元文件会由 CF_ENHMETAFILE 合成
+        return nullptr;
+    default:
+        break;
+    }
+    if (format >= CF_GDIOBJFIRST && format <= CF_GDIOBJLAST)
+        return nullptr;
+
+    // 其余格式都是 HGLOBAL, 原样复制内存
+    const SIZE_T size = GlobalSize(source);
+    const void *data = size ? GlobalLock(source) : nullptr;
+    if (!data)
+        return nullptr;
+    HGLOBAL copy = GlobalAlloc(GMEM_MOVEABLE, size);
+    void *target = copy ? GlobalLock(copy) : nullptr;
+    if (target) {
+        std::memcpy(target, data, size);
+        GlobalUnlock(copy);
+        *bytes = qint64(size);
+    } else if (copy) {
+        GlobalFree(copy);
+        copy = nullptr;
+    }
+    GlobalUnlock(source);
+    return copy;
+}
+
+void release(UINT format, HANDLE handle)
+{
+    if (format == CF_BITMAP)
+        DeleteObject(handle);
+    else if (format == CF_ENHMETAFILE)
+        DeleteEnhMetaFile(HENHMETAFILE(handle));
+    else
+        GlobalFree(handle);
+}
+
+} // namespace
+#else
+namespace {
+
+// 平台由同一份数据转换出的 MIME 类型: 1 为文本, 2 为图片; 0 表示各自独立
+int mimeGroup(const QString &format)
+{
+    if (format.startsWith(QLatin1String("text/plain")) || format == QLatin1String("UTF8_STRING")
+        || format == QLatin1String("STRING") || format == QLatin1String("TEXT")
+        || format == QLatin1String("COMPOUND_TEXT"))
+        return 1;
+    if (format.startsWith(QLatin1String("image/")) || format == QLatin1String("application/x-qt-image"))
+        return 2;
+    return 0;
+}
+
+} // namespace
+#endif
+
+ClipboardSnapshot::~ClipboardSnapshot()
+{
+    clear();
+}
+
+bool ClipboardSnapshot::capture()
+{
+    clear();
+#ifdef Q_OS_WIN
+    if (!openClipboard()) {
+        qWarning() << "无法打开剪贴板, 不保存原有内容";
+        return false;
+    }
+    // GetClipboardData 会让延迟渲染的程序此时才生成数据
+    QElapsedTimer timer;
+    timer.start();
+    bool seen[4] = {};
+    for (UINT format = EnumClipboardFormats(0); format; format = EnumClipboardFormats(format)) {
+        const int group = synthesisGroup(format);
+        if (group && seen[group])
+            continue;
+        if (isOwnerBound(format) || (format >= 0xC000 && timer.elapsed() > CaptureBudgetMs))
+            continue;
+        const HANDLE source = GetClipboardData(format);
+        qint64 bytes = 0;
+        const HANDLE copy = source ? duplicate(format, source, &bytes) : nullptr;
+        if (!copy)
+            continue;
+        seen[group] = true;
+        m_formats.append({format, copy});
+        m_bytes += bytes;
+    }
+    CloseClipboard();
+#else
+    const QMimeData *source = QGuiApplication::clipboard()->mimeData();
+    if (source && !source->formats().isEmpty()) {
+        m_mimeData = new QMimeData;
+        bool seen[3] = {};
+        for (const QString &format : source->formats()) {
+            const int group = mimeGroup(format);
+            if (group && seen[group])
+                continue;
+            // application/x-qt-image 没有字节形式, 由下面的 imageData 兜底
+            const QByteArray data = source->data(format);
+            if (group && data.isEmpty())
+                continue;
+            seen[group] = true;
+            m_mimeData->setData(format, data);
+            m_bytes += data.size();
+        }
+        if (!seen[2] && source->hasImage()) {
+            const QImage image = qvariant_cast<QImage>(source->imageData());
+            m_mimeData->setImageData(image);
+            m_bytes += image.sizeInBytes();
+        }
+        if (m_mimeData->formats().isEmpty())
+            delete std::exchange(m_mimeData, nullptr);
+    }
+#endif
+    return !isEmpty();
+}
+
+bool ClipboardSnapshot::restore()
+{
+    if (isEmpty())
+        return false;
+#ifdef Q_OS_WIN
+    if (!openClipboard()) {
+        qWarning() << "无法打开剪贴板, 原有内容未恢复";
+        clear();
+        return false;
+    }
+    EmptyClipboard();
+    bool restored = true;
+    for (const Format &format : std::as_const(m_formats)) {
+        // 成功后句柄归剪贴板所有
+        if (!SetClipboardData(format.id, format.handle)) {
+            release(format.id, format.handle);
+            restored = false;
+        }
+    }
+    CloseClipboard();
+    m_formats.clear();
+    m_bytes = 0;
+    return restored;
+#else
+    QGuiApplication::clipboard()->setMimeData(std::exchange(m_mimeData, nullptr));
+    m_bytes = 0;
+    return true;
+#endif
+}
+
+void ClipboardSnapshot::clear()
+{
+#ifdef Q_OS_WIN
+    for (const Format &format : std::as_const(m_formats))
+        release(format.id, format.handle);
+#endif
+    m_formats.clear();
+    delete std::exchange(m_mimeData, nullptr);
+    m_bytes = 0;
+}
+
+bool ClipboardSnapshot::isEmpty() const
+{
+    return m_formats.isEmpty() && !m_mimeData;
+}
+
+int ClipboardSnapshot::formatCount() const
+{
+    return m_mimeData ? m_mimeData->formats().size() : m_formats.size();
+}
@@ -0,0 +1,57 @@
+#ifndef CLIPBOARDSNAPSHOT_H
+#define CLIPBOARDSNAPSHOT_H
+
+#include <QVector>
+#include <QtGlobal>
+
+class QMimeData;
+
+/**
+ * 剪贴板快照: 写入时间戳前取下用户原有的剪贴板内容, 粘贴完成后放回
+ *
+ * Windows 上按原生格式逐个取句柄, 原样复制其内存(不经 QMimeData 做格式转换);
+ * 系统能由其他格式合成的(如 CF_TEXT 之于 CF_UNICODETEXT, CF_BITMAP 之于 CF_DIB)
+ * 只取程序原本放入的那个, 放回后由系统照常合成. 放回时句柄的所有权直接交给剪贴板,
+ * 不再复制第二次. 延迟渲染的格式在 GetClipboardData 时才由所有者生成, 而 Win32 没有
+ * 查询某个格式是否已渲染的接口: OLE 嵌入/链接格式(离开所有者无法使用)一律不取,
+ * 取快照用时超过 CaptureBudgetMs 后不再取程序注册的私有格式, 标准格式照常取.
+ *
+ * 其他平台上 QMimeData 列出的是平台能转换出的全部 MIME 类型, 逐个读取等于让所有者
+ * 把同一份数据转换成每一种格式; 同样按组只取排在最前的(所有者原本提供的)文本与图片格式,
+ * 其余格式原样复制, 放回时把 QMimeData 交给剪贴板, 其他类型由平台照常转换.
+ */
+class ClipboardSnapshot
+{
+public:
+    ClipboardSnapshot() = default;
+    ~ClipboardSnapshot();
+    ClipboardSnapshot(const ClipboardSnapshot &) = delete;
+    ClipboardSnapshot &operator=(const ClipboardSnapshot &) = delete;
+
+    // Windows: 超过后只取标准格式
+    static constexpr int CaptureBudgetMs = 50;
+
+    // 取下当前剪贴板内容(覆盖已有的快照); 剪贴板为空或打不开时返回 false
+    bool capture();
+    // 放回快照内容, 之后快照为空
+    bool restore();
+    void clear();
+
+    bool isEmpty() const;
+    int formatCount() const;
+    // 快照持有的数据量
+    qint64 bytes() const { return m_bytes; }
+
+private:
+    // Windows: 剪贴板格式与句柄(HGLOBAL, 位图与增强图元文件为 GDI 句柄)
+    struct Format {
+        quint32 id = 0;
+        void *handle = nullptr;
+    };
+
+    QVector<Format> m_formats;
+    QMimeData *m_mimeData = nullptr;
+    qint64 m_bytes = 0;
+};
+
+#endif // CLIPBOARDSNAPSHOT_H
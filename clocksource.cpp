@@ -0,0 +1,387 @@
+#include "clocksource.h"
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CLOCKSOURCE_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace {
+
+#ifdef Q_OS_WIN
+// FILETIME 以 1601-01-01 为起点, 单位 100ns
+constexpr qint64 kFileTimeToUnixEpoch = 116444736000000000LL;
+
+inline qint64 fileTimeToNs(const FILETIME &ft)
+{
+    const qint64 ticks = (static_cast<qint64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    return (ticks - kFileTimeToUnixEpoch) * 100;
+}
+#else
+inline qint64 timespecToNs(const timespec &ts)
+{
+    return static_cast<qint64>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+#endif
+
+class RealtimeClock : public ClockSource
+{
+public:
+    Kind kind() const override { return Realtime; }
+    QString name() const override { return kindName(Realtime); }
+
+    qint64 nowNs() const override
+    {
+#ifdef Q_OS_WIN
+        FILETIME ft;
+        GetSystemTimePreciseAsFileTime(&ft);
+        return fileTimeToNs(ft);
+#else
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return timespecToNs(ts);
+#endif
+    }
+
+    qint64 nominalResolutionNs() const override
+    {
+#ifdef Q_OS_WIN
+        return 100;
+#else
+        timespec ts;
+        if (clock_getres(CLOCK_REALTIME, &ts) != 0)
+            return 0;
+        return timespecToNs(ts);
+#endif
+    }
+};
+
+class CoarseClock : public ClockSource
+{
+public:
+    Kind kind() const override { return Coarse; }
+    QString name() const override { return kindName(Coarse); }
+
+    qint64 nowNs() const override
+    {
+#ifdef Q_OS_WIN
+        FILETIME ft;
+        GetSystemTimeAsFileTime(&ft);
+        return fileTimeToNs(ft);
+#else
+        timespec ts;
+        clock_gettime(coarseId(), &ts);
+        return timespecToNs(ts);
+#endif
+    }
+
+    qint64 nominalResolutionNs() const override
+    {
+#ifdef Q_OS_WIN
+        DWORD adjustment = 0;
+        DWORD increment = 0;
+        BOOL disabled = FALSE;
+        if (!GetSystemTimeAdjustment(&adjustment, &increment, &disabled))
+            return 0;
+        return static_cast<qint64>(increment) * 100;
+#else
+        timespec ts;
+        if (clock_getres(coarseId(), &ts) != 0)
+            return 0;
+        return timespecToNs(ts);
+#endif
+    }
+
+private:
+#ifndef Q_OS_WIN
+    static clockid_t coarseId()
+    {
+#ifdef CLOCK_REALTIME_COARSE
+        return CLOCK_REALTIME_COARSE;
+#else
+        return CLOCK_REALTIME;
+#endif
+    }
+#endif
+};
+
+#ifdef CLOCKSOURCE_HAS_TSC
+/**
+ * TSC 时钟: 构造时在约 20ms 内对 Realtime 采样两次,
+ * 求出每个 TSC 计数对应的纳秒数, 之后只读 TSC 外推.
+ * 仅在 CPU 声明 invariant TSC 时可用(频率不随睿频/节能变化).
+ *
+ * 标称频率与实际频率总有 ppm 级的误差, 系统时间也会被 NTP 微调或跳变, 只校准一次时
+ * 偏差会随运行时间累积. 因此距上次锚定超过 ReanchorIntervalNs 时, 由读取时钟的线程顺带
+ * 对 Realtime 重新锚定: 以自首次校准起的长基线修正频率, 偏差超过 StepThresholdNs 的
+ * 视为系统时间被调整, 只跟随新的时间而不修正频率.
+ * 锚点以序列锁发布, 读取方不加锁; 同时只有一个线程做重新锚定.
+ */
+class TscClock : public ClockSource
+{
+public:
+    static constexpr qint64 ReanchorIntervalNs = 1000000000;
+    static constexpr qint64 StepThresholdNs = 1000000;
+
+    TscClock()
+    {
+        if (!hasInvariantTsc())
+            return;
+        recalibrate();
+    }
+
+    bool isUsable() const { return m_nsPerTick.load(std::memory_order_relaxed) > 0; }
+
+    Kind kind() const override { return Tsc; }
+    QString name() const override { return kindName(Tsc); }
+
+    qint64 nowNs() const override
+    {
+        const quint64 ticks = __rdtsc();
+        const Anchor anchor = loadAnchor();
+        const qint64 elapsedNs = static_cast<qint64>(static_cast<double>(static_cast<qint64>(ticks - anchor.ticks))
+                                                     * anchor.nsPerTick);
+        if (elapsedNs > ReanchorIntervalNs)
+            return reanchor();
+        return anchor.ns + elapsedNs;
+    }
+
+    qint64 nominalResolutionNs() const override
+    {
+        // 单个计数通常小于 1ns, 向上取整
+        const double nsPerTick = m_nsPerTick.load(std::memory_order_relaxed);
+        return nsPerTick > 0 ? qMax<qint64>(1, static_cast<qint64>(nsPerTick + 0.999)) : 0;
+    }
+
+private:
+    struct Anchor {
+        quint64 ticks = 0;
+        qint64 ns = 0;
+        double nsPerTick = 0;
+    };
+
+    static bool hasInvariantTsc()
+    {
+#ifdef _MSC_VER
+        int regs[4] = {0, 0, 0, 0};
+        __cpuid(regs, 0x80000000);
+        if (static_cast<unsigned>(regs[0]) < 0x80000007u)
+            return false;
+        __cpuid(regs, 0x80000007);
+        return (regs[3] & (1 << 8)) != 0;
+#else
+        unsigned eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (__get_cpuid_max(0x80000000, nullptr) < 0x80000007u)
+            return false;
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+#endif
+    }
+
+    void recalibrate()
+    {
+        const RealtimeClock reference;
+        const auto start = std::chrono::steady_clock::now();
+
+        const quint64 t0 = __rdtsc();
+        const qint64 ns0 = reference.nowNs();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {
+        }
+        const quint64 t1 = __rdtsc();
+        const qint64 ns1 = reference.nowNs();
+
+        if (t1 <= t0 || ns1 <= ns0)
+            return;
+        m_originTicks = t0;
+        m_originNs = ns0;
+        storeAnchor({t1, ns1, static_cast<double>(ns1 - ns0) / static_cast<double>(t1 - t0)});
+    }
+
+    qint64 reanchor() const
+    {
+        // 另一线程正在重新锚定时直接读系统时间
+        const RealtimeClock reference;
+        if (m_reanchoring.test_and_set(std::memory_order_acquire))
+            return reference.nowNs();
+
+        // 系统时间的读取夹在两次 TSC 读取之间, 取中点; 空闲后第一次读取可能慢上几微秒,
+        // 取几次中跨度最小的一次
+        quint64 ticks = 0;
+        qint64 referenceNs = 0;
+        quint64 bestSpan = std::numeric_limits<quint64>::max();
+        for (int attempt = 0; attempt < 3; ++attempt) {
+            const quint64 before = __rdtsc();
+            const qint64 ns = reference.nowNs();
+            const quint64 after = __rdtsc();
+            if (after - before < bestSpan) {
+                bestSpan = after - before;
+                ticks = before + bestSpan / 2;
+                referenceNs = ns;
+            }
+        }
+
+        const Anchor anchor = loadAnchor();
+        const qint64 driftNs = anchor.ns
+                               + static_cast<qint64>(static_cast<double>(static_cast<qint64>(ticks - anchor.ticks))
+                                                     * anchor.nsPerTick)
+                               - referenceNs;
+        double nsPerTick = anchor.nsPerTick;
+        if (qAbs(driftNs) > StepThresholdNs) {
+            m_originTicks = ticks;
+            m_originNs = referenceNs;
+        } else if (ticks > m_originTicks && referenceNs > m_originNs) {
+            nsPerTick = static_cast<double>(referenceNs - m_originNs) / static_cast<double>(ticks - m_originTicks);
+        }
+        storeAnchor({ticks, referenceNs, nsPerTick});
+        m_reanchoring.clear(std::memory_order_release);
+        return referenceNs;
+    }
+
+    Anchor loadAnchor() const
+    {
+        Anchor anchor;
+        quint32 before;
+        quint32 after;
+        do {
+            before = m_sequence.load(std::memory_order_acquire);
+            anchor.ticks = m_ticks.load(std::memory_order_relaxed);
+            anchor.ns = m_ns.load(std::memory_order_relaxed);
+            anchor.nsPerTick = m_nsPerTick.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_sequence.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return anchor;
+    }
+
+    void storeAnchor(const Anchor &anchor) const
+    {
+        const quint32 sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_ticks.store(anchor.ticks, std::memory_order_relaxed);
+        m_ns.store(anchor.ns, std::memory_order_relaxed);
+        m_nsPerTick.store(anchor.nsPerTick, std::memory_order_relaxed);
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // 当前锚点, 由序列锁保护; 序列号为奇数时正在写入
+    mutable std::atomic<quint32> m_sequence{0};
+    mutable std::atomic<quint64> m_ticks{0};
+    mutable std::atomic<qint64> m_ns{0};
+    mutable std::atomic<double> m_nsPerTick{0};
+    // 频率修正的基线起点, 只在持有 m_reanchoring 时访问
+    mutable quint64 m_originTicks = 0;
+    mutable qint64 m_originNs = 0;
+    mutable std::atomic_flag m_reanchoring;
+};
+#endif
+
+std::atomic<int> currentKind{ClockSource::Realtime};
+
+} // namespace
+
+ClockSource::Stats ClockSource::measure(int samples) const
+{
+    Stats stats;
+    if (samples <= 0)
+        return stats;
+
+    qint64 minStep = std::numeric_limits<qint64>::max();
+    qint64 previous = nowNs();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < samples; ++i) {
+        const qint64 value = nowNs();
+        const qint64 step = value - previous;
+        if (step > 0 && step < minStep)
+            minStep = step;
+        previous = value;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+
+    stats.readCostNs = static_cast<double>(
+                           std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+                       / samples;
+    stats.granularityNs = (minStep == std::numeric_limits<qint64>::max()) ? 0 : minStep;
+    return stats;
+}
+
+const ClockSource *ClockSource::get(Kind kind)
+{
+    static const RealtimeClock realtime;
+    static const CoarseClock coarse;
+
+    switch (kind) {
+    case Realtime:
+        return &realtime;
+    case Coarse:
+        return &coarse;
+    case Tsc: {
+#ifdef CLOCKSOURCE_HAS_TSC
+        static const TscClock tsc;
+        return tsc.isUsable() ? &tsc : nullptr;
+#else
+        return nullptr;
+#endif
+    }
+    }
+    return nullptr;
+}
+
+QList<ClockSource::Kind> ClockSource::available()
+{
+    QList<Kind> kinds;
+    for (Kind kind : {Realtime, Coarse, Tsc}) {
+        if (get(kind))
+            kinds.append(kind);
+    }
+    return kinds;
+}
+
+const ClockSource *ClockSource::current()
+{
+    const ClockSource *source = get(static_cast<Kind>(currentKind.load(std::memory_order_relaxed)));
+    return source ? source : get(Realtime);
+}
+
+void ClockSource::setCurrent(Kind kind)
+{
+    if (get(kind))
+        currentKind.store(kind, std::memory_order_relaxed);
+}
+
+QString ClockSource::kindName(Kind kind)
+{
+    switch (kind) {
+    case Realtime:
+        return QStringLiteral("realtime");
+    case Coarse:
+        return QStringLiteral("coarse");
+    case Tsc:
+        return QStringLiteral("tsc");
+    }
+    return QString();
+}
+
+ClockSource::Kind ClockSource::kindFromName(const QString &name, Kind fallback)
+{
+    for (Kind kind : {Realtime, Coarse, Tsc}) {
+        if (name.compare(kindName(kind), Qt::CaseInsensitive) == 0)
+            return kind;
+    }
+    return fallback;
+}
@@ -0,0 +1,61 @@
+#ifndef CLOCKSOURCE_H
+#define CLOCKSOURCE_H
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * 时钟源抽象
+ *
+ * QDateTime 只有毫秒精度, 快速连续触发时无法区分先后.
+ * 这里统一以"自 Unix 纪元起的纳秒数(UTC)"读取时间, 提供多种实现:
+ *  - Realtime: 精确系统时间 (clock_gettime(CLOCK_REALTIME) / GetSystemTimePreciseAsFileTime)
+ *  - Coarse:   粗粒度系统时间, 读取最便宜 (CLOCK_REALTIME_COARSE / GetSystemTimeAsFileTime)
+ *  - Tsc:      以 CPU 时间戳计数器(TSC)外推, 启动时对 Realtime 校准, 之后每秒重新锚定
+ */
+class ClockSource
+{
+public:
+    enum Kind {
+        Realtime,
+        Coarse,
+        Tsc
+    };
+
+    /**
+     * 实测结果: 单次读取耗时, 以及连续读取观察到的最小非零步进
+     */
+    struct Stats {
+        double readCostNs = 0;
+        qint64 granularityNs = 0;
+    };
+
+    virtual ~ClockSource() = default;
+
+    virtual Kind kind() const = 0;
+    virtual QString name() const = 0;
+
+    // 当前时间, 自 1970-01-01T00:00:00Z 起的纳秒数
+    virtual qint64 nowNs() const = 0;
+
+    // 操作系统声明的分辨率(纳秒), 未知时返回 0
+    virtual qint64 nominalResolutionNs() const = 0;
+
+    // 连续读取 samples 次, 测量读取耗时与实际步进
+    Stats measure(int samples = 200000) const;
+
+    // 获取指定类型的时钟源(进程内单例), 不可用时返回 nullptr
+    static const ClockSource *get(Kind kind);
+    // 当前平台可用的时钟源
+    static QList<Kind> available();
+
+    // 全局选用的时钟源, 默认 Realtime
+    static const ClockSource *current();
+    static void setCurrent(Kind kind);
+
+    static QString kindName(Kind kind);
+    static Kind kindFromName(const QString &name, Kind fallback = Realtime);
+};
+
+#endif // CLOCKSOURCE_H
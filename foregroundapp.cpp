@@ -0,0 +1,91 @@
+#include "foregroundapp.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+
+namespace {
+
+void CALLBACK foregroundChanged(HWINEVENTHOOK, DWORD, HWND window, LONG objectId, LONG, DWORD, DWORD)
+{
+    if (objectId == OBJID_WINDOW && window)
+        ForegroundApp::instance()->onSwitched(quintptr(window));
+}
+
+} // namespace
+#endif
+
+ForegroundApp *ForegroundApp::instance()
+{
+    static ForegroundApp app;
+    return &app;
+}
+
+ForegroundApp::~ForegroundApp()
+{
+    setTracking(false);
+}
+
+void ForegroundApp::setTracking(bool enabled)
+{
+    if (enabled == isTracking())
+        return;
+#ifdef Q_OS_WIN
+    if (enabled) {
+        // 进程外回调, 经本线程的消息循环送达; 只在前台切换时唤醒
+        m_hook = SetWinEventHook(EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND, nullptr, foregroundChanged, 0, 0,
+                                 WINEVENT_OUTOFCONTEXT | WINEVENT_SKIPOWNPROCESS);
+        m_window = query();
+    } else {
+        UnhookWinEvent(HWINEVENTHOOK(m_hook));
+        m_hook = nullptr;
+    }
+#endif
+}
+
+const ForegroundApp::Window &ForegroundApp::current()
+{
+    ++m_stats.lookups;
+#ifdef Q_OS_WIN
+    const quintptr id = quintptr(GetForegroundWindow());
+    if (id == m_window.id && id != 0)
+        ++m_stats.hits;
+    else
+        onSwitched(id);
+#endif
+    return m_window;
+}
+
+void ForegroundApp::onSwitched(quintptr id)
+{
+    ++m_stats.switches;
+    m_window = query(id);
+}
+
+ForegroundApp::Window ForegroundApp::query(quintptr id)
+{
+    Window window;
+#ifdef Q_OS_WIN
+    const HWND handle = id ? HWND(id) : GetForegroundWindow();
+    window.id = quintptr(handle);
+    if (!handle)
+        return window;
+
+    wchar_t buffer[MAX_PATH];
+    const int length = GetClassNameW(handle, buffer, MAX_PATH);
+    window.windowClass = QString::fromWCharArray(buffer, length).toLower();
+
+    DWORD processId = 0;
+    GetWindowThreadProcessId(handle, &processId);
+    if (const HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, processId)) {
+        DWORD size = MAX_PATH;
+        if (QueryFullProcessImageNameW(process, 0, buffer, &size)) {
+            const QString path = QString::fromWCharArray(buffer, int(size));
+            window.process = path.mid(path.lastIndexOf('\\') + 1).toLower();
+        }
+        CloseHandle(process);
+    }
+#else
+    window.id = id;
+#endif
+    return window;
+}
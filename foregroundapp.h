@@ -0,0 +1,57 @@
+#ifndef FOREGROUNDAPP_H
+#define FOREGROUNDAPP_H
+
+#include <QString>
+#include <QtGlobal>
+
+/**
+ * 前台窗口的类名与进程名, 供按目标程序选择格式与动作
+ *
+ * 查询进程名需要 OpenProcess 等多次系统调用, 不放在热键路径上: 开启跟踪后以
+ * SetWinEventHook(EVENT_SYSTEM_FOREGROUND) 在前台切换时立即刷新缓存, 按下热键时
+ * current() 只比较一次 GetForegroundWindow() 与缓存的窗口. 钩子未收到的切换
+ * (如跟踪开启前)由这次比较兜底, 届时才同步查询.
+ * 只在 GUI 线程使用; 非 Windows 平台返回空的类名与进程名.
+ */
+class ForegroundApp
+{
+public:
+    struct Window {
+        quintptr id = 0;
+        // 均为小写; 进程名不含路径, 如 "excel.exe"
+        QString windowClass;
+        QString process;
+    };
+
+    struct Stats {
+        // current() 的调用次数, 其中命中缓存的次数
+        quint64 lookups = 0;
+        quint64 hits = 0;
+        // 前台切换事件数
+        quint64 switches = 0;
+    };
+
+    static ForegroundApp *instance();
+
+    // 开启时安装前台切换钩子并立即刷新; 关闭时卸载钩子, 不再有切换回调
+    void setTracking(bool enabled);
+    bool isTracking() const { return m_hook != nullptr; }
+
+    const Window &current();
+    Stats stats() const { return m_stats; }
+    // 前台切换到 id 窗口: 立即刷新缓存
+    void onSwitched(quintptr id);
+
+    // 查询指定窗口(0 为当前前台窗口), 不经缓存
+    static Window query(quintptr id = 0);
+
+private:
+    ForegroundApp() = default;
+    ~ForegroundApp();
+
+    void *m_hook = nullptr;
+    Window m_window;
+    Stats m_stats;
+};
+
+#endif // FOREGROUNDAPP_H
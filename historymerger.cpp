@@ -0,0 +1,231 @@
+#include "historymerger.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QVector>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "idlemanager.h"
+#include "stamphistory.h"
+
+namespace {
+
+struct Run {
+    int host = 0;
+    qint64 sequence = 0;
+    std::unique_ptr<StampHistory::SegmentReader> reader;
+    // 来源下标 -> "机器名:来源", 首次用到时拼接
+    QVector<QString> sources;
+};
+
+// 堆中的一项: 未打开的段以其最早时刻排队, 打开后为当前记录
+struct Head {
+    qint64 timeNs = 0;
+    int host = 0;
+    qint64 sequence = 0;
+    int run = 0;
+    bool opened = false;
+    quint32 format = 0;
+    quint32 source = 0;
+};
+
+// std::push_heap 为最大堆, 比较取反得到最小堆
+bool later(const Head &a, const Head &b)
+{
+    if (a.timeNs != b.timeNs)
+        return a.timeNs > b.timeNs;
+    if (a.host != b.host)
+        return a.host > b.host;
+    return a.sequence > b.sequence;
+}
+
+// "seg-12.tss" / "sealing-12.log" 的序号
+qint64 fileSequence(const QString &fileName)
+{
+    const QString base = QFileInfo(fileName).completeBaseName();
+    return base.mid(base.indexOf('-') + 1).toLongLong();
+}
+
+} // namespace
+
+HistoryMerger::HistoryMerger(const QList<Input> &inputs) :
+    m_inputs(inputs)
+{
+    // 机器序号即机器名的排序位置, 与参数顺序无关
+    std::stable_sort(m_inputs.begin(), m_inputs.end(),
+                     [](const Input &a, const Input &b) { return a.host < b.host; });
+}
+
+HistoryMerger::Input HistoryMerger::parseInput(const QString &argument)
+{
+    Input input;
+    const int separator = argument.indexOf('=');
+    if (separator > 0) {
+        input.host = argument.left(separator);
+        input.directory = argument.mid(separator + 1);
+    } else {
+        input.directory = argument;
+        input.host = QFileInfo(QDir::cleanPath(argument)).fileName();
+    }
+    return input;
+}
+
+bool HistoryMerger::merge(StampHistory *output, QString *error)
+{
+    m_stats = Stats();
+    m_stats.inputs = m_inputs.size();
+    // 之前的峰值(如同一进程先生成了输入)不计入归并
+    const bool peakReset = IdleManager::resetPeakRss();
+    const qint64 startRss = IdleManager::memoryUsage().currentRss;
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    if (output->stats().entries > 0) {
+        if (error)
+            *error = QString("输出目录已有历史: %1").arg(output->directory());
+        return false;
+    }
+
+    QTemporaryDir spill;
+    if (!spill.isValid()) {
+        if (error)
+            *error = QStringLiteral("无法创建临时目录");
+        return false;
+    }
+
+    // 收集输入流; 未封存的日志无序, 先导出为临时段
+    std::vector<Run> runs;
+    std::vector<Head> heap;
+    for (int host = 0; host < m_inputs.size(); ++host) {
+        const QDir dir(m_inputs.at(host).directory);
+        if (!dir.exists()) {
+            if (error)
+                *error = QString("目录不存在: %1").arg(dir.path());
+            return false;
+        }
+        QList<QPair<qint64, QString>> files;
+        qint64 lastSequence = -1;
+        for (const QString &name : dir.entryList({"seg-*.tss"}, QDir::Files)) {
+            files.append({fileSequence(name), dir.filePath(name)});
+            lastSequence = qMax(lastSequence, files.last().first);
+        }
+        // 与 StampHistory::open() 相同: 段文件已存在的封存日志是残留, 其记录已在段中
+        QStringList logs;
+        for (const QString &name : dir.entryList({"sealing-*.log"}, QDir::Files)) {
+            const qint64 sequence = fileSequence(name);
+            lastSequence = qMax(lastSequence, sequence);
+            if (!dir.exists(QString("seg-%1.tss").arg(sequence)))
+                logs.append(name);
+        }
+        if (dir.exists("active.log"))
+            logs.append(QStringLiteral("active.log"));
+        for (const QString &name : std::as_const(logs)) {
+            // active.log 排在所有段与封存日志之后; 临时段以原文件名区分, 不会重名
+            const qint64 sequence = name.startsWith("sealing-") ? fileSequence(name) : lastSequence + 1;
+            const QString path = spill.filePath(QString("%1-%2.tss").arg(host).arg(name));
+            if (!StampHistory::exportLog(dir.filePath(name), path, error))
+                return false;
+            files.append({sequence, path});
+        }
+
+        for (const auto &file : std::as_const(files)) {
+            Run run;
+            run.host = host;
+            run.sequence = file.first;
+            run.reader.reset(new StampHistory::SegmentReader(file.second, m_bufferBytes));
+            // 只读出头部取最早时刻, 缓冲在轮到它时才分配
+            if (!run.reader->open(error))
+                return false;
+            const qint64 minNs = run.reader->minNs();
+            const bool empty = run.reader->count() == 0;
+            run.reader->close();
+            if (empty)
+                continue;
+            Head head;
+            head.timeNs = minNs;
+            head.host = host;
+            head.sequence = run.sequence;
+            head.run = int(runs.size());
+            heap.push_back(head);
+            runs.push_back(std::move(run));
+        }
+    }
+    m_stats.runs = int(runs.size());
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    output->setWriteAheadLog(false);
+    int openRuns = 0;
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Head head = heap.back();
+        heap.pop_back();
+        Run &run = runs[head.run];
+
+        if (!head.opened) {
+            if (!run.reader->open(error))
+                return false;
+            run.sources.resize(run.reader->sources().size());
+            m_stats.maxOpenRuns = qMax(m_stats.maxOpenRuns, ++openRuns);
+        } else {
+            const QStringList &formats = run.reader->formats();
+            const QStringList &sources = run.reader->sources();
+            if (head.format >= quint32(formats.size()) || head.source >= quint32(sources.size())) {
+                if (error)
+                    *error = QString("%1: 下标越界").arg(run.reader->path());
+                return false;
+            }
+            QString &source = run.sources[int(head.source)];
+            if (source.isNull())
+                source = m_inputs.at(run.host).host + QLatin1Char(':') + sources.at(int(head.source));
+            output->append(head.timeNs, formats.at(int(head.format)), source);
+            ++m_stats.entries;
+            // 封存落后时等待, 待封存的批次不无限堆积
+            if (output->pendingCompactions() > 2)
+                output->waitForCompaction();
+        }
+
+        if (run.reader->next(head.timeNs, head.format, head.source)) {
+            head.opened = true;
+            heap.push_back(head);
+            std::push_heap(heap.begin(), heap.end(), later);
+        } else if (!run.reader->atEnd()) {
+            if (error)
+                *error = QString("%1: 读取失败").arg(run.reader->path());
+            return false;
+        } else {
+            run.reader->close();
+            run.sources = QVector<QString>();
+            --openRuns;
+        }
+    }
+
+    output->compact();
+    output->waitForCompaction();
+    output->setWriteAheadLog(true);
+
+    m_stats.elapsedNs = elapsed.nsecsElapsed();
+    m_stats.peakRss = IdleManager::memoryUsage().peakRss;
+    if (peakReset)
+        m_stats.peakRssGrowth = qMax<qint64>(0, m_stats.peakRss - startRss);
+    return true;
+}
+
+QString HistoryMerger::formatStats(const Stats &stats)
+{
+    const double seconds = qMax<qint64>(1, stats.elapsedNs) / 1e9;
+    const QString memory = stats.peakRssGrowth >= 0
+        ? QString("峰值内存 %1 MB, 归并期间增加 %2 MB")
+              .arg(QString::number(stats.peakRss / 1048576.0, 'f', 1), QString::number(stats.peakRssGrowth / 1048576.0, 'f', 1))
+        : QString("进程峰值内存 %1 MB(含归并之前)").arg(QString::number(stats.peakRss / 1048576.0, 'f', 1));
+    return QString("%1 台机器, %2 个段, 同时打开最多 %3 个; 合并 %4 条, 用时 %5 s, %6 M条/s, %7")
+        .arg(stats.inputs)
+        .arg(stats.runs)
+        .arg(stats.maxOpenRuns)
+        .arg(stats.entries)
+        .arg(QString::number(seconds, 'f', 2))
+        .arg(QString::number(stats.entries / seconds / 1e6, 'f', 2))
+        .arg(memory);
+}
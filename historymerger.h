@@ -0,0 +1,63 @@
+#ifndef HISTORYMERGER_H
+#define HISTORYMERGER_H
+
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+class StampHistory;
+
+/**
+ * 多台机器时间戳历史的归并
+ *
+ * 每个输入是一台机器的历史目录; 其中每个段(以及未封存的日志, 先导出为临时段)是一个按时间有序的
+ * 输入流, 用 StampHistory::SegmentReader 以固定大小的缓冲顺序读取. 所有流放在一个最小堆中,
+ * 按 (时间, 机器名, 段序号) 比较, 同一时刻的记录在任意次运行中顺序都相同.
+ * 流在其最早时刻到达堆顶前不打开, 同时打开的流数只取决于时间区间互相重叠的段数,
+ * 内存与总条数无关. 输出仍是 StampHistory 格式, 来源写成 "机器名:原来源".
+ * 任一段读取失败时归并失败, 不会静默截断; 输出目录须为空, 不与已有的历史混在一起.
+ * 峰值内存是整个进程的; 要单独测归并, 在 Linux 上看 peakRssGrowth, 其他平台用只做归并的
+ * 进程(TimestampHotkey_cli --merge-history).
+ */
+class HistoryMerger
+{
+public:
+    struct Input {
+        QString host;
+        QString directory;
+    };
+
+    struct Stats {
+        qint64 entries = 0;
+        int inputs = 0;
+        int runs = 0;
+        // 同时打开的段数峰值
+        int maxOpenRuns = 0;
+        qint64 elapsedNs = 0;
+        // 进程的峰值内存; 开始时能重置峰值的平台上只含归并期间
+        qint64 peakRss = 0;
+        // 归并期间峰值超出开始时占用的部分; 不能重置峰值时为 -1, 此时 peakRss 含归并之前的峰值
+        qint64 peakRssGrowth = -1;
+    };
+
+    explicit HistoryMerger(const QList<Input> &inputs);
+
+    // 每个打开的段三列各用一块此大小的读缓冲
+    void setBufferBytes(int bytes) { m_bufferBytes = qMax(4096, bytes); }
+
+    // output 须已 open() 且没有记录; 归并期间关闭其预写日志, 结束时封存并等待写完
+    bool merge(StampHistory *output, QString *error = nullptr);
+
+    Stats stats() const { return m_stats; }
+    static QString formatStats(const Stats &stats);
+
+    // "机器名=目录" 或只给目录(以目录名为机器名)
+    static Input parseInput(const QString &argument);
+
+private:
+    QList<Input> m_inputs;
+    int m_bufferBytes = 64 * 1024;
+    Stats m_stats;
+};
+
+#endif // HISTORYMERGER_H
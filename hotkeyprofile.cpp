@@ -0,0 +1,320 @@
+#include "hotkeyprofile.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <qhotkey.h>
+#include "worldclock.h"
+
+namespace {
+
+QString keyOf(const QKeySequence &shortcut)
+{
+    return shortcut.toString(QKeySequence::PortableText);
+}
+
+bool actionFromString(const QString &text, const QJsonObject &macros, HotkeyProfile::Action &action)
+{
+    // 同名宏优先, 可覆盖内置的 paste/copy
+    if (macros.contains(text)) {
+        action = HotkeyProfile::Macro;
+        return true;
+    }
+    if (text.isEmpty() || text == QLatin1String("paste")) {
+        action = HotkeyProfile::Paste;
+        return true;
+    }
+    if (text == QLatin1String("copy")) {
+        action = HotkeyProfile::Copy;
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+HotkeyProfile::HotkeyProfile(const QString &path, QObject *parent) :
+    QObject(parent),
+    m_path(path)
+{
+    // 编辑器保存时可能连续写入多次, 合并为一次重新加载
+    m_debounce.setObjectName(QStringLiteral("profileDebounce"));
+    m_debounce.setTimerType(Qt::CoarseTimer);
+    m_debounce.setSingleShot(true);
+    m_debounce.setInterval(100);
+    connect(&m_debounce, &QTimer::timeout, this, &HotkeyProfile::reload);
+
+    connect(&m_watcher, &QFileSystemWatcher::fileChanged, this, [this]() {
+        watchPath();
+        m_debounce.start();
+    });
+    // 以"写临时文件再改名"方式保存的编辑器会让文件监视失效, 通过目录变化补回
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, [this]() {
+        if (!m_watcher.files().contains(m_path) && QFileInfo::exists(m_path)) {
+            watchPath();
+            m_debounce.start();
+        }
+    });
+
+    connect(&m_matcher, &ChordMatcher::matched, this, &HotkeyProfile::onMatched);
+
+    watchPath();
+}
+
+HotkeyProfile::~HotkeyProfile()
+{
+    qDeleteAll(m_bindings);
+}
+
+QList<HotkeyProfile::Entry> HotkeyProfile::entries() const
+{
+    QList<Entry> result;
+    result.reserve(m_bindings.size());
+    for (const Binding *binding : m_bindings)
+        result.append(binding->entry);
+    return result;
+}
+
+QString HotkeyProfile::defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation)
+           + QStringLiteral("/profile.json");
+}
+
+bool HotkeyProfile::writeDefault(const QString &path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QJsonObject entry;
+    entry.insert("shortcut", "Ctrl+`");
+    entry.insert("format", TimestampFormatter::DefaultPattern);
+    entry.insert("action", "paste");
+    QJsonObject root;
+    root.insert("hotkeys", QJsonArray{entry});
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(root).toJson());
+    return file.commit();
+}
+
+bool HotkeyProfile::parse(const QByteArray &data,
+                          QList<Entry> &entries,
+                          QList<int> *sequenceTimeouts,
+                          QString *error,
+                          QJsonArray *sinks,
+                          QJsonObject *macros,
+                          AppRules *apps)
+{
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(data, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        if (error)
+            *error = QString("第 %1 字节: %2").arg(parseError.offset).arg(parseError.errorString());
+        return false;
+    }
+
+    const QJsonArray hotkeys = document.object().value("hotkeys").toArray();
+    const QJsonObject macroConfig = document.object().value("macros").toObject();
+    entries.clear();
+    entries.reserve(hotkeys.size());
+    for (int i = 0; i < hotkeys.size(); ++i) {
+        const QJsonObject object = hotkeys.at(i).toObject();
+
+        Entry entry;
+        entry.shortcut = QKeySequence::fromString(object.value("shortcut").toString(),
+                                                  QKeySequence::PortableText);
+        entry.format = object.value("format").toString(TimestampFormatter::DefaultPattern);
+        entry.allZones = object.value("zones").toBool();
+        entry.macro = object.value("action").toString();
+        if (entry.macro.isEmpty())
+            entry.macro = QStringLiteral("paste");
+        if (entry.shortcut.isEmpty() || !actionFromString(entry.macro, macroConfig, entry.action)) {
+            if (error)
+                *error = QString("第 %1 项无效").arg(i + 1);
+            return false;
+        }
+        const TimestampFormatter formatter(entry.format);
+        if (!formatter.isValid()) {
+            if (error)
+                *error = QString("第 %1 项: %2").arg(i + 1).arg(formatter.errorString());
+            return false;
+        }
+        entries.append(entry);
+    }
+
+    if (sequenceTimeouts) {
+        sequenceTimeouts->clear();
+        const QJsonArray timeouts = document.object().value("sequenceTimeouts").toArray();
+        for (const QJsonValue &timeout : timeouts) {
+            if (timeout.toInt() > 0)
+                sequenceTimeouts->append(timeout.toInt());
+        }
+    }
+    if (apps) {
+        if (!AppRules::parse(document.object().value("apps").toArray(), *apps, error))
+            return false;
+        for (int i = 0; i < apps->size(); ++i) {
+            const QString action = apps->rules().at(i).action;
+            Action unused;
+            if (!action.isEmpty() && !actionFromString(action, macroConfig, unused)) {
+                if (error)
+                    *error = QString("程序规则第 %1 项的动作无效: %2").arg(i + 1).arg(action);
+                return false;
+            }
+        }
+    }
+    if (sinks)
+        *sinks = document.object().value("sinks").toArray();
+    if (macros)
+        *macros = macroConfig;
+    return true;
+}
+
+bool HotkeyProfile::reload()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit loadFailed(QString("无法读取 %1").arg(m_path));
+        return false;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<Entry> entries;
+    QList<int> sequenceTimeouts;
+    QJsonArray sinks;
+    QJsonObject macros;
+    AppRules apps;
+    QString error;
+    if (!parse(file.readAll(), entries, &sequenceTimeouts, &error, &sinks, &macros, &apps)) {
+        // 解析失败时保留当前热键, 等待下一次保存
+        qWarning() << "热键配置解析失败:" << error;
+        emit loadFailed(error);
+        return false;
+    }
+
+    const QPair<quint64, quint64> before = QHotkey::nativeCallCounts();
+    ReloadStats stats;
+    m_matcher.setLevelTimeouts(sequenceTimeouts);
+    apply(entries, stats);
+    const QPair<quint64, quint64> after = QHotkey::nativeCallCounts();
+
+    stats.registerCalls = after.first - before.first;
+    stats.unregisterCalls = after.second - before.second;
+    stats.elapsedUs = timer.nsecsElapsed() / 1000;
+
+    qDebug().nospace() << "热键配置已加载: +" << stats.added << " -" << stats.removed
+                       << " ~" << stats.changed << " =" << stats.unchanged
+                       << ", 注册 " << stats.registerCalls << " 次, 注销 " << stats.unregisterCalls
+                       << " 次, 耗时 " << stats.elapsedUs << " us";
+    emit reloaded(stats);
+    if (sinks != m_sinks) {
+        m_sinks = sinks;
+        emit sinksChanged(m_sinks);
+    }
+    if (macros != m_macros) {
+        m_macros = macros;
+        emit macrosChanged(m_macros);
+    }
+    m_appRules = apps;
+    ForegroundApp::instance()->setTracking(!m_appRules.isEmpty());
+    return true;
+}
+
+void HotkeyProfile::apply(const QList<Entry> &entries, ReloadStats &stats)
+{
+    QHash<QString, const Entry *> wanted;
+    wanted.reserve(entries.size());
+    for (const Entry &entry : entries) {
+        const QString key = keyOf(entry.shortcut);
+        if (wanted.contains(key))
+            qWarning() << "热键重复定义, 以最后一项为准:" << key;
+        wanted.insert(key, &entry);
+    }
+
+    for (auto it = m_bindings.begin(); it != m_bindings.end();) {
+        if (wanted.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        delete it.value();
+        it = m_bindings.erase(it);
+        ++stats.removed;
+    }
+
+    for (auto it = wanted.cbegin(); it != wanted.cend(); ++it) {
+        const Entry &entry = *it.value();
+        Binding *binding = m_bindings.value(it.key());
+
+        if (!binding) {
+            m_bindings.insert(it.key(), new Binding{entry, TimestampFormatter(entry.format)});
+            ++stats.added;
+        } else if (binding->entry.format != entry.format || binding->entry.action != entry.action
+                   || binding->entry.macro != entry.macro || binding->entry.allZones != entry.allZones) {
+            // 按键不变, 无需重新向系统注册
+            if (binding->entry.format != entry.format)
+                binding->formatter = TimestampFormatter(entry.format);
+            binding->entry = entry;
+            ++stats.changed;
+        } else {
+            ++stats.unchanged;
+        }
+    }
+
+    // 重建前缀树; 常驻的首段热键由 ChordMatcher 按差量注册/注销
+    ChordTrie trie;
+    m_targets.clear();
+    m_targets.reserve(m_bindings.size());
+    for (Binding *binding : std::as_const(m_bindings)) {
+        trie.insert(binding->entry.shortcut, m_targets.size());
+        m_targets.append(binding);
+    }
+    m_matcher.setTrie(trie);
+}
+
+void HotkeyProfile::onMatched(int value, qint64 pressNs)
+{
+    const Binding *binding = m_targets.value(value);
+    if (!binding)
+        return;
+    if (binding->entry.shortcut.count() > 1)
+        qDebug() << "多段热键末段按下到匹配(ns):" << m_matcher.lastMatchLatencyNs();
+
+    // 前台程序取自缓存, 规则匹配只查哈希表
+    const TimestampFormatter *formatter = &binding->formatter;
+    Action action = binding->entry.action;
+    QString macro = binding->entry.macro;
+    if (!m_appRules.isEmpty()) {
+        if (const AppRules::Rule *rule = m_appRules.match(ForegroundApp::instance()->current(), binding->entry.shortcut)) {
+            if (rule->hasFormat)
+                formatter = &rule->formatter;
+            if (!rule->action.isEmpty() && actionFromString(rule->action, m_macros, action))
+                macro = rule->action;
+        }
+    }
+
+    if (binding->entry.allZones && m_worldClock)
+        emit triggered(m_worldClock->render(pressNs, *formatter), action, pressNs, macro);
+    else
+        emit triggered(formatter->formatLocal(pressNs), action, pressNs, macro);
+    emit stamped(pressNs, formatter->pattern(), binding->entry.shortcut.toString(QKeySequence::PortableText));
+}
+
+void HotkeyProfile::watchPath()
+{
+    const QString directory = QFileInfo(m_path).absolutePath();
+    if (!m_watcher.directories().contains(directory))
+        m_watcher.addPath(directory);
+    if (QFileInfo::exists(m_path) && !m_watcher.files().contains(m_path))
+        m_watcher.addPath(m_path);
+}
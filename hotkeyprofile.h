@@ -0,0 +1,161 @@
+#ifndef HOTKEYPROFILE_H
+#define HOTKEYPROFILE_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QKeySequence>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+#include "apprules.h"
+#include "chordmatcher.h"
+#include "timestampformatter.h"
+
+class WorldClock;
+
+/**
+ * 热键配置文件
+ *
+ * 配置为 JSON, 每一项把一个热键映射到一个格式和动作:
+ * {
+ *     "hotkeys": [
+ *         { "shortcut": "Ctrl+`", "format": "yyyyMMdd-HHmmsszzz", "action": "paste" },
+ *         { "shortcut": "Ctrl+Shift+`", "format": "yyyy-MM-dd", "action": "copy" },
+ *         { "shortcut": "Ctrl+Shift+D, D", "format": "yyyy-MM-dd", "action": "paste" },
+ *         { "shortcut": "Ctrl+Shift+D, W", "format": "yyyy-MM-dd HH:mm ttt", "action": "copy", "zones": true },
+ *         { "shortcut": "Ctrl+Alt+`", "format": "yyyy-MM-dd", "action": "enter" }
+ *     ],
+ *     "sequenceTimeouts": [1000, 800],
+ *     "macros": {
+ *         "enter": ["clipboard", "ready", "release", "inject Ctrl+V", "delay 50", "inject Return"]
+ *     },
+ *     "sinks": [
+ *         { "type": "file", "path": "D:/stamps.log" },
+ *         { "type": "socket", "name": "timestamp-hotkey", "queue": 64 },
+ *         { "type": "stdout" }
+ *     ],
+ *     "apps": [
+ *         { "process": "windowsterminal.exe", "action": "copy" },
+ *         { "process": "excel.exe", "format": "yyyy-MM-dd'T'HH:mm:ss.zzzttt" }
+ *     ]
+ * }
+ *
+ * 多段热键(如 "Ctrl+Shift+D, D")由 ChordMatcher 匹配, sequenceTimeouts 为各层等待下一段的毫秒数.
+ * 前缀本身也绑定了动作的(如同时定义 "Ctrl+`" 与 "Ctrl+`, D"), 单按前缀要等该层超时
+ * (此例中 1000 ms)仍无下一段才触发, 因此示例的多段热键不以常用的 Ctrl+` 开头.
+ * "zones": true 的项输出世界时钟中每个时区的时间, 每行一个.
+ * "sinks" 为剪贴板之外同时输出的目标, 由 StampPipeline 创建.
+ * "macros" 定义动作宏(见 ActionMacro), "action" 可写宏名; 同名的 "paste"/"copy" 会覆盖内置序列.
+ * "apps" 按按下时的前台程序覆盖格式与动作(见 AppRules), 有规则时才跟踪前台窗口.
+ *
+ * 文件保存后由 QFileSystemWatcher 触发重新加载, 与当前已注册的热键做差量比较:
+ * 只有新增/删除的热键才会调用系统注册/注销, 仅格式或动作变化的项原地更新.
+ */
+class HotkeyProfile : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Action {
+        Paste, // 复制到剪贴板并发送 Ctrl+V/A/C
+        Copy,  // 仅复制到剪贴板
+        Macro  // 执行 "macros" 中的同名宏
+    };
+    Q_ENUM(Action)
+
+    struct Entry {
+        QKeySequence shortcut;
+        QString format;
+        Action action = Paste;
+        // 宏名: "paste"、"copy" 或 "macros" 中的名字
+        QString macro;
+        bool allZones = false;
+    };
+
+    /**
+     * 一次重新加载的统计
+     */
+    struct ReloadStats {
+        int added = 0;
+        int removed = 0;
+        int changed = 0;
+        int unchanged = 0;
+        quint64 registerCalls = 0;
+        quint64 unregisterCalls = 0;
+        qint64 elapsedUs = 0;
+    };
+
+    explicit HotkeyProfile(const QString &path, QObject *parent = nullptr);
+    ~HotkeyProfile() override;
+
+    QString path() const { return m_path; }
+    // 当前生效的热键
+    QList<Entry> entries() const;
+    // 注册失败的热键(文本形式)
+    QStringList failedShortcuts() const { return m_matcher.failedShortcuts(); }
+
+    // "zones" 项使用的世界时钟, 不设置时按本地时间输出
+    void setWorldClock(WorldClock *worldClock) { m_worldClock = worldClock; }
+    // 配置中的 "sinks" 数组
+    QJsonArray sinks() const { return m_sinks; }
+    // 配置中的 "macros" 对象
+    QJsonObject macros() const { return m_macros; }
+    // 配置中的 "apps" 规则
+    const AppRules &appRules() const { return m_appRules; }
+
+    // 默认配置文件路径(用户配置目录下的 profile.json)
+    static QString defaultPath();
+    // 写入仅含 Ctrl+` 的默认配置
+    static bool writeDefault(const QString &path);
+    // 解析配置内容, 失败时返回 false 并写入 error
+    static bool parse(const QByteArray &data,
+                      QList<Entry> &entries,
+                      QList<int> *sequenceTimeouts = nullptr,
+                      QString *error = nullptr,
+                      QJsonArray *sinks = nullptr,
+                      QJsonObject *macros = nullptr,
+                      AppRules *apps = nullptr);
+
+public slots:
+    // 读取文件并与当前热键做差量更新
+    bool reload();
+
+signals:
+    // 热键触发, timestamp 已按该项的格式生成
+    void triggered(const QString &timestamp, HotkeyProfile::Action action, qint64 pressNs, const QString &macro);
+    // 同一次触发, 供历史记录: 按下时刻、格式、热键文本
+    void stamped(qint64 pressNs, const QString &format, const QString &source);
+    void reloaded(const HotkeyProfile::ReloadStats &stats);
+    void loadFailed(const QString &error);
+    // 重新加载后 "sinks" 有变化
+    void sinksChanged(const QJsonArray &sinks);
+    // 重新加载后 "macros" 有变化
+    void macrosChanged(const QJsonObject &macros);
+
+private:
+    struct Binding {
+        Entry entry;
+        TimestampFormatter formatter;
+    };
+
+    void watchPath();
+    void apply(const QList<Entry> &entries, ReloadStats &stats);
+    void onMatched(int value, qint64 pressNs);
+
+    QString m_path;
+    QFileSystemWatcher m_watcher;
+    QTimer m_debounce;
+    // 以 PortableText 形式的热键为键
+    QHash<QString, Binding *> m_bindings;
+    // 前缀树中的值即此列表的下标, 每次重新加载时重建
+    QVector<Binding *> m_targets;
+    ChordMatcher m_matcher;
+    WorldClock *m_worldClock = nullptr;
+    QJsonArray m_sinks;
+    QJsonObject m_macros;
+    AppRules m_appRules;
+};
+
+#endif // HOTKEYPROFILE_H
@@ -0,0 +1,293 @@
+#include "hotkeytrace.h"
+
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QThread>
+#include <QTimer>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <qhotkey.h>
+#include "clocksource.h"
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+namespace {
+
+const char TraceMagic[4] = {'H', 'K', 'T', 'R'};
+const quint32 TraceVersion = 1;
+const int EventBytes = 24;
+
+qint64 percentile(const QVector<qint64> &sorted, double fraction)
+{
+    if (sorted.isEmpty())
+        return 0;
+    const int index = qBound(0, int(fraction * (sorted.size() - 1) + 0.5), sorted.size() - 1);
+    return sorted.at(index);
+}
+
+// 先睡眠到目标前约 2 ms, 再让出时间片等到目标时刻
+void waitUntil(const ClockSource *clock, qint64 targetNs)
+{
+    for (;;) {
+        const qint64 remainingNs = targetNs - clock->nowNs();
+        if (remainingNs <= 0)
+            return;
+        if (remainingNs > 2000000)
+            QThread::usleep(static_cast<unsigned long>((remainingNs - 2000000) / 1000));
+        else
+            QThread::yieldCurrentThread();
+    }
+}
+
+} // namespace
+
+bool HotkeyTrace::save(const QString &path, QString *error) const
+{
+    QByteArray data;
+    data.reserve(12 + events.size() * EventBytes);
+    data.append(TraceMagic, 4);
+    char word[8];
+    qToLittleEndian(TraceVersion, word);
+    data.append(word, 4);
+    qToLittleEndian(quint32(events.size()), word);
+    data.append(word, 4);
+    for (const Event &event : events) {
+        qToLittleEndian(event.timeNs, word);
+        data.append(word, 8);
+        for (quint32 value : {event.kind, event.key, event.modifiers, event.message}) {
+            qToLittleEndian(value, word);
+            data.append(word, 4);
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool HotkeyTrace::load(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    if (data.size() < 12 || std::memcmp(p, TraceMagic, 4) != 0
+        || qFromLittleEndian<quint32>(p + 4) != TraceVersion) {
+        if (error)
+            *error = QString("%1 不是热键事件记录").arg(path);
+        return false;
+    }
+    const quint32 count = qFromLittleEndian<quint32>(p + 8);
+    if (data.size() != 12 + qint64(count) * EventBytes) {
+        if (error)
+            *error = QString("%1 长度不符").arg(path);
+        return false;
+    }
+
+    events.resize(count);
+    p += 12;
+    for (Event &event : events) {
+        event.timeNs = qFromLittleEndian<qint64>(p);
+        event.kind = qFromLittleEndian<quint32>(p + 8);
+        event.key = qFromLittleEndian<quint32>(p + 12);
+        event.modifiers = qFromLittleEndian<quint32>(p + 16);
+        event.message = qFromLittleEndian<quint32>(p + 20);
+        p += EventBytes;
+    }
+    return true;
+}
+
+HotkeyTrace::ReplayStats HotkeyTrace::replay(const ReplayOptions &options) const
+{
+    ReplayStats stats;
+    stats.events = events.size();
+    if (events.isEmpty())
+        return stats;
+
+    const ClockSource *clock = ClockSource::current();
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+
+    // 同一热键的 activated 按投递顺序到达, 每个热键一个按下下标队列用于配对
+    struct Queue {
+        QVector<int> indices;
+        int next = 0;
+    };
+    QHash<QHotkey::NativeShortcut, Queue> queues;
+    for (int i = 0; i < events.size(); ++i) {
+        if (events.at(i).kind != Press)
+            continue;
+        queues[QHotkey::NativeShortcut(events.at(i).key, events.at(i).modifiers)].indices.append(i);
+        ++stats.presses;
+    }
+
+    // 投递时刻由重放线程写入, 对应的 activated 经两次排队送达后才在 GUI 线程读取
+    QVector<qint64> postedNs(events.size(), 0);
+    QVector<qint64> latencies;
+    QVector<qint64> dispatches;
+    latencies.reserve(int(stats.presses));
+    dispatches.reserve(int(stats.presses));
+
+    QEventLoop loop;
+    QList<QHotkey *> hotkeys;
+    for (auto it = queues.begin(); it != queues.end(); ++it) {
+        const QHotkey::NativeShortcut shortcut = it.key();
+        QHotkey *hotkey = new QHotkey(shortcut, true);
+        hotkeys.append(hotkey);
+        QObject::connect(hotkey, &QHotkey::activated, &loop, [&, shortcut, clock](qint64 timestampNs) {
+            const qint64 nowNs = clock->nowNs();
+            Queue &queue = queues[shortcut];
+            if (queue.next >= queue.indices.size())
+                return;
+            const qint64 posted = postedNs.at(queue.indices.at(queue.next++));
+            latencies.append(nowNs - posted);
+            dispatches.append(timestampNs - posted);
+            if (latencies.size() == stats.presses && loop.isRunning())
+                loop.quit();
+        });
+    }
+
+    const double speed = options.speed;
+    const QVector<Event> &trace = events;
+    QThread *driver = QThread::create([&trace, &postedNs, clock, speed]() {
+        const qint64 firstNs = trace.first().timeNs;
+        const qint64 startNs = clock->nowNs();
+        for (int i = 0; i < trace.size(); ++i) {
+            const Event &event = trace.at(i);
+            if (speed > 0)
+                waitUntil(clock, startNs + qint64((event.timeNs - firstNs) / speed));
+            postedNs[i] = clock->nowNs();
+            QHotkey::postNativeEvent(event.kind == Press ? QHotkey::NativeShortcut(event.key, event.modifiers)
+                                                         : QHotkey::NativeShortcut());
+        }
+    });
+    driver->setObjectName(QStringLiteral("HotkeyTrace replay"));
+
+    QTimer drain;
+    drain.setSingleShot(true);
+    QObject::connect(&drain, &QTimer::timeout, &loop, &QEventLoop::quit);
+    QObject::connect(driver, &QThread::finished, &drain, [&drain, &options]() { drain.start(options.drainMs); });
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    driver->start(QThread::TimeCriticalPriority);
+    // 全部送达或最后一次投递后 drainMs 结束
+    loop.exec();
+    driver->wait();
+    stats.elapsedNs = elapsed.nsecsElapsed();
+    delete driver;
+    qDeleteAll(hotkeys);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::sort(dispatches.begin(), dispatches.end());
+    stats.delivered = latencies.size();
+    stats.dropped = stats.presses - stats.delivered;
+    stats.latencyP50Ns = percentile(latencies, 0.5);
+    stats.latencyP99Ns = percentile(latencies, 0.99);
+    stats.latencyMaxNs = latencies.isEmpty() ? 0 : latencies.last();
+    stats.dispatchP50Ns = percentile(dispatches, 0.5);
+    return stats;
+}
+
+QString HotkeyTrace::formatStats(const ReplayStats &stats)
+{
+    auto us = [](qint64 ns) { return QString::number(ns / 1000.0, 'f', 1); };
+    return QString("事件 %1, 热键按下 %2, 送达 %3, 丢失 %4, 用时 %5 ms\n"
+                   "送达延迟 p50 %6 us, p99 %7 us, 最大 %8 us; 分发延迟 p50 %9 us")
+        .arg(stats.events)
+        .arg(stats.presses)
+        .arg(stats.delivered)
+        .arg(stats.dropped)
+        .arg(stats.elapsedNs / 1000000)
+        .arg(us(stats.latencyP50Ns), us(stats.latencyP99Ns), us(stats.latencyMaxNs), us(stats.dispatchP50Ns));
+}
+
+HotkeyTraceRecorder::HotkeyTraceRecorder(int maxEvents) :
+    m_maxEvents(maxEvents)
+{
+}
+
+HotkeyTraceRecorder::~HotkeyTraceRecorder()
+{
+    stop();
+}
+
+bool HotkeyTraceRecorder::start(QThread *thread)
+{
+    if (m_thread)
+        return true;
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(thread ? thread : QThread::currentThread());
+    if (!dispatcher)
+        return false;
+
+    m_trace.events.reserve(qMin(m_maxEvents, 64 * 1024));
+    // 过滤器列表不是线程安全的, 须在所属线程中安装; 后安装的过滤器先被调用
+    auto install = [this, dispatcher]() { dispatcher->installNativeEventFilter(this); };
+    if (dispatcher->thread() == QThread::currentThread())
+        install();
+    else
+        QMetaObject::invokeMethod(dispatcher, install, Qt::BlockingQueuedConnection);
+    m_thread = dispatcher->thread();
+    return true;
+}
+
+void HotkeyTraceRecorder::stop()
+{
+    if (!m_thread)
+        return;
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(m_thread);
+    m_thread = nullptr;
+    if (!dispatcher)
+        return;
+    auto remove = [this, dispatcher]() { dispatcher->removeNativeEventFilter(this); };
+    if (dispatcher->thread() == QThread::currentThread())
+        remove();
+    else
+        QMetaObject::invokeMethod(dispatcher, remove, Qt::BlockingQueuedConnection);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+bool HotkeyTraceRecorder::nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result)
+#else
+bool HotkeyTraceRecorder::nativeEventFilter(const QByteArray &eventType, void *message, long *result)
+#endif
+{
+    Q_UNUSED(eventType)
+    Q_UNUSED(result)
+
+    if (m_trace.events.size() >= m_maxEvents) {
+        ++m_overflow;
+        return false;
+    }
+
+    HotkeyTrace::Event event;
+    event.timeNs = ClockSource::current()->nowNs();
+#ifdef Q_OS_WIN
+    const MSG *msg = static_cast<const MSG *>(message);
+    event.message = msg->message;
+    if (msg->message == WM_HOTKEY) {
+        // 与 QHotkeyPrivateWin 相同的解码
+        event.kind = HotkeyTrace::Press;
+        event.key = HIWORD(msg->lParam);
+        event.modifiers = LOWORD(msg->lParam);
+    }
+#else
+    Q_UNUSED(message)
+#endif
+    m_trace.events.append(event);
+    return false;
+}
@@ -0,0 +1,103 @@
+#ifndef HOTKEYTRACE_H
+#define HOTKEYTRACE_H
+
+#include <QAbstractNativeEventFilter>
+#include <QByteArray>
+#include <QPointer>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * 热键事件流记录与重放
+ *
+ * 记录: HotkeyTraceRecorder 作为原生事件过滤器装在热键监听线程上,
+ * 与 QHotkeyPrivate 看到同一批消息, 每条记下时钟源时间(ns)以及是否为热键按下.
+ *
+ * 重放: HotkeyTrace::replay() 以无头模式(QHotkey::setHeadless)注册记录中出现的热键,
+ * 由独立线程按原始间隔(或按 speed 加速)调用 QHotkey::postNativeEvent 投递事件,
+ * 统计每次按下从投递到 activated 在 GUI 线程送达的延迟, 以及未送达的次数.
+ * 投递时刻只取决于记录与 speed, 同一记录多次重放的输入完全一致.
+ *
+ * 文件格式(小端序): "HKTR", u32 版本, u32 条数, 之后每条 24 字节:
+ * i64 时间(ns), u32 类型, u32 原生键码, u32 原生修饰键, u32 原生消息号
+ */
+class HotkeyTrace
+{
+public:
+    enum Kind : quint32 {
+        Other = 0,  // 被过滤器拒绝的普通消息
+        Press = 1   // 热键按下
+    };
+
+    struct Event {
+        qint64 timeNs = 0;
+        quint32 kind = Other;
+        quint32 key = 0;
+        quint32 modifiers = 0;
+        quint32 message = 0;
+    };
+
+    struct ReplayOptions {
+        // 1 为原始节奏, 10 为 10 倍速, 0 为不等待连续投递
+        double speed = 1.0;
+        // 最后一次投递后等待送达的时间
+        int drainMs = 1000;
+    };
+
+    struct ReplayStats {
+        qint64 events = 0;
+        qint64 presses = 0;
+        qint64 delivered = 0;
+        qint64 dropped = 0;
+        // 投递 -> GUI 线程收到 activated
+        qint64 latencyP50Ns = 0;
+        qint64 latencyP99Ns = 0;
+        qint64 latencyMaxNs = 0;
+        // 投递 -> 过滤器线程分发(activated 携带的时间戳)
+        qint64 dispatchP50Ns = 0;
+        qint64 elapsedNs = 0;
+    };
+
+    QVector<Event> events;
+
+    bool save(const QString &path, QString *error = nullptr) const;
+    bool load(const QString &path, QString *error = nullptr);
+
+    // 在 GUI 线程中调用; 会启用 QHotkey 无头模式, 调用前不得已注册热键
+    ReplayStats replay(const ReplayOptions &options) const;
+
+    static QString formatStats(const ReplayStats &stats);
+};
+
+class HotkeyTraceRecorder : public QAbstractNativeEventFilter
+{
+public:
+    // 超过 maxEvents 条后不再记录, 只计数
+    explicit HotkeyTraceRecorder(int maxEvents = 4 * 1024 * 1024);
+    ~HotkeyTraceRecorder() override;
+
+    // 安装到 thread 的事件分派器上(为空时为当前线程), 会阻塞等待安装完成
+    bool start(QThread *thread = nullptr);
+    void stop();
+
+    // stop() 之后读取
+    const HotkeyTrace &trace() const { return m_trace; }
+    qint64 overflow() const { return m_overflow; }
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *result) override;
+#else
+    bool nativeEventFilter(const QByteArray &eventType, void *message, long *result) override;
+#endif
+
+private:
+    HotkeyTrace m_trace;
+    int m_maxEvents;
+    qint64 m_overflow = 0;
+    // 监听线程随 QHotkey::stopListenerThread 销毁时自动置空, 其分派器与过滤器列表一同销毁
+    QPointer<QThread> m_thread;
+};
+
+#endif // HOTKEYTRACE_H
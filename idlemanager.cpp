@@ -0,0 +1,94 @@
+#include "idlemanager.h"
+
+#include <QFile>
+#include <QPixmapCache>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+
+QString formatMegabytes(qint64 bytes)
+{
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+}
+
+} // namespace
+
+IdleManager::IdleManager(int idleTimeoutMs, QObject *parent) :
+    QObject(parent)
+{
+    // 只触发一次且不要求准时, 允许系统把唤醒与其他事件合并
+    m_timer.setObjectName(QStringLiteral("idleTimer"));
+    m_timer.setTimerType(Qt::VeryCoarseTimer);
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(idleTimeoutMs);
+    connect(&m_timer, &QTimer::timeout, this, &IdleManager::idle);
+}
+
+void IdleManager::touch()
+{
+    m_timer.start();
+}
+
+void IdleManager::releaseMemory()
+{
+    QPixmapCache::clear();
+
+#ifdef Q_OS_WIN
+    HeapCompact(GetProcessHeap(), 0);
+    // 让系统回收工作集, 再次访问的页面会按需调回
+    SetProcessWorkingSetSize(GetCurrentProcess(), static_cast<SIZE_T>(-1), static_cast<SIZE_T>(-1));
+#elif defined(__GLIBC__)
+    malloc_trim(0);
+#endif
+}
+
+IdleManager::MemoryUsage IdleManager::memoryUsage()
+{
+    MemoryUsage usage;
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        usage.currentRss = static_cast<qint64>(counters.WorkingSetSize);
+        usage.peakRss = static_cast<qint64>(counters.PeakWorkingSetSize);
+    }
+#else
+    // /proc/self/status 中 VmRSS 为当前值, VmHWM 为峰值, 单位 kB
+    QFile status(QStringLiteral("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        const QList<QByteArray> lines = status.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            const bool current = line.startsWith("VmRSS:");
+            const bool peak = line.startsWith("VmHWM:");
+            if (!current && !peak)
+                continue;
+            const qint64 kb = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            (current ? usage.currentRss : usage.peakRss) = kb * 1024;
+        }
+    }
+#endif
+    return usage;
+}
+
+bool IdleManager::resetPeakRss()
+{
+#ifdef Q_OS_LINUX
+    // 写入 "5" 把 VmHWM 重置为当前 VmRSS (Linux 4.0 起)
+    QFile clearRefs(QStringLiteral("/proc/self/clear_refs"));
+    return clearRefs.open(QIODevice::WriteOnly) && clearRefs.write("5") == 1;
+#else
+    // Windows 的 PeakWorkingSetSize 没有重置接口
+    return false;
+#endif
+}
+
+QString IdleManager::memoryReport()
+{
+    const MemoryUsage usage = memoryUsage();
+    return QString("当前 %1, 峰值 %2").arg(formatMegabytes(usage.currentRss), formatMegabytes(usage.peakRss));
+}
@@ -0,0 +1,49 @@
+#ifndef IDLEMANAGER_H
+#define IDLEMANAGER_H
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+/**
+ * 空闲管理
+ *
+ * 托盘程序绝大部分时间处于空闲状态. 每次用户操作调用 touch() 重新计时,
+ * 超过 idleTimeoutMs 没有操作时发出 idle(), 由调用方销毁按需创建的界面,
+ * 再调用 releaseMemory() 归还缓存和空闲内存.
+ */
+class IdleManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * 进程内存占用(字节)
+     */
+    struct MemoryUsage {
+        qint64 currentRss = 0;
+        qint64 peakRss = 0;
+    };
+
+    explicit IdleManager(int idleTimeoutMs, QObject *parent = nullptr);
+
+    // 记录一次用户操作, 重新开始空闲计时
+    void touch();
+
+    // 清空像素图缓存, 整理堆并裁剪工作集
+    static void releaseMemory();
+
+    static MemoryUsage memoryUsage();
+    // 把峰值重置为当前占用, 之后的 peakRss 只反映此后的增长; 不支持的平台返回 false
+    static bool resetPeakRss();
+    // 例: "当前 12.3 MB, 峰值 25.1 MB"
+    static QString memoryReport();
+
+signals:
+    void idle();
+
+private:
+    QTimer m_timer;
+};
+
+#endif // IDLEMANAGER_H
@@ -0,0 +1,361 @@
+#include "logrestamper.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtAlgorithms>
+#include <cstring>
+#include "timestampformatter.h"
+#include "worldclock.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOGRESTAMPER_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline bool isDigit(char c)
+{
+    return static_cast<unsigned char>(c - '0') < 10;
+}
+
+inline int digits2(const char *p)
+{
+    return (p[0] - '0') * 10 + (p[1] - '0');
+}
+
+inline int digits3(const char *p)
+{
+    return (p[0] - '0') * 100 + (p[1] - '0') * 10 + (p[2] - '0');
+}
+
+/**
+ * 由公历年月日求自 1970-01-01 起的天数 (Howard Hinnant 的 days_from_civil)
+ */
+inline qint64 daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const qint64 era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<qint64>(doe) - 719468;
+}
+
+/**
+ * 以 dash 处的 '-' 为中心验证 yyyyMMdd-HHmmsszzz:
+ * 前 8 位、后 9 位都是数字, 两侧不再紧跟数字, 各字段在合法范围内
+ */
+inline bool isStampAt(const char *dash, const char *begin, const char *end)
+{
+    const char *start = dash - 8;
+    if (start < begin || end - dash < 10)
+        return false;
+
+#ifdef LOGRESTAMPER_HAS_SSE2
+    // 一次比较 start..start+15 (8 位日期, '-', 前 7 位时间) 是否为数字
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(start));
+    const __m128i geZero = _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8('0')), v);
+    const __m128i leNine = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8('9')), v);
+    if (_mm_movemask_epi8(_mm_and_si128(geZero, leNine)) != 0xFEFF)
+        return false;
+    if (!isDigit(dash[8]) || !isDigit(dash[9]))
+        return false;
+#else
+    for (int i = 0; i < 8; ++i) {
+        if (!isDigit(start[i]))
+            return false;
+    }
+    for (int i = 1; i <= 9; ++i) {
+        if (!isDigit(dash[i]))
+            return false;
+    }
+#endif
+
+    if (start > begin && isDigit(start[-1]))
+        return false;
+    if (end - dash > 10 && isDigit(dash[10]))
+        return false;
+
+    const int month = digits2(start + 4);
+    const int day = digits2(start + 6);
+    return month >= 1 && month <= 12 && day >= 1 && day <= 31
+           && digits2(dash + 1) < 24 && digits2(dash + 3) < 60 && digits2(dash + 5) <= 60;
+}
+
+/**
+ * 时区在 [ZoneFirstYear, ZoneLastYear] 内的偏移表; 无效时区返回空表
+ */
+ZoneOffsetTable zoneTable(const QTimeZone &zone)
+{
+    if (!zone.isValid())
+        return ZoneOffsetTable();
+    const qint64 fromNs = daysFromCivil(LogRestamper::ZoneFirstYear, 1, 1) * 86400 * 1000000000LL;
+    const qint64 toNs = daysFromCivil(LogRestamper::ZoneLastYear + 1, 1, 1) * 86400 * 1000000000LL;
+    return ZoneOffsetTable(zone, fromNs, toNs);
+}
+
+struct Chunk {
+    const char *begin = nullptr;
+    const char *end = nullptr;
+    QByteArray output; // 在各批次间复用
+    qint64 stamps = 0;
+};
+
+class Converter
+{
+public:
+    Converter(const LogRestamper::Options &options) :
+        inputOffset(options.inputOffsetSecs),
+        outputOffset(options.outputOffsetSecs),
+        inputByZone(options.inputZone.isValid()),
+        outputByZone(options.outputZone.isValid()),
+        inputTable(zoneTable(options.inputZone)),
+        outputTable(zoneTable(options.outputZone)),
+        epochMs(options.outputFormat == QLatin1String("epoch-ms")),
+        formatter(options.outputFormat == QLatin1String("iso")
+                      ? QString::fromLatin1(TimestampFormatter::IsoPattern)
+                      : options.outputFormat)
+    {
+        maxLength = epochMs ? 20 : formatter.maxLength();
+    }
+
+    void convert(Chunk &chunk) const
+    {
+        const qint64 inputBytes = chunk.end - chunk.begin;
+        // 最坏情况下每 18 字节的时间戳都展开为 maxLength 字节
+        const int ratio = qMax(1, (maxLength + LogRestamper::StampLength - 1) / LogRestamper::StampLength);
+        const qint64 capacity = inputBytes * ratio + maxLength;
+        if (chunk.output.capacity() < capacity)
+            chunk.output.reserve(capacity);
+        chunk.output.resize(capacity);
+
+        char *out = chunk.output.data();
+        const char *p = chunk.begin;
+        qint64 stamps = 0;
+        while (p < chunk.end) {
+            const char *stamp = LogRestamper::findStamp(p, chunk.end);
+            std::memcpy(out, p, static_cast<size_t>(stamp - p));
+            out += stamp - p;
+            if (stamp == chunk.end)
+                break;
+
+            out += write(out, parse(stamp));
+            p = stamp + LogRestamper::StampLength;
+            ++stamps;
+        }
+
+        chunk.output.resize(out - chunk.output.constData());
+        chunk.stamps = stamps;
+    }
+
+private:
+    qint64 parse(const char *stamp) const
+    {
+        if (!inputByZone)
+            return LogRestamper::parseStamp(stamp, inputOffset);
+        // 墙上时间换算 UTC: 先把它当作 UTC 取一次偏移, 再按换算出的时刻取一次;
+        // 切换点两侧各一小时内第一次可能取错, 第二次即为该时刻的偏移
+        const qint64 wallNs = LogRestamper::parseStamp(stamp, 0);
+        const qint64 guessNs = wallNs - qint64(inputTable.offsetAt(wallNs)) * 1000000000LL;
+        return wallNs - qint64(inputTable.offsetAt(guessNs)) * 1000000000LL;
+    }
+
+    int write(char *out, qint64 ns) const
+    {
+        if (!epochMs)
+            return formatter.formatTo(out, ns, outputByZone ? outputTable.offsetAt(ns) : outputOffset);
+
+        qint64 ms = ns / 1000000;
+        char buffer[24];
+        int n = 0;
+        const bool negative = ms < 0;
+        quint64 value = negative ? static_cast<quint64>(-ms) : static_cast<quint64>(ms);
+        do {
+            buffer[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        char *p = out;
+        if (negative)
+            *p++ = '-';
+        while (n)
+            *p++ = buffer[--n];
+        return static_cast<int>(p - out);
+    }
+
+    int inputOffset;
+    int outputOffset;
+    bool inputByZone;
+    bool outputByZone;
+    ZoneOffsetTable inputTable;
+    ZoneOffsetTable outputTable;
+    bool epochMs;
+    TimestampFormatter formatter;
+    int maxLength = 0;
+};
+
+} // namespace
+
+LogRestamper::LogRestamper(const Options &options) :
+    m_options(options)
+{
+}
+
+const char *LogRestamper::findStamp(const char *begin, const char *end)
+{
+    // 时间戳中的 '-' 位于第 9 个字节, 从 begin + 8 开始找
+    const char *p = begin + 8;
+
+#ifdef LOGRESTAMPER_HAS_SSE2
+    const __m128i dash = _mm_set1_epi8('-');
+    while (end - p >= 16) {
+        quint32 mask = static_cast<quint32>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), dash)));
+        while (mask) {
+            const char *candidate = p + qCountTrailingZeroBits(mask);
+            if (isStampAt(candidate, begin, end))
+                return candidate - 8;
+            mask &= mask - 1;
+        }
+        p += 16;
+    }
+#endif
+
+    for (; p < end; ++p) {
+        if (*p == '-' && isStampAt(p, begin, end))
+            return p - 8;
+    }
+    return end;
+}
+
+qint64 LogRestamper::parseStamp(const char *p, int offsetSecs)
+{
+    const int year = digits2(p) * 100 + digits2(p + 2);
+    const qint64 days = daysFromCivil(year, digits2(p + 4), digits2(p + 6));
+    const qint64 secs = days * 86400 + digits2(p + 9) * 3600 + digits2(p + 11) * 60 + digits2(p + 13)
+                        - offsetSecs;
+    return secs * 1000000000LL + static_cast<qint64>(digits3(p + 15)) * 1000000LL;
+}
+
+bool LogRestamper::parseOffset(const QString &text, int &offsetSecs)
+{
+    const QString t = text.trimmed();
+    if (t.compare(QLatin1String("Z"), Qt::CaseInsensitive) == 0 || t.compare(QLatin1String("UTC"), Qt::CaseInsensitive) == 0) {
+        offsetSecs = 0;
+        return true;
+    }
+    if (t.size() >= 3 && (t.at(0) == QLatin1Char('+') || t.at(0) == QLatin1Char('-'))) {
+        QString digits = t.mid(1);
+        digits.remove(QLatin1Char(':'));
+        bool ok = false;
+        const int value = digits.toInt(&ok);
+        if (!ok || (digits.size() != 2 && digits.size() != 4))
+            return false;
+        const int hours = digits.size() == 4 ? value / 100 : value;
+        const int minutes = digits.size() == 4 ? value % 100 : 0;
+        if (hours > 18 || minutes >= 60)
+            return false;
+        offsetSecs = (hours * 3600 + minutes * 60) * (t.at(0) == QLatin1Char('-') ? -1 : 1);
+        return true;
+    }
+    bool ok = false;
+    const int secs = t.toInt(&ok);
+    if (ok)
+        offsetSecs = secs;
+    return ok;
+}
+
+bool LogRestamper::run(Stats *stats, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    if (m_options.outputFormat != QLatin1String("iso") && m_options.outputFormat != QLatin1String("epoch-ms")) {
+        const TimestampFormatter formatter(m_options.outputFormat);
+        if (!formatter.isValid())
+            return fail(QString("无效的输出格式: %1").arg(formatter.errorString()));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QFile input(m_options.inputPath);
+    if (!input.open(QIODevice::ReadOnly))
+        return fail(QString("无法打开输入文件: %1").arg(input.errorString()));
+
+    QFile output;
+    bool opened = false;
+    if (m_options.outputPath.isEmpty() || m_options.outputPath == QLatin1String("-")) {
+        opened = output.open(stdout, QIODevice::WriteOnly);
+    } else {
+        output.setFileName(m_options.outputPath);
+        opened = output.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    }
+    if (!opened)
+        return fail(QString("无法打开输出文件: %1").arg(output.errorString()));
+
+    Stats result;
+    result.bytesIn = input.size();
+
+    const Converter converter(m_options);
+    const int threads = m_options.threads > 0 ? m_options.threads : QThread::idealThreadCount();
+    const qint64 chunkBytes = qMax<qint64>(m_options.chunkBytes, 64 * 1024);
+
+    if (result.bytesIn > 0) {
+        const uchar *mapped = input.map(0, result.bytesIn);
+        if (!mapped)
+            return fail(QString("无法映射输入文件: %1").arg(input.errorString()));
+
+        const char *data = reinterpret_cast<const char *>(mapped);
+        const char *end = data + result.bytesIn;
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        // 同时在途的块数有上限, 内存占用与文件大小无关
+        QVector<Chunk> chunks(threads * 2);
+
+        const char *p = data;
+        while (p < end) {
+            int count = 0;
+            while (count < chunks.size() && p < end) {
+                const char *chunkEnd = (end - p > chunkBytes) ? p + chunkBytes : end;
+                if (chunkEnd < end) {
+                    // 延伸到下一个换行之后, 保证时间戳不会跨块
+                    const void *newline = std::memchr(chunkEnd, '\n', static_cast<size_t>(end - chunkEnd));
+                    chunkEnd = newline ? static_cast<const char *>(newline) + 1 : end;
+                }
+                chunks[count].begin = p;
+                chunks[count].end = chunkEnd;
+                p = chunkEnd;
+                ++count;
+            }
+
+            for (int i = 0; i < count; ++i) {
+                Chunk *chunk = &chunks[i];
+                pool.start([&converter, chunk]() { converter.convert(*chunk); });
+            }
+            pool.waitForDone();
+
+            for (int i = 0; i < count; ++i) {
+                const Chunk &chunk = chunks.at(i);
+                if (output.write(chunk.output) != chunk.output.size())
+                    return fail(QString("写入失败: %1").arg(output.errorString()));
+                result.bytesOut += chunk.output.size();
+                result.stamps += chunk.stamps;
+            }
+        }
+        input.unmap(const_cast<uchar *>(mapped));
+    }
+
+    output.flush();
+    result.elapsedNs = timer.nsecsElapsed();
+    if (stats)
+        *stats = result;
+    return true;
+}
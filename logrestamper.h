@@ -0,0 +1,72 @@
+#ifndef LOGRESTAMPER_H
+#define LOGRESTAMPER_H
+
+#include <QString>
+#include <QTimeZone>
+#include <QtGlobal>
+
+/**
+ * 日志时间戳转换
+ *
+ * 在日志中查找本程序生成的 yyyyMMdd-HHmmsszzz 时间戳, 转换为 ISO 8601、
+ * 毫秒级 Unix 时间或任意 TimestampFormatter 格式, 也可同时换算时区.
+ * 时区可以是固定的 UTC 偏移, 也可以是 QTimeZone: 后者按每个时间戳自己的时刻取偏移,
+ * 跨夏令时切换的日志也能正确换算. 偏移表(ZoneOffsetTable)在开始前一次算好, 转换中
+ * 只做二分查找. 输入中夏令时回拨时重复的一小时按标准时间(后一次)理解.
+ *
+ * 输入文件以内存映射方式读取, 按行边界切分为块, 由线程池并行处理;
+ * 每个块写入各自复用的输出缓冲(处理过程中不按行分配内存), 再按原顺序写出.
+ */
+class LogRestamper
+{
+public:
+    struct Options {
+        QString inputPath;
+        QString outputPath;
+        // "iso", "epoch-ms" 或 TimestampFormatter 格式串
+        QString outputFormat = QStringLiteral("iso");
+        // 输入时间戳所在时区的 UTC 偏移, 及输出使用的 UTC 偏移(秒)
+        int inputOffsetSecs = 0;
+        int outputOffsetSecs = 0;
+        // 有效时代替上面的固定偏移, 逐个时间戳按该时区当时的偏移换算
+        QTimeZone inputZone;
+        QTimeZone outputZone;
+        int threads = 0; // 0 表示 QThread::idealThreadCount()
+        qint64 chunkBytes = 8 * 1024 * 1024;
+    };
+
+    struct Stats {
+        qint64 bytesIn = 0;
+        qint64 bytesOut = 0;
+        qint64 stamps = 0;
+        qint64 elapsedNs = 0;
+
+        double gigabytesPerSecond() const
+        {
+            return elapsedNs > 0 ? static_cast<double>(bytesIn) / elapsedNs : 0;
+        }
+    };
+
+    explicit LogRestamper(const Options &options);
+
+    // 执行转换, 失败时返回 false 并写入 error
+    bool run(Stats *stats = nullptr, QString *error = nullptr);
+
+    // 解析 "+08:00" / "-0530" / "Z" / 秒数 形式的 UTC 偏移
+    static bool parseOffset(const QString &text, int &offsetSecs);
+
+    // 查找 [begin, end) 中的下一个合法时间戳, 返回其起始位置, 找不到时返回 end
+    static const char *findStamp(const char *begin, const char *end);
+    // 解析 p 处的 18 字节时间戳为 Unix 纳秒(按 offsetSecs 所在时区)
+    static qint64 parseStamp(const char *p, int offsetSecs);
+
+    static constexpr int StampLength = 18;
+    // 按时区换算时偏移表覆盖的年份, 之外的时间戳取两端的偏移
+    static constexpr int ZoneFirstYear = 1970;
+    static constexpr int ZoneLastYear = 2100;
+
+private:
+    Options m_options;
+};
+
+#endif // LOGRESTAMPER_H
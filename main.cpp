@@ -10,61 +10,144 @@
  * 4. 自动模拟键盘操作: Ctrl+V(粘贴) -> Ctrl+A(全选) -> Ctrl+C(复制)
  * 5. 以系统托盘方式运行,无主窗口界面
  * 6. 双击托盘图标显示时间窗口,可复制格式化时间
+ * 7. 可选时钟源(realtime/coarse/tsc), 格式支持微秒(uuu)/纳秒(nnn)
+ * 8. 热键由配置文件 profile.json 定义, 保存后自动增量重新加载
+ * 9. 热键监听在独立线程中运行, GUI 线程繁忙时仍按实际按下时刻生成时间戳
+ * 10. 世界时钟: 时间窗口与热键("zones": true)可同时输出多个时区的时间
+ * 11. 空闲一段时间后销毁时间窗口并释放缓存, 需要时再重建
+ * 12. 唤醒统计: 空闲时不产生周期性定时器唤醒
+ * 13. 时间戳历史: 每次生成的时间戳追加到历史, 后台封存为压缩的列式段
+ * 14. 监听线程来不及处理时, 时间戳按原生按键消息的时刻(MSG::time)校正
+ * 15. 同一时间戳可同时输出到剪贴板、文件、本地套接字与标准输出, 慢输出不影响剪贴板
+ * 16. 历史按分钟/小时/天维护计数汇总, 时间窗口显示本小时/今天/近 7 天的时间戳数
+ * 17. 粘贴序列由动作宏描述(协程执行), 可在配置中自定义宏并绑定到热键
+ * 18. 发送 Ctrl+V/A/C 前等热键与修饰键松开, 按住的键不会与注入的组合键混在一起
+ * 19. 可选: 粘贴完成后恢复用户原有的剪贴板内容(托盘菜单开启)
+ * 20. 按前台程序(进程名/窗口类名)选择格式与动作, 前台窗口在切换时查询并缓存
+ * 21. 时间戳通知在热键处理之外显示, 连按合并为一个气泡并限制频率
+ * 22. 命令行工具(TimestampHotkey_cli --memory-report)可经本地套接字查询本实例的内存占用
+ *
+ * 命令行:
+ *   --record-trace <文件>  正常启动, 记录热键监听线程收到的原生事件, 退出时写入文件
+ *   --profile <文件>     使用指定的热键配置, 而不是用户配置目录下的 profile.json
+ *   --history <目录>     时间戳历史写入指定目录
  */
 
 
 //什么都没有做, 只是测试推送
 #include <QAction>
+#include <QActionGroup>
 #include <QApplication>
 #include <QClipboard>
 #include <QColor>
+#include <QCommandLineParser>
 #include <QDateTime>
 #include <QDebug>
+#include <QDesktopServices>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QIcon>
+#include <QJsonArray>
+#include <QJsonObject>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPixmap>
+#include <QSettings>
 #include <QSystemTrayIcon>
 #include <QTimer>
+#include <QUrl>
 #include <QWidget>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QPushButton>
 #include <QLineEdit>
+#include "clocksource.h"
+#include "hotkeyprofile.h"
+#include "hotkeytrace.h"
+#include "idlemanager.h"
+#include "stamphistory.h"
+#include "stampsinks.h"
+#include "statusserver.h"
+#include "timestampformatter.h"
 #include "timewindow.h"
+#include "traynotifier.h"
+#include "wakeupmonitor.h"
+#include "worldclock.h"
 #include <qhotkey.h>
-#include <windows.h>
-
-/**
- * 发送组合键(按下modifier + key,然后释放)
- */
-void sendKeyCombo(BYTE modifier, BYTE key)
-{
-    keybd_event(modifier, 0, 0, 0);
-    Sleep(10);
-    keybd_event(key, 0, 0, 0);
-    Sleep(10);
-    keybd_event(key, 0, KEYEVENTF_KEYUP, 0);
-    Sleep(10);
-    keybd_event(modifier, 0, KEYEVENTF_KEYUP, 0);
-}
+#include "pastesequence.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
 
+    app.setOrganizationName("TimestampHotkey");
     app.setApplicationName("TimestampHotkey");
     app.setApplicationVersion("1.1");
     app.setQuitOnLastWindowClosed(false);
 
+    // ========== 命令行参数 ==========
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({"record-trace", "记录热键监听线程收到的原生事件, 退出时写入文件", "文件"});
+    parser.addOption({"profile", "热键配置文件", "文件"});
+    parser.addOption({"history", "时间戳历史目录", "目录"});
+    parser.process(app);
+
+    // ========== 读取设置 ==========
+    QSettings settings;
+    ClockSource::setCurrent(ClockSource::kindFromName(settings.value("clockSource").toString()));
+
     if (!QSystemTrayIcon::isSystemTrayAvailable()) {
         QMessageBox::critical(nullptr, "错误", "系统不支持托盘图标功能!");
         return 1;
     }
 
-    // ========== 创建时间窗口 ==========
-    TimeWindow *timeWindow = new TimeWindow();
+    // ========== 世界时钟 ==========
+    // 时区列表来自设置 worldClock/zones, 偏移表在首次渲染时按当年计算
+    WorldClock worldClock(settings.value("worldClock/zones").toStringList());
+
+    // ========== 时间戳历史 ==========
+    StampHistory history(parser.isSet("history") ? parser.value("history") : StampHistory::defaultDirectory());
+    QString historyError;
+    if (!history.open(&historyError))
+        qDebug() << "无法打开时间戳历史:" << historyError;
+
+    // ========== 时间窗口(按需创建, 空闲后销毁) ==========
+    TimeWindow *timeWindow = nullptr;
+    IdleManager idleManager(settings.value("idleTimeoutSec", 300).toInt() * 1000);
+
+    auto showTimeWindow = [&timeWindow, &worldClock, &history, &idleManager]() {
+        if (!timeWindow) {
+            QElapsedTimer timer;
+            timer.start();
+            timeWindow = new TimeWindow(&worldClock, &history);
+            qDebug() << "重建时间窗口耗时(us):" << timer.nsecsElapsed() / 1000;
+        }
+        timeWindow->show();
+        timeWindow->raise();
+        timeWindow->activateWindow();
+        idleManager.touch();
+    };
+
+    QObject::connect(&idleManager, &IdleManager::idle, [&timeWindow, &idleManager]() {
+        if (timeWindow && timeWindow->isVisible()) {
+            idleManager.touch();
+            return;
+        }
+        const QString before = IdleManager::memoryReport();
+        delete timeWindow;
+        timeWindow = nullptr;
+        IdleManager::releaseMemory();
+        qDebug() << "进入空闲模式, 内存:" << before << "->" << IdleManager::memoryReport();
+    });
+
+    // ========== 状态查询(供命令行工具) ==========
+    StatusServer statusServer;
+    QString statusError;
+    if (!statusServer.listen(&statusError))
+        qDebug() << "状态查询不可用:" << statusError;
 
     // ========== 创建系统托盘图标 ==========
     QSystemTrayIcon trayIcon;
@@ -76,9 +159,48 @@ int main(int argc, char *argv[])
     // ========== 创建托盘右键菜单 ==========
     QMenu trayMenu;
     QAction *showWindowAction = trayMenu.addAction("显示时间窗口");
+    QAction *editProfileAction = trayMenu.addAction("编辑热键配置");
     QAction *aboutAction = trayMenu.addAction("关于程序");
     QAction *statusAction = trayMenu.addAction("状态: 监听中");
     statusAction->setEnabled(false);
+    QAction *memoryAction = trayMenu.addAction("内存占用");
+    QAction *wakeupAction = trayMenu.addAction("唤醒统计");
+    QAction *sinkAction = trayMenu.addAction("输出统计");
+    QAction *notifyAction = trayMenu.addAction("时间戳通知");
+    notifyAction->setCheckable(true);
+    notifyAction->setChecked(settings.value("stampNotifications", true).toBool());
+    QAction *restoreClipboardAction = trayMenu.addAction("粘贴后恢复原剪贴板");
+    restoreClipboardAction->setCheckable(true);
+    restoreClipboardAction->setChecked(settings.value("restoreClipboard", false).toBool());
+
+    // 时钟源选择, 每项附带实测的读取耗时与步进; 第一次打开菜单时才测量, 不拖慢启动
+    QMenu *clockMenu = trayMenu.addMenu("时钟源");
+    QActionGroup *clockGroup = new QActionGroup(clockMenu);
+    for (ClockSource::Kind kind : ClockSource::available()) {
+        QAction *clockAction = clockMenu->addAction(ClockSource::get(kind)->name());
+        clockAction->setData(int(kind));
+        clockAction->setCheckable(true);
+        clockAction->setChecked(kind == ClockSource::current()->kind());
+        clockAction->setActionGroup(clockGroup);
+        QObject::connect(clockAction, &QAction::triggered, [kind]() {
+            ClockSource::setCurrent(kind);
+            QSettings().setValue("clockSource", ClockSource::kindName(kind));
+            qDebug() << "切换时钟源:" << ClockSource::kindName(kind);
+        });
+    }
+    QObject::connect(clockMenu, &QMenu::aboutToShow, [clockMenu, measured = false]() mutable {
+        if (measured)
+            return;
+        measured = true;
+        for (QAction *clockAction : clockMenu->actions()) {
+            const ClockSource *source = ClockSource::get(ClockSource::Kind(clockAction->data().toInt()));
+            const ClockSource::Stats stats = source->measure(20000);
+            clockAction->setText(QString("%1 (读取 %2 ns, 步进 %3 ns)")
+                                     .arg(source->name())
+                                     .arg(stats.readCostNs, 0, 'f', 1)
+                                     .arg(stats.granularityNs));
+        }
+    });
     trayMenu.addSeparator();
     QAction *quitAction = trayMenu.addAction("退出程序");
 
@@ -90,53 +212,124 @@ int main(int argc, char *argv[])
                          QSystemTrayIcon::Information,
                          3000);
 
-    // ========== 注册全局热键 ==========
-    QHotkey *hotkey = new QHotkey(QKeySequence("Ctrl+`"), true, &app);
+    // ========== 热键监听线程 ==========
+    // 必须在注册任何热键之前启动; 按下时刻在监听线程中用所选时钟源记录.
+    // 退出时(aboutToQuit)由 QHotkey 释放其中的系统注册并停止线程
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    if (settings.value("listenerThread", true).toBool() && !QHotkey::startListenerThread())
+        qDebug() << "热键监听线程启动失败, 改为在 GUI 线程中监听";
+
+    // 事件记录须与 QHotkeyPrivate 装在同一线程的分派器上
+    HotkeyTraceRecorder traceRecorder;
+    if (parser.isSet("record-trace") && !traceRecorder.start(QHotkey::listenerThread()))
+        qDebug() << "无法开始记录热键事件";
+
+    // ========== 唤醒统计 ==========
+    WakeupMonitor wakeupMonitor;
+    if (QHotkey::listenerThread())
+        wakeupMonitor.watchThread(QHotkey::listenerThread(), "hotkey");
+
+    // ========== 加载热键配置 ==========
+    const QString profilePath = parser.isSet("profile") ? parser.value("profile") : HotkeyProfile::defaultPath();
+    if (!QFileInfo::exists(profilePath) && !HotkeyProfile::writeDefault(profilePath))
+        qDebug() << "无法创建默认热键配置:" << profilePath;
 
-    if (hotkey->isRegistered()) {
-        qDebug() << "全局热键  Ctrl+` 注册成功";
+    HotkeyProfile *profile = new HotkeyProfile(profilePath, &app);
+    profile->setWorldClock(&worldClock);
+    profile->reload();
+
+    if (profile->failedShortcuts().isEmpty()) {
+        qDebug() << "全局热键注册成功, 共" << profile->entries().size() << "项";
     } else {
-        qDebug() << "全局热键注册失败!";
-        QMessageBox::warning(nullptr, "警告", "热键  Ctrl+` 注册失败!\n可能已被其他程序占用。");
+        qDebug() << "全局热键注册失败:" << profile->failedShortcuts();
+        QMessageBox::warning(nullptr, "警告",
+                             QString("热键 %1 注册失败!\n可能已被其他程序占用。")
+                                 .arg(profile->failedShortcuts().join(", ")));
     }
 
-    // ========== 热键触发事件 ==========
-    QObject::connect(hotkey, &QHotkey::activated, [&trayIcon]() {
-        QDateTime now = QDateTime::currentDateTime();
-        QString timestamp = now.toString("yyyyMMdd-HHmmsszzz");
+    QObject::connect(profile, &HotkeyProfile::reloaded, [profile, &trayIcon](const HotkeyProfile::ReloadStats &stats) {
+        QString message = QString("新增 %1, 删除 %2, 修改 %3")
+                              .arg(stats.added)
+                              .arg(stats.removed)
+                              .arg(stats.changed);
+        if (!profile->failedShortcuts().isEmpty())
+            message += QString("\n注册失败: %1").arg(profile->failedShortcuts().join(", "));
+        trayIcon.showMessage("热键配置已重新加载", message, QSystemTrayIcon::Information, 2000);
+    });
 
-        qDebug() << "热键触发! 生成时间戳:" << timestamp;
+    QObject::connect(profile, &HotkeyProfile::loadFailed, [&trayIcon](const QString &error) {
+        trayIcon.showMessage("热键配置加载失败", error, QSystemTrayIcon::Warning, 3000);
+    });
 
-        QClipboard *clipboard = QApplication::clipboard();
-        clipboard->setText(timestamp);
-        qDebug() << "时间戳已复制到剪贴板";
+    // ========== 时间戳历史 ==========
+    QObject::connect(profile, &HotkeyProfile::stamped, [&history](qint64 pressNs, const QString &format, const QString &source) {
+        // 时间戳取自原生事件时刻; 这里的偏差即事件循环积压, 已不再计入时间戳
+        const QHotkey::FilterStats filter = QHotkey::nativeFilterStats();
+        qDebug() << "按键到处理偏差(us):" << (ClockSource::current()->nowNs() - pressNs) / 1000
+                 << "其中按键到过滤器(us):" << filter.skewLastNs / 1000;
+        history.append(pressNs, format, source);
+        history.flush();
+    });
 
-        QTimer::singleShot(125, []() {
-            sendKeyCombo(VK_CONTROL, 'V');
-            qDebug() << "发送 Ctrl+V (125ms)";
-        });
+    // ========== 热键触发事件 ==========
+    // 剪贴板之外的输出目标来自配置中的 "sinks", 修改后随配置重新加载
+    PasteSequence *pasteSequence = new PasteSequence(&app);
+    // 时间戳通知不在热键处理中显示, 由调度器合并后在粘贴序列结束后显示
+    TrayNotifier *notifier = new TrayNotifier(TrayNotifier::trayPresenter(&trayIcon), &app);
+    notifier->setEnabled(notifyAction->isChecked());
+    notifier->setBusy([pasteSequence]() { return pasteSequence->isRunning(); });
+    QObject::connect(pasteSequence, &PasteSequence::finished, notifier, &TrayNotifier::resume, Qt::QueuedConnection);
+    QObject::connect(notifyAction, &QAction::toggled, [notifier](bool enabled) {
+        notifier->setEnabled(enabled);
+        QSettings().setValue("stampNotifications", enabled);
+    });
+    pasteSequence->setRestoreClipboard(restoreClipboardAction->isChecked());
+    QObject::connect(restoreClipboardAction, &QAction::toggled, [pasteSequence](bool enabled) {
+        pasteSequence->setRestoreClipboard(enabled);
+        QSettings().setValue("restoreClipboard", enabled);
+    });
+    StampPipeline *pipeline = new StampPipeline(&app);
+    QString sinkError;
+    if (!pipeline->configure(profile->sinks(), pasteSequence, &sinkError)) {
+        qDebug() << "输出配置无效, 仅输出到剪贴板:" << sinkError;
+        pipeline->configure(QJsonArray(), pasteSequence);
+    }
+    QObject::connect(profile, &HotkeyProfile::sinksChanged, [pipeline, pasteSequence, &trayIcon](const QJsonArray &sinks) {
+        QString error;
+        if (!pipeline->configure(sinks, pasteSequence, &error))
+            trayIcon.showMessage("输出配置无效", error, QSystemTrayIcon::Warning, 3000);
+    });
 
-        QTimer::singleShot(250, []() {
-            sendKeyCombo(VK_CONTROL, 'A');
-            qDebug() << "发送 Ctrl+A (250ms)";
-        });
+    // 动作宏来自配置中的 "macros", 与内置的 paste/copy 同名时覆盖内置序列
+    QString macroError;
+    if (!pasteSequence->setMacros(profile->macros(), &macroError))
+        qDebug() << "动作宏配置无效, 使用内置序列:" << macroError;
+    QObject::connect(profile, &HotkeyProfile::macrosChanged, [pasteSequence, &trayIcon](const QJsonObject &macros) {
+        QString error;
+        if (!pasteSequence->setMacros(macros, &error))
+            trayIcon.showMessage("动作宏配置无效", error, QSystemTrayIcon::Warning, 3000);
+    });
 
-        QTimer::singleShot(375, []() {
-            sendKeyCombo(VK_CONTROL, 'C');
-            qDebug() << "发送 Ctrl+C (375ms)";
-        });
+    QObject::connect(profile, &HotkeyProfile::triggered, [&idleManager, pipeline, notifier](const QString &timestamp, HotkeyProfile::Action action, qint64 pressNs, const QString &macro) {
+        qDebug() << "热键触发! 生成时间戳:" << timestamp;
+        idleManager.touch();
 
-        trayIcon.showMessage("时间戳已生成",
-                             timestamp,
-                             QSystemTrayIcon::Information,
-                             1000);
+        pipeline->publish(timestamp, pressNs, action != HotkeyProfile::Copy,
+                          action == HotkeyProfile::Macro ? macro : QString());
+        notifier->addStamp(timestamp);
+    });
+
+    // ========== 编辑热键配置 ==========
+    QObject::connect(editProfileAction, &QAction::triggered, [profilePath]() {
+        QDesktopServices::openUrl(QUrl::fromLocalFile(profilePath));
     });
 
     // ========== 显示时间窗口菜单项 ==========
-    QObject::connect(showWindowAction, &QAction::triggered, [timeWindow]() {
-        timeWindow->show();
-        timeWindow->raise();
-        timeWindow->activateWindow();
+    QObject::connect(showWindowAction, &QAction::triggered, showTimeWindow);
+
+    // ========== 内存占用 ==========
+    QObject::connect(memoryAction, &QAction::triggered, [&trayIcon]() {
+        trayIcon.showMessage("内存占用", IdleManager::memoryReport(), QSystemTrayIcon::Information, 3000);
     });
 
     // ========== 关于对话框 ==========
@@ -156,21 +349,49 @@ int main(int argc, char *argv[])
     // ========== 双击托盘图标显示时间窗口 ==========
     QObject::connect(&trayIcon,
                      &QSystemTrayIcon::activated,
-                     [timeWindow](QSystemTrayIcon::ActivationReason reason) {
-                         if (reason == QSystemTrayIcon::DoubleClick) {
-                             timeWindow->show();
-                             timeWindow->raise();
-                             timeWindow->activateWindow();
-                         }
+                     [showTimeWindow](QSystemTrayIcon::ActivationReason reason) {
+                         if (reason == QSystemTrayIcon::DoubleClick)
+                             showTimeWindow();
                      });
 
+    // ========== 唤醒统计 ==========
+    QObject::connect(wakeupAction, &QAction::triggered, [&trayIcon, &wakeupMonitor]() {
+        const QHotkey::FilterStats filter = QHotkey::nativeFilterStats();
+        trayIcon.showMessage("唤醒统计",
+                             WakeupMonitor::format(wakeupMonitor.snapshot())
+                                 + QString("\n原生事件: 收到 %1, 热键 %2").arg(filter.eventsSeen).arg(filter.eventsAccepted)
+                                 + QString("\n按键到过滤器: 平均 %1 us, 最大 %2 us, 按事件时间校正 %3 次")
+                                       .arg(filter.skewSamples ? filter.skewTotalNs / qint64(filter.skewSamples) / 1000 : 0)
+                                       .arg(filter.skewMaxNs / 1000)
+                                       .arg(filter.skewCorrected),
+                             QSystemTrayIcon::Information,
+                             5000);
+    });
+
+    // ========== 输出统计 ==========
+    QObject::connect(sinkAction, &QAction::triggered, [&trayIcon, pipeline]() {
+        trayIcon.showMessage("输出统计", pipeline->report(), QSystemTrayIcon::Information, 5000);
+    });
+
     // ========== 退出程序 ==========
-    QObject::connect(quitAction, &QAction::triggered, [timeWindow, &app]() {
+    QObject::connect(quitAction, &QAction::triggered, [&timeWindow, &app]() {
         delete timeWindow;
+        timeWindow = nullptr;
         app.quit();
     });
 
     qDebug() << "程序启动完成,开始监听热键...";
 
-    return app.exec();
+    const int exitCode = app.exec();
+
+    if (parser.isSet("record-trace")) {
+        traceRecorder.stop();
+        QString error;
+        if (!traceRecorder.trace().save(parser.value("record-trace"), &error))
+            qDebug() << "无法写入热键事件记录:" << error;
+        else
+            qDebug() << "已记录" << traceRecorder.trace().events.size() << "条原生事件, 超出上限"
+                     << traceRecorder.overflow() << "条";
+    }
+    return exitCode;
 }
@@ -0,0 +1,330 @@
+#include "pastesequence.h"
+
+#include <QClipboard>
+#include <QDebug>
+#include <QGuiApplication>
+#include <qhotkey.h>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#endif
+
+PasteSequence::PasteSequence(QObject *parent) :
+    QObject(parent)
+{
+    m_macros.insert(QStringLiteral("paste"), ActionMacro::paste(KeyIntervalMs));
+    m_macros.insert(QStringLiteral("copy"), ActionMacro::copy());
+
+    // 所有等待共用一个定时器: 延时到期、剪贴板超时、修饰键轮询
+    m_timer.setObjectName(QStringLiteral("pasteStep"));
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &PasteSequence::onTimer);
+
+    connect(QGuiApplication::clipboard(), &QClipboard::dataChanged, this, &PasteSequence::onClipboardChanged);
+}
+
+PasteSequence::~PasteSequence()
+{
+    cancel();
+}
+
+bool PasteSequence::setMacros(const QJsonObject &config, QString *error)
+{
+    QHash<QString, ActionMacro> macros;
+    macros.insert(QStringLiteral("paste"), ActionMacro::paste(KeyIntervalMs));
+    macros.insert(QStringLiteral("copy"), ActionMacro::copy());
+    for (auto it = config.begin(); it != config.end(); ++it) {
+        ActionMacro macro;
+        QString stepError;
+        if (!ActionMacro::parse(it.value().toArray(), macro, &stepError)) {
+            if (error)
+                *error = QString("宏 %1: %2").arg(it.key(), stepError);
+            return false;
+        }
+        macros.insert(it.key(), macro);
+    }
+    m_macros = macros;
+    return true;
+}
+
+void PasteSequence::run(const QString &text, bool injectKeys)
+{
+    runMacro(text, injectKeys && isInjectionSupported() ? QStringLiteral("paste") : QStringLiteral("copy"));
+}
+
+void PasteSequence::runMacro(const QString &text, const QString &name)
+{
+    auto it = m_macros.constFind(name);
+    if (it == m_macros.cend()) {
+        qWarning() << "没有宏" << name << ", 仅复制到剪贴板";
+        it = m_macros.constFind(QStringLiteral("copy"));
+    }
+    runMacro(text, it.value());
+}
+
+void PasteSequence::runMacro(const QString &text, const ActionMacro &macro)
+{
+    // 在宏的某一步里(如 clipboardReady 的槽中)再次调用时, 等当前一步返回后再开始
+    if (m_resuming) {
+        QMetaObject::invokeMethod(this, [this, text, macro]() { runMacro(text, macro); }, Qt::QueuedConnection);
+        return;
+    }
+    cancel();
+    ++m_stats.runs;
+    m_task = execute(macro, text);
+    resumeTask(std::coroutine_handle<>());
+}
+
+void PasteSequence::cancel()
+{
+    if (!m_task.isValid())
+        return;
+    m_timer.stop();
+    m_wait = Wait::None;
+    m_handle = std::coroutine_handle<>();
+    m_task = ActionTask();
+    ++m_stats.cancelled;
+}
+
+void PasteSequence::setRestoreClipboard(bool enabled)
+{
+    m_restoreClipboard = enabled;
+    if (!enabled)
+        m_snapshot.reset();
+}
+
+ActionTask PasteSequence::execute(ActionMacro macro, QString text)
+{
+    bool injected = false;
+    for (const ActionMacro::Step &step : std::as_const(macro.steps)) {
+        switch (step.kind) {
+        case ActionMacro::Clipboard:
+            // 被取消的序列留下的快照才是用户原有的内容, 此时剪贴板里是上一个时间戳
+            if (m_restoreClipboard && !m_snapshot)
+                captureSnapshot();
+            // dataChanged 可能在 setText 内同步发出, 须先记下要确认的内容
+            m_text = text;
+            m_clipboardMatched = false;
+            m_clipboardChanges = 0;
+            m_expectedChanges = 0;
+            m_elapsed.start();
+            QGuiApplication::clipboard()->setText(text);
+            qDebug() << "时间戳已复制到剪贴板";
+            break;
+        case ActionMacro::Ready:
+            if (!onReady(co_await clipboardReady(step.ms), step.ms)) {
+                dropSnapshot();
+                co_return;
+            }
+            // 就绪前的改写已被这次写入覆盖
+            m_clipboardChanges = 0;
+            break;
+        case ActionMacro::Delay:
+            co_await delay(step.ms);
+            break;
+        case ActionMacro::Inject:
+            sendChord(step.modifiers, step.key);
+            injected = true;
+            if (ActionMacro::writesClipboard(step))
+                ++m_expectedChanges;
+            qDebug() << "发送" << step.text;
+            break;
+        case ActionMacro::Release: {
+            ++m_stats.releaseWaits;
+            m_waitElapsed.start();
+            const bool released = co_await modifiersReleased(step.ms);
+            m_stats.lastReleaseWaitNs = m_waitElapsed.nsecsElapsed();
+            if (!released) {
+                ++m_stats.releaseTimedOut;
+                qDebug() << "按键在" << step.ms << "ms 内未松开, 放弃发送组合键";
+                dropSnapshot();
+                co_return;
+            }
+            break;
+        }
+        }
+    }
+
+    if (m_snapshot) {
+        if (injected)
+            co_await delay(RestoreDelayMs);
+        if (m_clipboardChanges > m_expectedChanges)
+            dropSnapshot();
+        else
+            restoreSnapshot();
+    }
+}
+
+void PasteSequence::captureSnapshot()
+{
+    QElapsedTimer timer;
+    timer.start();
+    auto snapshot = std::make_unique<ClipboardSnapshot>();
+    const bool captured = snapshot->capture();
+    m_stats.lastCaptureNs = timer.nsecsElapsed();
+    m_stats.lastCaptureBytes = snapshot->bytes();
+    qDebug() << "保存原有剪贴板内容:" << snapshot->formatCount() << "种格式," << m_stats.lastCaptureBytes << "字节,"
+             << m_stats.lastCaptureNs / 1000 << "us";
+    // 剪贴板原本为空时没有要恢复的内容
+    if (captured)
+        m_snapshot = std::move(snapshot);
+}
+
+void PasteSequence::restoreSnapshot()
+{
+    const bool restored = m_snapshot->restore();
+    m_snapshot.reset();
+    if (restored)
+        ++m_stats.restored;
+    qDebug() << (restored ? "已恢复原有剪贴板内容" : "原有剪贴板内容未能完整恢复");
+}
+
+void PasteSequence::dropSnapshot()
+{
+    if (!m_snapshot)
+        return;
+    m_snapshot.reset();
+    ++m_stats.snapshotsDropped;
+    qDebug() << "剪贴板内容已被其他程序改写或留待手动粘贴, 不再恢复原有内容";
+}
+
+bool PasteSequence::isSatisfied(Wait wait) const
+{
+    switch (wait) {
+    case Wait::Clipboard:
+        return m_clipboardMatched;
+    case Wait::Modifiers:
+        return !modifiersDown();
+    default:
+        return false;
+    }
+}
+
+void PasteSequence::suspend(std::coroutine_handle<> handle, Wait wait, int ms)
+{
+    m_handle = handle;
+    m_wait = wait;
+    m_satisfied = false;
+    m_waitMs = ms;
+    m_waitElapsed.start();
+    m_timer.start(wait == Wait::Modifiers ? qMin(ms, ModifierPollMs) : ms);
+}
+
+void PasteSequence::wake(bool satisfied)
+{
+    m_timer.stop();
+    m_wait = Wait::None;
+    m_satisfied = satisfied;
+    resumeTask(std::exchange(m_handle, std::coroutine_handle<>()));
+}
+
+void PasteSequence::resumeTask(std::coroutine_handle<> handle)
+{
+    // handle 为空时是第一次进入协程
+    m_resuming = true;
+    if (handle)
+        handle.resume();
+    else
+        m_task.resume();
+    m_resuming = false;
+
+    if (m_task.isDone()) {
+        m_task = ActionTask();
+        emit finished();
+    }
+}
+
+bool PasteSequence::onReady(bool confirmed, int timeoutMs)
+{
+    m_stats.lastReadyNs = m_elapsed.nsecsElapsed();
+    const bool stale = !confirmed && QGuiApplication::clipboard()->text() != m_text;
+    if (confirmed)
+        ++m_stats.confirmed;
+    else if (stale)
+        ++m_stats.stale;
+    else
+        ++m_stats.timedOut;
+    emit clipboardReady(m_stats.lastReadyNs, confirmed, stale);
+
+    if (stale)
+        qDebug() << "剪贴板未在" << timeoutMs << "ms 内更新, 放弃粘贴";
+    else
+        qDebug() << "剪贴板就绪" << m_stats.lastReadyNs / 1000 << "us," << (confirmed ? "已确认" : "超时后读回");
+    return !stale;
+}
+
+void PasteSequence::onClipboardChanged()
+{
+    // 其他程序在此期间写入的内容不算确认, 计入改写次数
+    if (m_text.isEmpty() || QGuiApplication::clipboard()->text() != m_text) {
+        ++m_clipboardChanges;
+        return;
+    }
+    m_clipboardMatched = true;
+    if (m_wait == Wait::Clipboard)
+        wake(true);
+}
+
+void PasteSequence::onTimer()
+{
+    switch (m_wait) {
+    case Wait::Delay:
+        wake(true);
+        break;
+    case Wait::Clipboard:
+        wake(false);
+        break;
+    case Wait::Modifiers:
+        if (!modifiersDown())
+            wake(true);
+        else if (m_waitElapsed.elapsed() >= m_waitMs)
+            wake(false);
+        else
+            m_timer.start(ModifierPollMs);
+        break;
+    case Wait::None:
+        break;
+    }
+}
+
+void PasteSequence::sendChord(const QVector<quint8> &modifiers, quint8 key)
+{
+#ifdef Q_OS_WIN
+    for (quint8 modifier : modifiers) {
+        keybd_event(modifier, 0, 0, 0);
+        Sleep(10);
+    }
+    keybd_event(key, 0, 0, 0);
+    Sleep(10);
+    keybd_event(key, 0, KEYEVENTF_KEYUP, 0);
+    for (int i = modifiers.size() - 1; i >= 0; --i) {
+        Sleep(10);
+        keybd_event(modifiers.at(i), 0, KEYEVENTF_KEYUP, 0);
+    }
+#else
+    Q_UNUSED(modifiers)
+    Q_UNUSED(key)
+#endif
+}
+
+bool PasteSequence::isInjectionSupported()
+{
+#ifdef Q_OS_WIN
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PasteSequence::modifiersDown()
+{
+    if (QHotkey::heldShortcutCount() > 0)
+        return true;
+#ifdef Q_OS_WIN
+    for (int key : {VK_CONTROL, VK_SHIFT, VK_MENU, VK_LWIN, VK_RWIN}) {
+        if (GetAsyncKeyState(key) & 0x8000)
+            return true;
+    }
+#endif
+    return false;
+}
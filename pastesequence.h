@@ -0,0 +1,161 @@
+#ifndef PASTESEQUENCE_H
+#define PASTESEQUENCE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <memory>
+#include "actionmacro.h"
+#include "clipboardsnapshot.h"
+
+/**
+ * 粘贴序列: 写入剪贴板, 然后依次模拟 Ctrl+V(粘贴) -> Ctrl+A(全选) -> Ctrl+C(复制)
+ *
+ * 写入后不再固定等待, 而是等 QClipboard::dataChanged 且读回内容与写入一致才发送 Ctrl+V;
+ * 超过 readyTimeout 仍未确认时再读一次, 内容一致才粘贴, 否则放弃按键, 不会粘贴旧内容.
+ *
+ * 各步由 ActionMacro 描述, 以一个协程在事件循环中执行: 等待时挂起, 由同一个定时器
+ * 或剪贴板信号恢复. 内置 "paste" 与 "copy" 两个宏, 可由配置覆盖或增加新的宏.
+ * 新的序列开始时, 上一次尚未结束的序列被取消(协程帧直接销毁).
+ *
+ * 发送组合键前等用户松开热键: 按住的 Ctrl 或 ` 会与注入的 Ctrl+V/A/C 组合.
+ * 松开状态取自热键后端对已触发热键的跟踪(QHotkey::heldShortcutCount)与物理修饰键状态,
+ * 已松开时立即发送, 不再依赖固定间隔.
+ *
+ * 打开 restoreClipboard 后, 宏第一次写入剪贴板前取下用户原有的内容(ClipboardSnapshot),
+ * 宏正常结束时放回; 发送过组合键的, 先等 RestoreDelayMs 让目标程序处理完最后的 Ctrl+C.
+ * 被新序列取消时快照留给新序列放回; 剪贴板被其他程序改写或放弃按键时丢弃快照,
+ * 不覆盖其他程序的新内容, 也不拿走留给用户手动粘贴的时间戳. 改写由就绪之后内容与
+ * 时间戳不同的 dataChanged 判断, 宏发送的复制/剪切组合键各允许一次.
+ */
+class PasteSequence : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultReadyTimeoutMs = ActionMacro::DefaultReadyTimeoutMs;
+    // Ctrl+V 之后各组合键的间隔
+    static constexpr int KeyIntervalMs = 125;
+    // 等待修饰键松开时的轮询间隔
+    static constexpr int ModifierPollMs = 5;
+    // 最后一个组合键之后, 放回原有剪贴板内容前的等待
+    static constexpr int RestoreDelayMs = 150;
+
+    struct Stats {
+        quint64 runs = 0;
+        // 由 dataChanged 确认
+        quint64 confirmed = 0;
+        // 超时后读回一致
+        quint64 timedOut = 0;
+        // 超时后读回不一致, 已放弃按键
+        quint64 stale = 0;
+        // 被新的序列取消
+        quint64 cancelled = 0;
+        // 等待按键松开的次数, 其中超时(已放弃按键)的次数, 以及最近一次的等待时长
+        quint64 releaseWaits = 0;
+        quint64 releaseTimedOut = 0;
+        qint64 lastReleaseWaitNs = 0;
+        // 放回原有剪贴板内容的次数, 丢弃快照的次数, 以及最近一次取快照的耗时与数据量
+        quint64 restored = 0;
+        quint64 snapshotsDropped = 0;
+        qint64 lastCaptureNs = 0;
+        qint64 lastCaptureBytes = 0;
+        // 最近一次从写入到就绪的耗时
+        qint64 lastReadyNs = 0;
+    };
+
+    explicit PasteSequence(QObject *parent = nullptr);
+    ~PasteSequence() override;
+
+    // 写入剪贴板; injectKeys 为 true 时执行 "paste" 宏, 否则执行 "copy" 宏.
+    // 上一次序列尚未结束时会被取消
+    void run(const QString &text, bool injectKeys);
+    // 以 text 执行指定名字的宏, 没有该宏时按 "copy" 执行
+    void runMacro(const QString &text, const QString &name);
+    void runMacro(const QString &text, const ActionMacro &macro);
+    void cancel();
+    bool isRunning() const { return m_task.isValid(); }
+
+    // 配置中的 "macros": 名字 -> 步骤数组; 失败时保留原有的宏
+    bool setMacros(const QJsonObject &config, QString *error = nullptr);
+    bool hasMacro(const QString &name) const { return m_macros.contains(name); }
+
+    // 粘贴完成后是否恢复用户原有的剪贴板内容, 默认关闭
+    void setRestoreClipboard(bool enabled);
+    bool restoreClipboard() const { return m_restoreClipboard; }
+
+    Stats stats() const { return m_stats; }
+
+    // 依次按下修饰键与主键, 再逆序释放; 参数为虚拟键码
+    static void sendChord(const QVector<quint8> &modifiers, quint8 key);
+    static bool isInjectionSupported();
+    // 物理键盘上是否有修饰键(Ctrl/Shift/Alt/Win)处于按下状态, 或已触发的热键尚未松开
+    static bool modifiersDown();
+
+signals:
+    // 剪贴板已就绪(confirmed 为 false 表示超时后读回确认), 或 stale 时内容不一致
+    void clipboardReady(qint64 elapsedNs, bool confirmed, bool stale);
+    // 整个序列(含组合键)发送完毕
+    void finished();
+
+private:
+    enum class Wait {
+        None,
+        Delay,
+        Clipboard,
+        Modifiers
+    };
+
+    // co_await 的对象; await_resume 为 true 表示条件满足, false 表示超时
+    struct Awaiter {
+        PasteSequence *sequence;
+        Wait wait;
+        int ms;
+        // 条件已满足时不挂起
+        bool ready = false;
+
+        bool await_ready() { return ready = sequence->isSatisfied(wait); }
+        void await_suspend(std::coroutine_handle<> handle) { sequence->suspend(handle, wait, ms); }
+        bool await_resume() const { return ready || sequence->m_satisfied; }
+    };
+
+    Awaiter delay(int ms) { return {this, Wait::Delay, ms}; }
+    Awaiter clipboardReady(int timeoutMs) { return {this, Wait::Clipboard, timeoutMs}; }
+    Awaiter modifiersReleased(int timeoutMs) { return {this, Wait::Modifiers, timeoutMs}; }
+
+    ActionTask execute(ActionMacro macro, QString text);
+    bool isSatisfied(Wait wait) const;
+    void suspend(std::coroutine_handle<> handle, Wait wait, int ms);
+    void wake(bool satisfied);
+    void resumeTask(std::coroutine_handle<> handle);
+    bool onReady(bool confirmed, int timeoutMs);
+    void captureSnapshot();
+    void restoreSnapshot();
+    void dropSnapshot();
+    void onClipboardChanged();
+    void onTimer();
+
+    QHash<QString, ActionMacro> m_macros;
+    ActionTask m_task;
+    std::coroutine_handle<> m_handle;
+    Wait m_wait = Wait::None;
+    bool m_satisfied = false;
+    bool m_resuming = false;
+    QString m_text;
+    bool m_clipboardMatched = false;
+    // 就绪之后剪贴板被改写为其他内容的次数, 以及宏发送的复制/剪切组合键数
+    int m_clipboardChanges = 0;
+    int m_expectedChanges = 0;
+    QElapsedTimer m_elapsed;
+    QElapsedTimer m_waitElapsed;
+    int m_waitMs = 0;
+    QTimer m_timer;
+    Stats m_stats;
+    bool m_restoreClipboard = false;
+    std::unique_ptr<ClipboardSnapshot> m_snapshot;
+};
+
+#endif // PASTESEQUENCE_H
@@ -0,0 +1,933 @@
+#include "stamphistory.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char SegmentMagic[4] = {'T', 'S', 'S', 'G'};
+const quint32 SegmentVersion = 1;
+const char ActiveLogName[] = "active.log";
+const char RollupName[] = "rollup.idx";
+
+// active.log 中的记录类型
+const char LogFormat = 'F';
+const char LogSource = 'S';
+const char LogEntry = 'E';
+
+/**
+ * 段文件头, 小端序
+ * 之后依次为: 格式字典、来源字典(u16 长度 + UTF-8)、稀疏索引、时间列、格式列、来源列
+ */
+struct SegmentHeader {
+    char magic[4];
+    quint32 version;
+    qint64 count;
+    qint64 minNs;
+    qint64 maxNs;
+    quint32 indexStride;
+    quint32 indexCount;
+    quint32 formatCount;
+    quint32 sourceCount;
+    quint32 timeBytes;
+    quint32 formatBytes;
+    quint32 sourceBytes;
+    quint32 reserved;
+};
+
+struct IndexEntry {
+    qint64 timeNs;
+    quint32 timeOffset;
+    quint32 formatOffset;
+    quint32 sourceOffset;
+    quint32 reserved;
+};
+
+template<typename T>
+void appendLittleEndian(QByteArray &out, T value)
+{
+    char bytes[sizeof(T)];
+    qToLittleEndian(value, bytes);
+    out.append(bytes, sizeof(T));
+}
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    char bytes[10];
+    int length = 0;
+    while (value >= 0x80) {
+        bytes[length++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    bytes[length++] = static_cast<char>(value);
+    out.append(bytes, length);
+}
+
+// 读取 [p, end) 中的一个 varint; 越过 end 或超过 10 字节(文件损坏)时返回 false
+inline bool readVarint(const uchar *&p, const uchar *end, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; p < end && shift <= 63; shift += 7) {
+        const uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void appendString(QByteArray &out, const QString &text)
+{
+    const QByteArray utf8 = text.toUtf8().left(0xffff);
+    appendLittleEndian<quint16>(out, static_cast<quint16>(utf8.size()));
+    out.append(utf8);
+}
+
+bool readStrings(const uchar *&p, const uchar *end, quint32 count, QStringList &list)
+{
+    list.reserve(count);
+    for (quint32 i = 0; i < count; ++i) {
+        if (end - p < 2)
+            return false;
+        const quint16 length = qFromLittleEndian<quint16>(p);
+        p += 2;
+        if (end - p < length)
+            return false;
+        list.append(QString::fromUtf8(reinterpret_cast<const char *>(p), length));
+        p += length;
+    }
+    return true;
+}
+
+bool readHeader(const uchar *data, SegmentHeader &header)
+{
+    std::memcpy(&header, data, sizeof(header));
+    header.version = qFromLittleEndian(header.version);
+    header.count = qFromLittleEndian(header.count);
+    header.minNs = qFromLittleEndian(header.minNs);
+    header.maxNs = qFromLittleEndian(header.maxNs);
+    header.indexStride = qFromLittleEndian(header.indexStride);
+    header.indexCount = qFromLittleEndian(header.indexCount);
+    header.formatCount = qFromLittleEndian(header.formatCount);
+    header.sourceCount = qFromLittleEndian(header.sourceCount);
+    header.timeBytes = qFromLittleEndian(header.timeBytes);
+    header.formatBytes = qFromLittleEndian(header.formatBytes);
+    header.sourceBytes = qFromLittleEndian(header.sourceBytes);
+    return std::memcmp(header.magic, SegmentMagic, 4) == 0 && header.version == SegmentVersion
+           && header.indexStride != 0;
+}
+
+// 条数与时间范围合理, 且每 indexStride 条恰有一个索引项(空段没有索引)
+bool indexMatchesCount(const SegmentHeader &header)
+{
+    return header.count >= 0 && header.minNs <= header.maxNs
+           && qint64(header.indexCount) == (header.count + header.indexStride - 1) / header.indexStride;
+}
+
+// 从 "seg-12.tss" / "sealing-12.log" 中取出序号
+qint64 sequenceOf(const QString &fileName)
+{
+    const int dash = fileName.indexOf('-');
+    const int dot = fileName.lastIndexOf('.');
+    return fileName.mid(dash + 1, dot - dash - 1).toLongLong();
+}
+
+} // namespace
+
+/**
+ * 已封存的段: 文件映射到内存, 只在查询触及时解码
+ */
+class StampHistory::Segment
+{
+public:
+    static QSharedPointer<Segment> load(const QString &path, QString *error);
+
+    qint64 sequence() const { return m_sequence; }
+    qint64 count() const { return m_header.count; }
+    qint64 fileSize() const { return m_size; }
+    QString path() const { return m_file.fileName(); }
+
+    qint64 visit(qint64 fromNs, qint64 toNs, const Visitor &visitor) const;
+
+private:
+    QFile m_file;
+    qint64 m_sequence = 0;
+    qint64 m_size = 0;
+    SegmentHeader m_header;
+    QStringList m_formats;
+    QStringList m_sources;
+    QVector<IndexEntry> m_index;
+    const uchar *m_timeColumn = nullptr;
+    const uchar *m_formatColumn = nullptr;
+    const uchar *m_sourceColumn = nullptr;
+    const uchar *m_columnsEnd = nullptr;
+};
+
+QSharedPointer<StampHistory::Segment> StampHistory::Segment::load(const QString &path, QString *error)
+{
+    QSharedPointer<Segment> segment(new Segment);
+    segment->m_file.setFileName(path);
+    segment->m_sequence = sequenceOf(QFileInfo(path).fileName());
+
+    auto fail = [&](const QString &reason) {
+        if (error)
+            *error = QString("%1: %2").arg(path, reason);
+        return QSharedPointer<Segment>();
+    };
+
+    if (!segment->m_file.open(QIODevice::ReadOnly))
+        return fail(segment->m_file.errorString());
+    segment->m_size = segment->m_file.size();
+    if (segment->m_size < qint64(sizeof(SegmentHeader)))
+        return fail(QStringLiteral("文件过短"));
+    const uchar *data = segment->m_file.map(0, segment->m_size);
+    if (!data)
+        return fail(segment->m_file.errorString());
+    const uchar *end = data + segment->m_size;
+
+    SegmentHeader &header = segment->m_header;
+    if (!readHeader(data, header))
+        return fail(QStringLiteral("格式不符"));
+
+    const uchar *p = data + sizeof(SegmentHeader);
+    if (!readStrings(p, end, header.formatCount, segment->m_formats)
+        || !readStrings(p, end, header.sourceCount, segment->m_sources))
+        return fail(QStringLiteral("字典损坏"));
+
+    const qint64 indexBytes = qint64(header.indexCount) * qint64(sizeof(IndexEntry));
+    const qint64 columnBytes = qint64(header.timeBytes) + header.formatBytes + header.sourceBytes;
+    if (end - p != indexBytes + columnBytes)
+        return fail(QStringLiteral("长度不符"));
+    if (!indexMatchesCount(header))
+        return fail(QStringLiteral("索引与条数不符"));
+
+    segment->m_index.resize(header.indexCount);
+    for (quint32 i = 0; i < header.indexCount; ++i) {
+        IndexEntry &entry = segment->m_index[i];
+        std::memcpy(&entry, p, sizeof(IndexEntry));
+        entry.timeNs = qFromLittleEndian(entry.timeNs);
+        entry.timeOffset = qFromLittleEndian(entry.timeOffset);
+        entry.formatOffset = qFromLittleEndian(entry.formatOffset);
+        entry.sourceOffset = qFromLittleEndian(entry.sourceOffset);
+        p += sizeof(IndexEntry);
+        // 最后一块只有一条时, 其时间在索引中, 时间列偏移恰为列末尾
+        if (entry.timeOffset > header.timeBytes || entry.formatOffset >= header.formatBytes
+            || entry.sourceOffset >= header.sourceBytes)
+            return fail(QStringLiteral("索引偏移越界"));
+    }
+    segment->m_timeColumn = p;
+    segment->m_formatColumn = p + header.timeBytes;
+    segment->m_sourceColumn = p + header.timeBytes + header.formatBytes;
+    segment->m_columnsEnd = end;
+    return segment;
+}
+
+qint64 StampHistory::Segment::visit(qint64 fromNs, qint64 toNs, const Visitor &visitor) const
+{
+    if (m_index.isEmpty() || fromNs > m_header.maxNs || toNs <= m_header.minNs)
+        return 0;
+
+    // 从最后一个起始时间 < fromNs 的块开始解码(相同时间可能跨块)
+    auto it = std::lower_bound(m_index.cbegin(), m_index.cend(), fromNs,
+                               [](const IndexEntry &entry, qint64 value) { return entry.timeNs < value; });
+    const int block = it == m_index.cbegin() ? 0 : int(it - m_index.cbegin()) - 1;
+    const IndexEntry &start = m_index.at(block);
+
+    const uchar *timePtr = m_timeColumn + start.timeOffset;
+    const uchar *formatPtr = m_formatColumn + start.formatOffset;
+    const uchar *sourcePtr = m_sourceColumn + start.sourceOffset;
+    const qint64 stride = m_header.indexStride;
+    qint64 timeNs = start.timeNs;
+    qint64 visited = 0;
+
+    const uchar *timeEnd = m_formatColumn;
+    const uchar *formatEnd = m_sourceColumn;
+    const uchar *sourceEnd = m_columnsEnd;
+
+    for (qint64 i = block * stride; i < m_header.count; ++i) {
+        // 块首的时间在索引中, 时间列里不再存储
+        quint64 delta = 0;
+        quint64 format;
+        quint64 source;
+        if ((i % stride != 0 && !readVarint(timePtr, timeEnd, delta)) || !readVarint(formatPtr, formatEnd, format)
+            || !readVarint(sourcePtr, sourceEnd, source)) {
+            qWarning() << "段数据损坏, 停止解码:" << path();
+            break;
+        }
+        timeNs += static_cast<qint64>(delta);
+        if (timeNs >= toNs)
+            break;
+        if (timeNs < fromNs)
+            continue;
+        ++visited;
+        if (visitor)
+            visitor(timeNs, m_formats.value(int(format)), m_sources.value(int(source)));
+    }
+    return visited;
+}
+
+quint32 StampHistory::Batch::intern(const QString &text, QStringList &list, QHash<QString, quint32> &ids)
+{
+    auto it = ids.constFind(text);
+    if (it != ids.constEnd())
+        return it.value();
+    const quint32 id = quint32(list.size());
+    list.append(text);
+    ids.insert(text, id);
+    return id;
+}
+
+StampHistory::StampHistory(const QString &directory, QObject *parent) :
+    QObject(parent),
+    m_directory(directory)
+{
+}
+
+StampHistory::~StampHistory()
+{
+    // 后台封存任务引用 this, 须等其结束; active.log 保留到下次启动重放
+    waitForCompaction();
+    QMutexLocker locker(&m_mutex);
+    m_activeLog.close();
+}
+
+QString StampHistory::defaultDirectory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QStringLiteral("/history");
+}
+
+bool StampHistory::open(QString *error)
+{
+    return load(false, error);
+}
+
+bool StampHistory::openReadOnly(QString *error)
+{
+    return load(true, error);
+}
+
+bool StampHistory::load(bool readOnly, QString *error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_readOnly = readOnly;
+    QDir dir(m_directory);
+    if (!readOnly && !dir.mkpath(QStringLiteral("."))) {
+        if (error)
+            *error = QString("无法创建目录 %1").arg(m_directory);
+        return false;
+    }
+
+    m_segments.clear();
+    m_sealing.clear();
+    qint64 maxSequence = -1;
+    const QStringList segmentFiles = dir.entryList({QStringLiteral("seg-*.tss")}, QDir::Files);
+    for (const QString &name : segmentFiles) {
+        QString loadError;
+        QSharedPointer<Segment> segment = Segment::load(dir.filePath(name), &loadError);
+        if (!segment) {
+            qWarning() << "跳过损坏的段:" << loadError;
+            continue;
+        }
+        maxSequence = qMax(maxSequence, segment->sequence());
+        m_segments.append(segment);
+    }
+
+    // 上次封存未完成: 段文件已存在则日志是残留, 否则从日志重新封存;
+    // 只读时不写段也不删日志, 日志读入内存按封存中的批次查询
+    const QStringList sealingLogs = dir.entryList({QStringLiteral("sealing-*.log")}, QDir::Files);
+    for (const QString &name : sealingLogs) {
+        const QString logPath = dir.filePath(name);
+        const qint64 sequence = sequenceOf(name);
+        if (readOnly) {
+            maxSequence = qMax(maxSequence, sequence);
+            if (QFile::exists(segmentPath(sequence)))
+                continue;
+            QSharedPointer<Batch> batch(new Batch);
+            batch->sequence = sequence;
+            if (replayLog(logPath, *batch))
+                m_sealing.append(batch);
+            else
+                qWarning() << "无法读取" << logPath;
+            continue;
+        }
+        if (!QFile::exists(segmentPath(sequence))) {
+            Batch batch;
+            batch.sequence = sequence;
+            QString sealError;
+            if (!replayLog(logPath, batch) || !writeSegment(segmentPath(sequence), batch, &sealError)) {
+                qWarning() << "无法重新封存" << logPath << sealError;
+                continue;
+            }
+            QSharedPointer<Segment> segment = Segment::load(segmentPath(sequence), &sealError);
+            if (!segment) {
+                qWarning() << sealError;
+                continue;
+            }
+            m_segments.append(segment);
+        }
+        maxSequence = qMax(maxSequence, sequence);
+        QFile::remove(logPath);
+    }
+
+    std::sort(m_segments.begin(), m_segments.end(),
+              [](const QSharedPointer<Segment> &a, const QSharedPointer<Segment> &b) {
+                  return a->sequence() < b->sequence();
+              });
+
+    m_nextSequence = maxSequence + 1;
+    loadRollup();
+    m_active = Batch();
+    m_active.sequence = m_nextSequence++;
+    replayLog(dir.filePath(ActiveLogName), m_active);
+    for (const QSharedPointer<Batch> &batch : std::as_const(m_sealing)) {
+        for (const Record &record : std::as_const(batch->records))
+            m_rollup.add(record.timeNs);
+    }
+    for (const Record &record : std::as_const(m_active.records))
+        m_rollup.add(record.timeNs);
+
+    if (!readOnly && !openActiveLog()) {
+        if (error)
+            *error = m_activeLog.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool StampHistory::openActiveLog()
+{
+    m_activeLog.setFileName(QDir(m_directory).filePath(ActiveLogName));
+    return m_activeLog.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void StampHistory::writeLogString(char kind, const QString &text)
+{
+    QByteArray record;
+    record.append(kind);
+    appendString(record, text);
+    m_activeLog.write(record);
+}
+
+void StampHistory::append(qint64 timeNs, const QString &format, const QString &source)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_readOnly) {
+        qWarning() << "时间戳历史以只读方式打开, 忽略写入";
+        return;
+    }
+    const int formats = m_active.formats.size();
+    const quint32 formatId = m_active.intern(format, m_active.formats, m_active.formatIds);
+    if (m_writeAheadLog && m_active.formats.size() != formats)
+        writeLogString(LogFormat, format);
+    const int sources = m_active.sources.size();
+    const quint32 sourceId = m_active.intern(source, m_active.sources, m_active.sourceIds);
+    if (m_writeAheadLog && m_active.sources.size() != sources)
+        writeLogString(LogSource, source);
+
+    m_active.records.append({timeNs, formatId, sourceId});
+    m_rollup.add(timeNs);
+
+    if (m_writeAheadLog) {
+        char record[17];
+        record[0] = LogEntry;
+        qToLittleEndian(timeNs, record + 1);
+        qToLittleEndian(formatId, record + 9);
+        qToLittleEndian(sourceId, record + 13);
+        m_activeLog.write(record, sizeof(record));
+    }
+
+    if (m_active.records.size() >= m_sealThreshold)
+        startSeal();
+}
+
+void StampHistory::flush()
+{
+    QMutexLocker locker(&m_mutex);
+    m_activeLog.flush();
+}
+
+void StampHistory::compact()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_readOnly)
+        startSeal();
+}
+
+void StampHistory::waitForCompaction()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_pendingJobs > 0)
+        m_jobsDone.wait(&m_mutex);
+}
+
+int StampHistory::pendingCompactions() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_pendingJobs;
+}
+
+void StampHistory::startSeal()
+{
+    // 调用方已持有 m_mutex
+    if (m_active.records.isEmpty())
+        return;
+
+    // 先把日志改名, 新记录写入新的 active.log, 封存期间崩溃可由 open() 恢复
+    QString logPath;
+    if (m_writeAheadLog) {
+        m_activeLog.close();
+        logPath = sealingLogPath(m_active.sequence);
+        QFile::remove(logPath);
+        if (!QFile::rename(m_activeLog.fileName(), logPath)) {
+            qWarning() << "无法封存" << m_activeLog.fileName();
+            openActiveLog();
+            return;
+        }
+    }
+
+    QSharedPointer<Batch> batch(new Batch(std::move(m_active)));
+    m_sealing.append(batch);
+    m_active = Batch();
+    m_active.sequence = m_nextSequence++;
+    if (m_writeAheadLog)
+        openActiveLog();
+
+    // 此刻的汇总恰好覆盖序号小于新 active 的全部段, 与段文件一同落盘
+    const QByteArray rollup = m_rollup.serialize(m_active.sequence);
+    ++m_pendingJobs;
+    QThreadPool::globalInstance()->start([this, batch, logPath, rollup]() { sealJob(batch, logPath, rollup); });
+}
+
+void StampHistory::sealJob(QSharedPointer<Batch> batch, const QString &logPath, const QByteArray &rollup)
+{
+    const QString path = segmentPath(batch->sequence);
+    QString error;
+    QSharedPointer<Segment> segment;
+    if (writeSegment(path, *batch, &error))
+        segment = Segment::load(path, &error);
+    if (!segment)
+        qWarning() << "封存失败:" << error;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        if (segment) {
+            m_sealing.removeOne(batch);
+            auto it = std::upper_bound(m_segments.begin(), m_segments.end(), segment,
+                                       [](const QSharedPointer<Segment> &a, const QSharedPointer<Segment> &b) {
+                                           return a->sequence() < b->sequence();
+                                       });
+            m_segments.insert(it, segment);
+        }
+        // 失败时批次留在 m_sealing 中仍可查询, 日志留待下次启动重新封存
+    }
+
+    if (segment) {
+        writeRollup(rollup, batch->sequence + 1);
+        if (!logPath.isEmpty())
+            QFile::remove(logPath);
+        emit segmentSealed(path, segment->count());
+    }
+
+    QMutexLocker locker(&m_mutex);
+    --m_pendingJobs;
+    m_jobsDone.wakeAll();
+}
+
+bool StampHistory::writeSegment(const QString &path, Batch &batch, QString *error)
+{
+    // 批次可能同时被查询读取, 在副本上排序
+    QVector<Record> records = batch.records;
+    std::stable_sort(records.begin(), records.end(),
+                     [](const Record &a, const Record &b) { return a.timeNs < b.timeNs; });
+
+    const qint64 count = records.size();
+    const quint32 stride = IndexStride;
+    QByteArray timeColumn, formatColumn, sourceColumn, index;
+    timeColumn.reserve(count * 3);
+    formatColumn.reserve(count);
+    sourceColumn.reserve(count);
+
+    quint32 indexCount = 0;
+    for (qint64 i = 0; i < count; ++i) {
+        const Record &record = records.at(i);
+        if (i % stride == 0) {
+            appendLittleEndian<qint64>(index, record.timeNs);
+            appendLittleEndian<quint32>(index, quint32(timeColumn.size()));
+            appendLittleEndian<quint32>(index, quint32(formatColumn.size()));
+            appendLittleEndian<quint32>(index, quint32(sourceColumn.size()));
+            appendLittleEndian<quint32>(index, 0);
+            ++indexCount;
+        } else {
+            appendVarint(timeColumn, quint64(record.timeNs - records.at(i - 1).timeNs));
+        }
+        appendVarint(formatColumn, record.format);
+        appendVarint(sourceColumn, record.source);
+    }
+
+    QByteArray out;
+    out.reserve(int(sizeof(SegmentHeader)) + index.size() + timeColumn.size()
+                + formatColumn.size() + sourceColumn.size() + 1024);
+    out.append(SegmentMagic, 4);
+    appendLittleEndian<quint32>(out, SegmentVersion);
+    appendLittleEndian<qint64>(out, count);
+    appendLittleEndian<qint64>(out, count ? records.first().timeNs : 0);
+    appendLittleEndian<qint64>(out, count ? records.last().timeNs : 0);
+    appendLittleEndian<quint32>(out, stride);
+    appendLittleEndian<quint32>(out, indexCount);
+    appendLittleEndian<quint32>(out, quint32(batch.formats.size()));
+    appendLittleEndian<quint32>(out, quint32(batch.sources.size()));
+    appendLittleEndian<quint32>(out, quint32(timeColumn.size()));
+    appendLittleEndian<quint32>(out, quint32(formatColumn.size()));
+    appendLittleEndian<quint32>(out, quint32(sourceColumn.size()));
+    appendLittleEndian<quint32>(out, 0);
+    for (const QString &format : std::as_const(batch.formats))
+        appendString(out, format);
+    for (const QString &source : std::as_const(batch.sources))
+        appendString(out, source);
+    out.append(index);
+    out.append(timeColumn);
+    out.append(formatColumn);
+    out.append(sourceColumn);
+
+    // 先写临时文件再改名, 不会留下半个段
+    const QString tmpPath = path + QStringLiteral(".tmp");
+    QFile file(tmpPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(out) != out.size()) {
+        if (error)
+            *error = file.errorString();
+        return false;
+    }
+    file.close();
+    QFile::remove(path);
+    if (!QFile::rename(tmpPath, path)) {
+        if (error)
+            *error = QString("无法重命名 %1").arg(tmpPath);
+        return false;
+    }
+    return true;
+}
+
+bool StampHistory::replayLog(const QString &path, Batch &batch)
+{
+    QFile file(path);
+    if (!file.exists())
+        return true;
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray data = file.readAll();
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const uchar *end = p + data.size();
+
+    // 最后一条可能只写了一半, 读到不完整的记录即停止
+    while (p < end) {
+        const char kind = char(*p++);
+        if (kind == LogEntry) {
+            if (end - p < 16)
+                break;
+            Record record;
+            record.timeNs = qFromLittleEndian<qint64>(p);
+            record.format = qFromLittleEndian<quint32>(p + 8);
+            record.source = qFromLittleEndian<quint32>(p + 12);
+            p += 16;
+            batch.records.append(record);
+        } else if (kind == LogFormat || kind == LogSource) {
+            QStringList text;
+            if (!readStrings(p, end, 1, text))
+                break;
+            if (kind == LogFormat)
+                batch.intern(text.first(), batch.formats, batch.formatIds);
+            else
+                batch.intern(text.first(), batch.sources, batch.sourceIds);
+        } else {
+            qWarning() << "日志损坏:" << path;
+            break;
+        }
+    }
+    return true;
+}
+
+qint64 StampHistory::visitBatch(const Batch &batch, qint64 fromNs, qint64 toNs, const Visitor &visitor)
+{
+    qint64 visited = 0;
+    for (const Record &record : batch.records) {
+        if (record.timeNs < fromNs || record.timeNs >= toNs)
+            continue;
+        ++visited;
+        if (visitor)
+            visitor(record.timeNs, batch.formats.value(int(record.format)), batch.sources.value(int(record.source)));
+    }
+    return visited;
+}
+
+qint64 StampHistory::query(qint64 fromNs, qint64 toNs, const Visitor &visitor) const
+{
+    QList<QSharedPointer<Segment>> segments;
+    QList<QSharedPointer<Batch>> sealing;
+    {
+        QMutexLocker locker(&m_mutex);
+        segments = m_segments;
+        sealing = m_sealing;
+    }
+
+    // 段与封存中的批次不再修改, 可在锁外读取
+    qint64 visited = 0;
+    for (const QSharedPointer<Segment> &segment : std::as_const(segments))
+        visited += segment->visit(fromNs, toNs, visitor);
+    for (const QSharedPointer<Batch> &batch : std::as_const(sealing))
+        visited += visitBatch(*batch, fromNs, toNs, visitor);
+
+    QMutexLocker locker(&m_mutex);
+    visited += visitBatch(m_active, fromNs, toNs, visitor);
+    return visited;
+}
+
+qint64 StampHistory::count(qint64 fromNs, qint64 toNs) const
+{
+    if (toNs <= fromNs)
+        return 0;
+    const qint64 minuteNs = StampRollup::widthNs(StampRollup::Minute);
+    // 向内取整到分钟; 区间不含整分钟(或早于纪元)时直接扫描
+    const qint64 innerFrom = fromNs + (minuteNs - fromNs % minuteNs) % minuteNs;
+    const qint64 innerTo = toNs - (toNs % minuteNs + minuteNs) % minuteNs;
+    if (innerTo <= innerFrom || fromNs < 0)
+        return scanCount(fromNs, toNs);
+
+    qint64 counted;
+    {
+        QMutexLocker locker(&m_mutex);
+        counted = m_rollup.count(innerFrom, innerTo);
+    }
+    if (fromNs < innerFrom)
+        counted += scanCount(fromNs, innerFrom);
+    if (innerTo < toNs)
+        counted += scanCount(innerTo, toNs);
+    return counted;
+}
+
+qint64 StampHistory::scanCount(qint64 fromNs, qint64 toNs) const
+{
+    return query(fromNs, toNs, Visitor());
+}
+
+QVector<StampRollup::Bucket> StampHistory::rollup(StampRollup::Level level, qint64 fromNs, qint64 toNs) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_rollup.buckets(level, fromNs, toNs);
+}
+
+void StampHistory::loadRollup()
+{
+    // 调用方已持有 m_mutex, 段已读入; 快照须恰好覆盖这些段, 否则按段重建
+    qint64 segmentEntries = 0;
+    for (const QSharedPointer<Segment> &segment : std::as_const(m_segments))
+        segmentEntries += segment->count();
+
+    QFile file(QDir(m_directory).filePath(RollupName));
+    qint64 tag = -1;
+    if (file.open(QIODevice::ReadOnly) && m_rollup.deserialize(file.readAll(), &tag) && tag == m_nextSequence
+        && m_rollup.total() == segmentEntries) {
+        m_rollupWritten = tag;
+        return;
+    }
+    file.close();
+
+    m_rollup.clear();
+    for (const QSharedPointer<Segment> &segment : std::as_const(m_segments)) {
+        segment->visit(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                       [this](qint64 timeNs, const QString &, const QString &) { m_rollup.add(timeNs); });
+    }
+    if (!m_readOnly)
+        writeRollup(m_rollup.serialize(m_nextSequence), m_nextSequence);
+}
+
+void StampHistory::writeRollup(const QByteArray &rollup, qint64 tag)
+{
+    QMutexLocker locker(&m_rollupFileMutex);
+    if (tag <= m_rollupWritten)
+        return;
+    const QString path = QDir(m_directory).filePath(RollupName);
+    QFile file(path + QStringLiteral(".tmp"));
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(rollup) != rollup.size()) {
+        qWarning() << "无法写入计数汇总" << file.fileName() << file.errorString();
+        return;
+    }
+    file.close();
+    QFile::remove(path);
+    if (!QFile::rename(file.fileName(), path)) {
+        qWarning() << "无法写入计数汇总" << path;
+        return;
+    }
+    m_rollupWritten = tag;
+}
+
+StampHistory::Stats StampHistory::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats stats;
+    stats.segments = m_segments.size();
+    for (const QSharedPointer<Segment> &segment : m_segments) {
+        stats.segmentEntries += segment->count();
+        stats.segmentBytes += segment->fileSize();
+    }
+    stats.entries = stats.segmentEntries + m_active.records.size();
+    for (const QSharedPointer<Batch> &batch : m_sealing)
+        stats.entries += batch->records.size();
+    stats.rawBytes = stats.entries * 16;
+    return stats;
+}
+
+QString StampHistory::segmentPath(qint64 sequence) const
+{
+    return QDir(m_directory).filePath(QString("seg-%1.tss").arg(sequence));
+}
+
+QString StampHistory::sealingLogPath(qint64 sequence) const
+{
+    return QDir(m_directory).filePath(QString("sealing-%1.log").arg(sequence));
+}
+
+bool StampHistory::exportLog(const QString &logPath, const QString &segmentPath, QString *error)
+{
+    Batch batch;
+    if (!replayLog(logPath, batch)) {
+        if (error)
+            *error = QString("无法读取 %1").arg(logPath);
+        return false;
+    }
+    return writeSegment(segmentPath, batch, error);
+}
+
+StampHistory::SegmentReader::SegmentReader(const QString &path, int bufferBytes) :
+    m_file(path),
+    m_bufferBytes(qMax(64, bufferBytes))
+{
+}
+
+bool StampHistory::SegmentReader::open(QString *error)
+{
+    auto fail = [&](const QString &reason) {
+        if (error)
+            *error = QString("%1: %2").arg(m_file.fileName(), reason);
+        m_file.close();
+        return false;
+    };
+
+    if (!m_file.open(QIODevice::ReadOnly))
+        return fail(m_file.errorString());
+    const qint64 size = m_file.size();
+    const QByteArray headerBytes = m_file.read(sizeof(SegmentHeader));
+    SegmentHeader header;
+    if (headerBytes.size() != int(sizeof(SegmentHeader))
+        || !readHeader(reinterpret_cast<const uchar *>(headerBytes.constData()), header))
+        return fail(QStringLiteral("格式不符"));
+
+    // 字典与索引位于各列之前, 一次读入
+    const qint64 columnBytes = qint64(header.timeBytes) + header.formatBytes + header.sourceBytes;
+    const qint64 prefixBytes = size - qint64(sizeof(SegmentHeader)) - columnBytes;
+    const qint64 indexBytes = qint64(header.indexCount) * qint64(sizeof(IndexEntry));
+    if (prefixBytes < indexBytes)
+        return fail(QStringLiteral("长度不符"));
+    if (!indexMatchesCount(header))
+        return fail(QStringLiteral("索引与条数不符"));
+    const QByteArray prefix = m_file.read(prefixBytes);
+    const uchar *p = reinterpret_cast<const uchar *>(prefix.constData());
+    const uchar *end = p + prefix.size();
+    m_formats.clear();
+    m_sources.clear();
+    if (prefix.size() != prefixBytes || !readStrings(p, end, header.formatCount, m_formats)
+        || !readStrings(p, end, header.sourceCount, m_sources) || end - p != indexBytes)
+        return fail(QStringLiteral("字典损坏"));
+
+    m_blockTimes.resize(header.indexCount);
+    for (quint32 i = 0; i < header.indexCount; ++i) {
+        m_blockTimes[i] = qFromLittleEndian<qint64>(p);
+        p += sizeof(IndexEntry);
+    }
+
+    m_count = header.count;
+    m_minNs = header.minNs;
+    m_maxNs = header.maxNs;
+    m_stride = header.indexStride;
+    m_read = 0;
+    const qint64 lengths[3] = {header.timeBytes, header.formatBytes, header.sourceBytes};
+    qint64 offset = size - columnBytes;
+    for (int i = 0; i < 3; ++i) {
+        m_columns[i].offset = offset;
+        m_columns[i].end = offset + lengths[i];
+        m_columns[i].buffer.clear();
+        m_columns[i].position = 0;
+        offset += lengths[i];
+    }
+    return true;
+}
+
+void StampHistory::SegmentReader::close()
+{
+    m_file.close();
+    for (Column &column : m_columns)
+        column.buffer = QByteArray();
+    m_blockTimes = QVector<qint64>();
+}
+
+bool StampHistory::SegmentReader::readVarint(Column &column, quint64 &value)
+{
+    // 缓冲中不足一个最长 varint 时, 把剩余部分移到开头并续读
+    if (column.buffer.size() - column.position < 10 && column.offset < column.end) {
+        column.buffer.remove(0, column.position);
+        column.position = 0;
+        const qint64 want = qMin<qint64>(m_bufferBytes - column.buffer.size(), column.end - column.offset);
+        if (!m_file.seek(column.offset))
+            return false;
+        const QByteArray chunk = m_file.read(want);
+        if (chunk.isEmpty())
+            return false;
+        column.buffer.append(chunk);
+        column.offset += chunk.size();
+    }
+
+    const uchar *p = reinterpret_cast<const uchar *>(column.buffer.constData()) + column.position;
+    const uchar *end = reinterpret_cast<const uchar *>(column.buffer.constData()) + column.buffer.size();
+    value = 0;
+    int shift = 0;
+    for (;;) {
+        if (p == end || shift > 63)
+            return false;
+        const uchar byte = *p++;
+        value |= quint64(byte & 0x7f) << shift;
+        shift += 7;
+        if (!(byte & 0x80))
+            break;
+    }
+    column.position = int(p - reinterpret_cast<const uchar *>(column.buffer.constData()));
+    return true;
+}
+
+bool StampHistory::SegmentReader::next(qint64 &timeNs, quint32 &format, quint32 &source)
+{
+    if (m_read >= m_count)
+        return false;
+    if (m_read % m_stride == 0) {
+        m_timeNs = m_blockTimes.value(int(m_read / m_stride));
+    } else {
+        quint64 delta;
+        if (!readVarint(m_columns[0], delta))
+            return false;
+        m_timeNs += qint64(delta);
+    }
+    quint64 formatId, sourceId;
+    if (!readVarint(m_columns[1], formatId) || !readVarint(m_columns[2], sourceId))
+        return false;
+    ++m_read;
+    timeNs = m_timeNs;
+    format = quint32(formatId);
+    source = quint32(sourceId);
+    return true;
+}
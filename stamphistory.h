@@ -0,0 +1,196 @@
+#ifndef STAMPHISTORY_H
+#define STAMPHISTORY_H
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+#include <functional>
+#include "stamprollup.h"
+
+/**
+ * 时间戳历史
+ *
+ * 每次生成的时间戳(按下时刻、格式、来源)先追加到 active.log,
+ * 攒满 sealThreshold 条后在后台线程封存为不可变的列式段文件 seg-<序号>.tss:
+ *  - 时间列: 段内按时间排序, 存相邻差值的 varint
+ *  - 格式/来源列: 段内字典编码, 存字典下标的 varint
+ *  - 稀疏索引: 每 IndexStride 条记录一个(时间, 各列偏移), 查询时跳到所需块
+ * 段文件在 open() 与封存时即映射到内存(只占地址空间, 页面由系统在访问时读入),
+ * 范围查询只解码与区间相交的段, 其余段的页面不被触及.
+ * 另按分钟/小时/天维护计数汇总(StampRollup), 随每条记录更新, 封存时写入 rollup.idx;
+ * 区间计数由汇总给出整分钟部分, 只扫描两端不足一分钟的部分.
+ */
+class StampHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 查询回调: 时间(ns)、格式、来源; 字符串引用仅在回调期间有效
+    typedef std::function<void(qint64 timeNs, const QString &format, const QString &source)> Visitor;
+
+    struct Stats {
+        qint64 entries = 0;
+        qint64 segments = 0;
+        // 按每条 16 字节(时间 + 两个 32 位下标)计算的未压缩大小
+        qint64 rawBytes = 0;
+        // 段文件实际大小
+        qint64 segmentBytes = 0;
+        qint64 segmentEntries = 0;
+    };
+
+    static constexpr int IndexStride = 1024;
+
+    explicit StampHistory(const QString &directory, QObject *parent = nullptr);
+    ~StampHistory() override;
+
+    QString directory() const { return m_directory; }
+
+    // 读取已有段, 重放 active.log; 封存中断留下的日志会重新封存
+    bool open(QString *error = nullptr);
+    // 只读打开, 供另一个进程查看正在使用的目录: 不创建目录, 不重新封存、不删除日志,
+    // 不重写 rollup.idx, 不打开 active.log; 之后的 append 与 compact 被忽略
+    bool openReadOnly(QString *error = nullptr);
+
+    void append(qint64 timeNs, const QString &format, const QString &source);
+    // 把 active.log 的缓冲写入磁盘
+    void flush();
+
+    // 访问 [fromNs, toNs) 内的记录, 返回条数; 各段内按时间顺序
+    qint64 query(qint64 fromNs, qint64 toNs, const Visitor &visitor) const;
+    // [fromNs, toNs) 内的条数, 由计数汇总得出, O(log n) 加两端不足一分钟部分的扫描
+    qint64 count(qint64 fromNs, qint64 toNs) const;
+    // 同上, 逐条扫描; 用于校验汇总
+    qint64 scanCount(qint64 fromNs, qint64 toNs) const;
+    // 与 [fromNs, toNs) 相交的各整桶计数(UTC 对齐, 只含非空桶)
+    QVector<StampRollup::Bucket> rollup(StampRollup::Level level, qint64 fromNs, qint64 toNs) const;
+
+    // 立即封存当前批次(后台执行)
+    void compact();
+    void waitForCompaction();
+
+    void setSealThreshold(int entries) { m_sealThreshold = qMax(1, entries); }
+    // 关闭后 append 不写 active.log, 只在封存后落盘; 用于批量导入
+    void setWriteAheadLog(bool enabled) { m_writeAheadLog = enabled; }
+    // 尚未完成的后台封存数
+    int pendingCompactions() const;
+    Stats stats() const;
+
+    static QString defaultDirectory();
+
+    // 把 active.log 或封存中断留下的日志按时间排序写成段文件, 不修改原日志
+    static bool exportLog(const QString &logPath, const QString &segmentPath, QString *error = nullptr);
+
+    /**
+     * 顺序读取一个段文件
+     *
+     * 字典和稀疏索引在 open() 时读入; 三列各用一块固定大小的缓冲按顺序预读,
+     * 不映射整个文件, 同时打开大量段时内存占用仍然有界.
+     */
+    class SegmentReader
+    {
+    public:
+        explicit SegmentReader(const QString &path, int bufferBytes = 64 * 1024);
+
+        bool open(QString *error = nullptr);
+        void close();
+        bool isOpen() const { return m_file.isOpen(); }
+
+        QString path() const { return m_file.fileName(); }
+        qint64 count() const { return m_count; }
+        qint64 minNs() const { return m_minNs; }
+        qint64 maxNs() const { return m_maxNs; }
+        const QStringList &formats() const { return m_formats; }
+        const QStringList &sources() const { return m_sources; }
+
+        // 读出下一条(按时间顺序); 返回 false 时由 atEnd() 区分读完与文件损坏/读取失败
+        bool next(qint64 &timeNs, quint32 &format, quint32 &source);
+        bool atEnd() const { return m_read >= m_count; }
+
+    private:
+        struct Column {
+            qint64 offset = 0;
+            qint64 end = 0;
+            QByteArray buffer;
+            int position = 0;
+        };
+
+        bool readVarint(Column &column, quint64 &value);
+
+        QFile m_file;
+        int m_bufferBytes;
+        qint64 m_count = 0;
+        qint64 m_read = 0;
+        qint64 m_minNs = 0;
+        qint64 m_maxNs = 0;
+        qint64 m_stride = IndexStride;
+        qint64 m_timeNs = 0;
+        QVector<qint64> m_blockTimes;
+        QStringList m_formats;
+        QStringList m_sources;
+        Column m_columns[3];
+    };
+
+signals:
+    void segmentSealed(const QString &path, qint64 entries);
+
+private:
+    struct Record {
+        qint64 timeNs;
+        quint32 format;
+        quint32 source;
+    };
+
+    // 尚未封存的一批记录, 字典为批内字典
+    struct Batch {
+        QVector<Record> records;
+        QStringList formats;
+        QStringList sources;
+        QHash<QString, quint32> formatIds;
+        QHash<QString, quint32> sourceIds;
+        qint64 sequence = 0;
+
+        quint32 intern(const QString &text, QStringList &list, QHash<QString, quint32> &ids);
+    };
+
+    class Segment;
+
+    static bool writeSegment(const QString &path, Batch &batch, QString *error);
+    static qint64 visitBatch(const Batch &batch, qint64 fromNs, qint64 toNs, const Visitor &visitor);
+    static bool replayLog(const QString &path, Batch &batch);
+
+    bool load(bool readOnly, QString *error);
+    void startSeal();
+    void sealJob(QSharedPointer<Batch> batch, const QString &logPath, const QByteArray &rollup);
+    void writeRollup(const QByteArray &rollup, qint64 tag);
+    void loadRollup();
+    bool openActiveLog();
+    void writeLogString(char kind, const QString &text);
+    QString segmentPath(qint64 sequence) const;
+    QString sealingLogPath(qint64 sequence) const;
+
+    QString m_directory;
+    int m_sealThreshold = 1 << 20;
+    bool m_writeAheadLog = true;
+    bool m_readOnly = false;
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_jobsDone;
+    Batch m_active;
+    QFile m_activeLog;
+    QList<QSharedPointer<Batch>> m_sealing;
+    QList<QSharedPointer<Segment>> m_segments;
+    qint64 m_nextSequence = 0;
+    int m_pendingJobs = 0;
+    StampRollup m_rollup;
+    // 已写入 rollup.idx 的快照标记, 并发的封存任务只让更新的快照落盘
+    QMutex m_rollupFileMutex;
+    qint64 m_rollupWritten = -1;
+};
+
+#endif // STAMPHISTORY_H
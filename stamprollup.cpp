@@ -0,0 +1,173 @@
+#include "stamprollup.h"
+
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const char RollupMagic[4] = {'T', 'S', 'R', 'U'};
+const quint32 RollupVersion = 1;
+const int HeaderBytes = 28;
+const int BucketBytes = 12;
+
+const qint64 MinuteNs = 60ll * 1000000000;
+
+// 向负无穷取整的除法, 纪元前的时间也落在正确的桶里
+qint64 floorDiv(qint64 value, qint64 divisor)
+{
+    qint64 quotient = value / divisor;
+    if (value % divisor != 0 && value < 0)
+        --quotient;
+    return quotient;
+}
+
+qint64 ceilDiv(qint64 value, qint64 divisor)
+{
+    return floorDiv(value, divisor) + (value % divisor != 0 ? 1 : 0);
+}
+
+} // namespace
+
+StampRollup::StampRollup()
+{
+    for (int level = 0; level < LevelCount; ++level)
+        m_series[level].widthNs = widthNs(Level(level));
+}
+
+qint64 StampRollup::widthNs(Level level)
+{
+    static const qint64 widths[LevelCount] = {MinuteNs, 60 * MinuteNs, 24 * 60 * MinuteNs};
+    return widths[level];
+}
+
+void StampRollup::Series::add(qint64 key, qint64 count)
+{
+    if (keys.isEmpty() || key > keys.last()) {
+        keys.append(key);
+        cumulative.append((cumulative.isEmpty() ? 0 : cumulative.last()) + count);
+        return;
+    }
+    int index = int(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+    if (keys.at(index) != key) {
+        keys.insert(index, key);
+        cumulative.insert(index, index > 0 ? cumulative.at(index - 1) : 0);
+    }
+    for (int i = index; i < cumulative.size(); ++i)
+        cumulative[i] += count;
+}
+
+qint64 StampRollup::Series::before(qint64 key) const
+{
+    const int index = int(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+    return index > 0 ? cumulative.at(index - 1) : 0;
+}
+
+void StampRollup::add(qint64 timeNs)
+{
+    for (Series &series : m_series)
+        series.add(floorDiv(timeNs, series.widthNs), 1);
+}
+
+void StampRollup::clear()
+{
+    for (Series &series : m_series) {
+        series.keys.clear();
+        series.cumulative.clear();
+    }
+}
+
+qint64 StampRollup::total() const
+{
+    const QVector<qint64> &cumulative = m_series[Minute].cumulative;
+    return cumulative.isEmpty() ? 0 : cumulative.last();
+}
+
+qint64 StampRollup::count(qint64 fromNs, qint64 toNs) const
+{
+    // 两端都对齐到更粗的一级时在更短的数组上查找
+    for (int level = Day; level >= Minute; --level) {
+        const Series &series = m_series[level];
+        if (level != Minute && (fromNs % series.widthNs != 0 || toNs % series.widthNs != 0))
+            continue;
+        const qint64 first = ceilDiv(fromNs, series.widthNs);
+        const qint64 last = floorDiv(toNs, series.widthNs);
+        return last > first ? series.before(last) - series.before(first) : 0;
+    }
+    return 0;
+}
+
+QVector<StampRollup::Bucket> StampRollup::buckets(Level level, qint64 fromNs, qint64 toNs) const
+{
+    QVector<Bucket> result;
+    const Series &series = m_series[level];
+    const qint64 first = floorDiv(fromNs, series.widthNs);
+    const qint64 last = ceilDiv(toNs, series.widthNs);
+    int index = int(std::lower_bound(series.keys.begin(), series.keys.end(), first) - series.keys.begin());
+    for (; index < series.keys.size() && series.keys.at(index) < last; ++index) {
+        Bucket bucket;
+        bucket.startNs = series.keys.at(index) * series.widthNs;
+        bucket.count = series.cumulative.at(index) - (index > 0 ? series.cumulative.at(index - 1) : 0);
+        result.append(bucket);
+    }
+    return result;
+}
+
+QByteArray StampRollup::serialize(qint64 tag) const
+{
+    const Series &minutes = m_series[Minute];
+    QByteArray data(HeaderBytes + minutes.keys.size() * BucketBytes, Qt::Uninitialized);
+    char *p = data.data();
+    std::memcpy(p, RollupMagic, 4);
+    qToLittleEndian(RollupVersion, p + 4);
+    qToLittleEndian(tag, p + 8);
+    qToLittleEndian(total(), p + 16);
+    qToLittleEndian(quint32(minutes.keys.size()), p + 24);
+    p += HeaderBytes;
+    qint64 previous = 0;
+    for (int i = 0; i < minutes.keys.size(); ++i) {
+        qToLittleEndian(minutes.keys.at(i), p);
+        qToLittleEndian(quint32(minutes.cumulative.at(i) - previous), p + 8);
+        previous = minutes.cumulative.at(i);
+        p += BucketBytes;
+    }
+    return data;
+}
+
+bool StampRollup::deserialize(const QByteArray &data, qint64 *tag)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    if (data.size() < HeaderBytes || std::memcmp(p, RollupMagic, 4) != 0
+        || qFromLittleEndian<quint32>(p + 4) != RollupVersion)
+        return false;
+    const qint64 expectedTotal = qFromLittleEndian<qint64>(p + 16);
+    const quint32 count = qFromLittleEndian<quint32>(p + 24);
+    if (data.size() != HeaderBytes + qint64(count) * BucketBytes)
+        return false;
+
+    clear();
+    p += HeaderBytes;
+    qint64 previousKey = std::numeric_limits<qint64>::min();
+    for (quint32 i = 0; i < count; ++i) {
+        const qint64 key = qFromLittleEndian<qint64>(p);
+        const quint32 bucketCount = qFromLittleEndian<quint32>(p + 8);
+        p += BucketBytes;
+        if (key <= previousKey) {
+            clear();
+            return false;
+        }
+        previousKey = key;
+        // 分钟按顺序读入, 各级都只在末尾追加
+        const qint64 startNs = key * MinuteNs;
+        for (Series &series : m_series)
+            series.add(floorDiv(startNs, series.widthNs), bucketCount);
+    }
+    if (total() != expectedTotal) {
+        clear();
+        return false;
+    }
+    if (tag)
+        *tag = qFromLittleEndian<qint64>(data.constData() + 8);
+    return true;
+}
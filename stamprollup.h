@@ -0,0 +1,62 @@
+#ifndef STAMPROLLUP_H
+#define STAMPROLLUP_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * 时间戳按分钟/小时/天(UTC 对齐)的计数汇总
+ *
+ * 每一级是按桶起点排序的稀疏数组, 存累计计数: 任意区间内整桶的计数是两次二分查找之差.
+ * 记录基本按时间顺序到达, 追加到末桶为 O(1); 迟到的记录只需更新其后的累计值.
+ * 持久化时只存分钟级, 小时与天在读入时由分钟汇总.
+ */
+class StampRollup
+{
+public:
+    enum Level {
+        Minute,
+        Hour,
+        Day,
+        LevelCount
+    };
+
+    struct Bucket {
+        qint64 startNs = 0;
+        qint64 count = 0;
+    };
+
+    StampRollup();
+
+    void add(qint64 timeNs);
+    void clear();
+
+    qint64 total() const;
+    static qint64 widthNs(Level level);
+
+    // [fromNs, toNs) 内所有整分钟的计数; 两端按分钟向内取整. O(log n)
+    qint64 count(qint64 fromNs, qint64 toNs) const;
+    // 与 [fromNs, toNs) 相交的各桶(只含非空桶)
+    QVector<Bucket> buckets(Level level, qint64 fromNs, qint64 toNs) const;
+
+    // 小端序: "TSRU", u32 版本, i64 附加数据, i64 总数, u32 桶数, 每桶 i64 分钟序号 + u32 计数
+    QByteArray serialize(qint64 tag) const;
+    bool deserialize(const QByteArray &data, qint64 *tag);
+
+private:
+    struct Series {
+        qint64 widthNs = 0;
+        QVector<qint64> keys;
+        // cumulative[i] 为前 i+1 个桶的计数之和
+        QVector<qint64> cumulative;
+
+        void add(qint64 key, qint64 count);
+        // 桶序号小于 key 的计数之和
+        qint64 before(qint64 key) const;
+    };
+
+    Series m_series[LevelCount];
+};
+
+#endif // STAMPROLLUP_H
@@ -0,0 +1,377 @@
+#include "stampsinks.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonObject>
+#include <QLocalSocket>
+#include <QMutexLocker>
+#include <cstdio>
+#include "clocksource.h"
+#include "pastesequence.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 把文件内容刷到磁盘
+bool syncToDisk(QFile &file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle()))) != 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+StampSink::StampSink(const QString &name) :
+    m_name(name)
+{
+}
+
+StampSink::Counters StampSink::counters() const
+{
+    Counters counters;
+    counters.written = m_written.loadRelaxed();
+    counters.dropped = m_dropped.loadRelaxed();
+    counters.failed = m_failed.loadRelaxed();
+    counters.totalLatencyNs = m_totalLatencyNs.loadRelaxed();
+    counters.maxLatencyNs = m_maxLatencyNs.loadRelaxed();
+    return counters;
+}
+
+void StampSink::recordWritten(const QVector<Stamp> &batch, bool ok, qint64 doneNs)
+{
+    if (!ok) {
+        m_failed.fetchAndAddRelaxed(batch.size());
+        return;
+    }
+    // 每个 sink 只由一个线程写入计数
+    qint64 total = 0;
+    qint64 maximum = m_maxLatencyNs.loadRelaxed();
+    for (const Stamp &stamp : batch) {
+        const qint64 latency = doneNs - stamp.publishedNs;
+        total += latency;
+        maximum = qMax(maximum, latency);
+    }
+    m_written.fetchAndAddRelaxed(batch.size());
+    m_totalLatencyNs.fetchAndAddRelaxed(total);
+    m_maxLatencyNs.storeRelaxed(maximum);
+}
+
+ClipboardSink::ClipboardSink(PasteSequence *sequence) :
+    StampSink(QStringLiteral("clipboard")),
+    m_sequence(sequence)
+{
+}
+
+bool ClipboardSink::write(const QVector<Stamp> &batch)
+{
+    for (const Stamp &stamp : batch) {
+        if (stamp.macro.isEmpty())
+            m_sequence->run(stamp.text, stamp.paste);
+        else
+            m_sequence->runMacro(stamp.text, stamp.macro);
+    }
+    return true;
+}
+
+FileSink::FileSink(const QString &path) :
+    StampSink(QStringLiteral("file:") + QFileInfo(path).fileName()),
+    m_file(path)
+{
+}
+
+void FileSink::open()
+{
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append))
+        qWarning() << "无法打开输出文件" << m_file.fileName() << m_file.errorString();
+}
+
+void FileSink::close()
+{
+    m_file.close();
+}
+
+bool FileSink::write(const QVector<Stamp> &batch)
+{
+    if (!m_file.isOpen())
+        return false;
+    for (const Stamp &stamp : batch) {
+        m_file.write(stamp.utf8);
+        m_file.write("\n", 1);
+    }
+    return syncToDisk(m_file);
+}
+
+LocalSocketSink::LocalSocketSink(const QString &serverName) :
+    StampSink(QStringLiteral("socket:") + serverName),
+    m_serverName(serverName)
+{
+}
+
+LocalSocketSink::~LocalSocketSink()
+{
+    delete m_socket;
+}
+
+void LocalSocketSink::open()
+{
+    // 套接字须在工作线程中创建, 之后只在此线程中以阻塞方式使用
+    m_socket = new QLocalSocket;
+}
+
+void LocalSocketSink::close()
+{
+    delete m_socket;
+    m_socket = nullptr;
+}
+
+bool LocalSocketSink::write(const QVector<Stamp> &batch)
+{
+    if (m_socket->state() != QLocalSocket::ConnectedState) {
+        m_socket->abort();
+        m_socket->connectToServer(m_serverName);
+        if (!m_socket->waitForConnected(200))
+            return false;
+    }
+    for (const Stamp &stamp : batch) {
+        m_socket->write(stamp.utf8);
+        m_socket->write("\n", 1);
+    }
+    while (m_socket->bytesToWrite() > 0) {
+        if (!m_socket->waitForBytesWritten(1000))
+            return false;
+    }
+    return true;
+}
+
+StdoutSink::StdoutSink() :
+    StampSink(QStringLiteral("stdout"))
+{
+}
+
+void StdoutSink::open()
+{
+    m_out.open(stdout, QIODevice::WriteOnly);
+}
+
+bool StdoutSink::write(const QVector<Stamp> &batch)
+{
+    for (const Stamp &stamp : batch) {
+        m_out.write(stamp.utf8);
+        m_out.write("\n", 1);
+    }
+    return m_out.flush();
+}
+
+StampPipeline::Worker::Worker(StampSink *sink, int capacity) :
+    m_sink(sink),
+    m_capacity(qMax(1, capacity))
+{
+    setObjectName(QStringLiteral("sink ") + sink->name());
+    m_queue.reserve(m_capacity);
+}
+
+StampPipeline::Worker::~Worker()
+{
+    stop();
+    delete m_sink;
+}
+
+void StampPipeline::Worker::enqueue(const StampSink::Stamp &stamp)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_stopping || m_queue.size() >= m_capacity) {
+        m_sink->recordDropped();
+        return;
+    }
+    m_queue.append(stamp);
+    m_wake.wakeOne();
+}
+
+void StampPipeline::Worker::requestStop()
+{
+    QMutexLocker locker(&m_mutex);
+    m_stopping = true;
+    m_wake.wakeOne();
+}
+
+void StampPipeline::Worker::stop()
+{
+    requestStop();
+    wait();
+}
+
+void StampPipeline::Worker::run()
+{
+    m_sink->open();
+    QVector<StampSink::Stamp> batch;
+    batch.reserve(m_capacity);
+    for (;;) {
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_queue.isEmpty() && !m_stopping)
+                m_wake.wait(&m_mutex);
+            // 停止前写完已入队的时间戳
+            if (m_queue.isEmpty())
+                break;
+            batch.swap(m_queue);
+        }
+        const bool ok = m_sink->write(batch);
+        m_sink->recordWritten(batch, ok, ClockSource::current()->nowNs());
+        batch.clear();
+    }
+    m_sink->close();
+}
+
+StampPipeline::StampPipeline(QObject *parent) :
+    QObject(parent)
+{
+}
+
+StampPipeline::~StampPipeline()
+{
+    // 退出时等所有输出线程写完, 包括重新配置时移除的
+    drain();
+    clear();
+    qDeleteAll(m_retired);
+    m_retired.clear();
+}
+
+void StampPipeline::addSink(StampSink *sink, int queueCapacity)
+{
+    if (sink->isSynchronous()) {
+        m_syncSinks.append(sink);
+        return;
+    }
+    Worker *worker = new Worker(sink, queueCapacity);
+    m_workers.append(worker);
+    worker->start(QThread::LowPriority);
+}
+
+void StampPipeline::drain()
+{
+    for (Worker *worker : std::as_const(m_workers))
+        worker->stop();
+    for (Worker *worker : std::as_const(m_retired))
+        worker->stop();
+}
+
+void StampPipeline::clear()
+{
+    // 慢 sink 可能正阻塞在一次写入中(如套接字重连), 不在 GUI 线程中等它
+    for (Worker *worker : std::as_const(m_workers)) {
+        // drain() 之后线程已结束
+        if (worker->isFinished()) {
+            delete worker;
+            continue;
+        }
+        m_retired.append(worker);
+        connect(worker, &QThread::finished, this, [this, worker]() {
+            m_retired.removeOne(worker);
+            delete worker;
+        });
+        worker->requestStop();
+    }
+    m_workers.clear();
+    qDeleteAll(m_syncSinks);
+    m_syncSinks.clear();
+}
+
+StampSink *StampPipeline::createSink(const QJsonObject &object, QString *error)
+{
+    const QString type = object.value("type").toString();
+    if (type == "file") {
+        const QString path = object.value("path").toString();
+        if (!path.isEmpty())
+            return new FileSink(path);
+    } else if (type == "socket") {
+        const QString name = object.value("name").toString();
+        if (!name.isEmpty())
+            return new LocalSocketSink(name);
+    } else if (type == "stdout") {
+        return new StdoutSink;
+    }
+    if (error)
+        *error = QString("无效的输出: %1").arg(type);
+    return nullptr;
+}
+
+bool StampPipeline::configure(const QJsonArray &config, PasteSequence *sequence, QString *error)
+{
+    QList<QPair<StampSink *, int>> created;
+    for (const QJsonValue &value : config) {
+        const QJsonObject object = value.toObject();
+        // 剪贴板始终存在
+        if (object.value("type").toString() == "clipboard")
+            continue;
+        StampSink *sink = createSink(object, error);
+        if (!sink) {
+            for (const auto &pair : std::as_const(created))
+                delete pair.first;
+            return false;
+        }
+        created.append({sink, object.value("queue").toInt(DefaultQueueCapacity)});
+    }
+
+    clear();
+    addSink(new ClipboardSink(sequence));
+    for (const auto &pair : std::as_const(created))
+        addSink(pair.first, pair.second);
+    return true;
+}
+
+void StampPipeline::publish(const QString &text, qint64 pressNs, bool paste, const QString &macro)
+{
+    StampSink::Stamp stamp;
+    stamp.text = text;
+    stamp.utf8 = text.toUtf8();
+    stamp.pressNs = pressNs;
+    stamp.publishedNs = ClockSource::current()->nowNs();
+    stamp.paste = paste;
+    stamp.macro = macro;
+
+    // 先入队, 慢 sink 与剪贴板并行; 队列中的副本与这里共享同一份数据
+    for (Worker *worker : std::as_const(m_workers))
+        worker->enqueue(stamp);
+
+    const QVector<StampSink::Stamp> batch{stamp};
+    for (StampSink *sink : std::as_const(m_syncSinks))
+        sink->recordWritten(batch, sink->write(batch), ClockSource::current()->nowNs());
+}
+
+QList<StampSink *> StampPipeline::sinks() const
+{
+    QList<StampSink *> sinks = m_syncSinks;
+    for (const Worker *worker : m_workers)
+        sinks.append(worker->sink());
+    return sinks;
+}
+
+QString StampPipeline::report() const
+{
+    QStringList lines;
+    for (const StampSink *sink : sinks()) {
+        const StampSink::Counters counters = sink->counters();
+        const qint64 averageNs = counters.written ? counters.totalLatencyNs / qint64(counters.written) : 0;
+        lines.append(QString("%1: 写入 %2, 丢弃 %3, 失败 %4, 平均 %5 us, 最大 %6 us")
+                         .arg(sink->name())
+                         .arg(counters.written)
+                         .arg(counters.dropped)
+                         .arg(counters.failed)
+                         .arg(averageNs / 1000)
+                         .arg(counters.maxLatencyNs / 1000));
+    }
+    return lines.join('\n');
+}
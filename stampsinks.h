@@ -0,0 +1,189 @@
+#ifndef STAMPSINKS_H
+#define STAMPSINKS_H
+
+#include <QAtomicInteger>
+#include <QByteArray>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+class PasteSequence;
+class QLocalSocket;
+
+/**
+ * 时间戳输出目标
+ *
+ * 同一次按下生成的时间戳只渲染一次(QString 与 UTF-8 各一份),
+ * 以隐式共享的方式交给每个 sink, 不再复制内容.
+ * 同步 sink(剪贴板)在 publish 的线程中直接调用;
+ * 其余 sink 各有一个线程和有界队列, 队列满时丢弃新时间戳并计数, 不会阻塞剪贴板路径.
+ * 重新配置时旧的输出线程在后台写完已入队的时间戳后自行结束, 不等待.
+ */
+class StampSink
+{
+public:
+    struct Stamp {
+        QString text;
+        QByteArray utf8;
+        qint64 pressNs = 0;
+        // 交给 pipeline 的时刻, 用于统计各 sink 的延迟
+        qint64 publishedNs = 0;
+        bool paste = false;
+        // 剪贴板 sink 执行的宏名, 为空时按 paste 选择内置的 "paste"/"copy"
+        QString macro;
+    };
+
+    struct Counters {
+        quint64 written = 0;
+        quint64 dropped = 0;
+        quint64 failed = 0;
+        // publish -> 写入完成(文件为 fsync 之后)
+        qint64 totalLatencyNs = 0;
+        qint64 maxLatencyNs = 0;
+    };
+
+    explicit StampSink(const QString &name);
+    virtual ~StampSink() = default;
+
+    QString name() const { return m_name; }
+    virtual bool isSynchronous() const { return false; }
+
+    // 在 sink 所在线程中, 第一次写入前/停止后调用
+    virtual void open() {}
+    virtual void close() {}
+    // 异步 sink 每次取出队列中的全部时间戳, 便于合并提交
+    virtual bool write(const QVector<Stamp> &batch) = 0;
+
+    Counters counters() const;
+    void recordWritten(const QVector<Stamp> &batch, bool ok, qint64 doneNs);
+    void recordDropped() { m_dropped.fetchAndAddRelaxed(1); }
+
+private:
+    QString m_name;
+    QAtomicInteger<quint64> m_written;
+    QAtomicInteger<quint64> m_dropped;
+    QAtomicInteger<quint64> m_failed;
+    QAtomicInteger<qint64> m_totalLatencyNs;
+    QAtomicInteger<qint64> m_maxLatencyNs;
+};
+
+// 剪贴板(及可选的 Ctrl+V/A/C 或指定的动作宏), 同步
+class ClipboardSink : public StampSink
+{
+public:
+    explicit ClipboardSink(PasteSequence *sequence);
+    bool isSynchronous() const override { return true; }
+    bool write(const QVector<Stamp> &batch) override;
+
+private:
+    PasteSequence *m_sequence;
+};
+
+// 追加写入文件, 每批只 fsync 一次(组提交)
+class FileSink : public StampSink
+{
+public:
+    explicit FileSink(const QString &path);
+    void open() override;
+    void close() override;
+    bool write(const QVector<Stamp> &batch) override;
+
+private:
+    QFile m_file;
+};
+
+// 以行写入本地套接字(QLocalServer), 断开后下一批重连
+class LocalSocketSink : public StampSink
+{
+public:
+    explicit LocalSocketSink(const QString &serverName);
+    ~LocalSocketSink() override;
+    void open() override;
+    void close() override;
+    bool write(const QVector<Stamp> &batch) override;
+
+private:
+    QString m_serverName;
+    QLocalSocket *m_socket = nullptr;
+};
+
+// 以行写入本进程标准输出, 供启动本程序的配套进程读取
+class StdoutSink : public StampSink
+{
+public:
+    StdoutSink();
+    void open() override;
+    bool write(const QVector<Stamp> &batch) override;
+
+private:
+    QFile m_out;
+};
+
+class StampPipeline : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int DefaultQueueCapacity = 256;
+
+    explicit StampPipeline(QObject *parent = nullptr);
+    ~StampPipeline() override;
+
+    // 接管 sink; 异步 sink 立即启动线程
+    void addSink(StampSink *sink, int queueCapacity = DefaultQueueCapacity);
+    // 移除所有 sink, 不等待: 异步 sink 的线程写完已入队的时间戳后自行结束并删除
+    void clear();
+    // 停止各输出线程, 等已入队的时间戳写完; 之后发布给异步输出的时间戳计为丢弃
+    void drain();
+
+    // 按配置重建: 剪贴板总在最前, 其后为 config 中的 file/socket/stdout
+    bool configure(const QJsonArray &config, PasteSequence *sequence, QString *error = nullptr);
+    static StampSink *createSink(const QJsonObject &object, QString *error);
+
+    // 渲染一次 UTF-8 后分发; 只做入队, 慢 sink 不会拖慢调用方
+    void publish(const QString &text, qint64 pressNs, bool paste, const QString &macro = QString());
+
+    QList<StampSink *> sinks() const;
+    // 每个 sink 一行: 写入/丢弃/失败次数与平均/最大延迟
+    QString report() const;
+
+private:
+    class Worker : public QThread
+    {
+    public:
+        Worker(StampSink *sink, int capacity);
+        ~Worker() override;
+
+        StampSink *sink() const { return m_sink; }
+        // 已停止或队列满时丢弃并计数
+        void enqueue(const StampSink::Stamp &stamp);
+        // 请求停止, 线程写完已入队的时间戳后结束; stop() 同时等待结束
+        void requestStop();
+        void stop();
+
+    protected:
+        void run() override;
+
+    private:
+        StampSink *m_sink;
+        int m_capacity;
+        QMutex m_mutex;
+        QWaitCondition m_wake;
+        QVector<StampSink::Stamp> m_queue;
+        bool m_stopping = false;
+    };
+
+    QList<StampSink *> m_syncSinks;
+    QList<Worker *> m_workers;
+    // clear() 移除后仍在写完队列的线程, 结束时删除; 析构时等待
+    QList<Worker *> m_retired;
+};
+
+#endif // STAMPSINKS_H
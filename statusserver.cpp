@@ -0,0 +1,78 @@
+#include "statusserver.h"
+
+#include <QLocalSocket>
+#include "idlemanager.h"
+
+StatusServer::StatusServer(QObject *parent) :
+    QObject(parent)
+{
+    m_server.setSocketOptions(QLocalServer::UserAccessOption);
+    connect(&m_server, &QLocalServer::newConnection, this, &StatusServer::onNewConnection);
+}
+
+bool StatusServer::listen(QString *error)
+{
+    if (m_server.listen(serverName()))
+        return true;
+    if (m_server.serverError() == QAbstractSocket::AddressInUseError) {
+        // 上次异常退出留下的套接字文件(非 Windows): 没有实例应答时清理后重试
+        QString reply;
+        if (!query(QStringLiteral("memory"), reply, nullptr, 200)) {
+            QLocalServer::removeServer(serverName());
+            if (m_server.listen(serverName()))
+                return true;
+        }
+    }
+    if (error)
+        *error = m_server.errorString();
+    return false;
+}
+
+QString StatusServer::serverName()
+{
+    QString user = qEnvironmentVariable("USERNAME");
+    if (user.isEmpty())
+        user = qEnvironmentVariable("USER");
+    return QStringLiteral("TimestampHotkey-status-") + user;
+}
+
+bool StatusServer::query(const QString &command, QString &reply, QString *error, int timeoutMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(timeoutMs)) {
+        if (error)
+            *error = QString("托盘程序未运行(%1)").arg(socket.errorString());
+        return false;
+    }
+    socket.write(command.toUtf8() + '\n');
+    while (!socket.canReadLine()) {
+        if (!socket.waitForReadyRead(timeoutMs)) {
+            if (error)
+                *error = QString("托盘程序没有应答(%1)").arg(socket.errorString());
+            return false;
+        }
+    }
+    reply = QString::fromUtf8(socket.readLine()).trimmed();
+    return true;
+}
+
+void StatusServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server.nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, socket, [socket]() {
+            if (!socket->canReadLine())
+                return;
+            socket->write(handle(socket->readLine().trimmed()) + '\n');
+            socket->disconnectFromServer();
+        });
+    }
+}
+
+QByteArray StatusServer::handle(const QByteArray &command)
+{
+    if (command == "memory")
+        return IdleManager::memoryReport().toUtf8();
+    return "未知命令: " + command;
+}
@@ -0,0 +1,36 @@
+#ifndef STATUSSERVER_H
+#define STATUSSERVER_H
+
+#include <QLocalServer>
+#include <QObject>
+#include <QString>
+
+/**
+ * 托盘程序的状态查询
+ *
+ * 托盘程序没有控制台, 命令行工具经本地套接字向正在运行的实例查询. 每个连接发送一行命令,
+ * 收到一行回复后由服务端断开; 目前只有 "memory", 回复 IdleManager::memoryReport().
+ * 套接字名含用户名, 只允许同一用户连接.
+ */
+class StatusServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit StatusServer(QObject *parent = nullptr);
+
+    // 开始监听; 已有实例在监听时返回 false (Windows 上同名管道可重复创建, 查询连到其中之一)
+    bool listen(QString *error = nullptr);
+
+    static QString serverName();
+    // 连接正在运行的实例并发送 command, 没有实例或超时时返回 false 并写入 error
+    static bool query(const QString &command, QString &reply, QString *error = nullptr, int timeoutMs = 1000);
+
+private:
+    void onNewConnection();
+    static QByteArray handle(const QByteArray &command);
+
+    QLocalServer m_server;
+};
+
+#endif // STATUSSERVER_H
@@ -0,0 +1,25 @@
+#include <QApplication>
+#include <QStandardPaths>
+#include "testregistry.h"
+
+/**
+ * 单元测试: 运行 tests/ 下登记的全部测试类, 返回失败的类数
+ *
+ * 不需要桌面: 未指定平台插件时使用 offscreen(剪贴板在进程内). Windows 上保留默认插件,
+ * 剪贴板快照与按键注入直接使用 Win32 剪贴板和输入队列, 须与 Qt 看到的是同一个.
+ */
+int main(int argc, char *argv[])
+{
+#ifndef Q_OS_WIN
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+#endif
+    // 托盘通知的测试经 QSystemTrayIcon 显示, 与程序相同
+    QApplication app(argc, argv);
+    app.setOrganizationName("TimestampHotkey");
+    app.setApplicationName("TimestampHotkey_tests");
+    // 配置与历史目录指向测试专用位置, 不碰用户的数据
+    QStandardPaths::setTestModeEnabled(true);
+
+    return TestRegistry::run(app.arguments());
+}
@@ -0,0 +1,54 @@
+#include "testregistry.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QScopedPointer>
+#include <QTest>
+#include <algorithm>
+
+QVector<TestRegistry::Entry> &TestRegistry::entries()
+{
+    static QVector<Entry> entries;
+    return entries;
+}
+
+bool TestRegistry::add(const char *name, Factory factory)
+{
+    entries().append({QString::fromLatin1(name), std::move(factory)});
+    return true;
+}
+
+int TestRegistry::run(const QStringList &arguments, const QString &resultsDir)
+{
+    // 登记顺序取决于链接顺序, 按类名排序使输出稳定
+    QVector<Entry> sorted = entries();
+    std::sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) { return a.name < b.name; });
+
+    QStringList selected;
+    QStringList passThrough{arguments.value(0)};
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        const bool isClass = std::any_of(sorted.cbegin(), sorted.cend(),
+                                         [&argument](const Entry &entry) { return entry.name == argument; });
+        (isClass ? selected : passThrough).append(argument);
+    }
+    if (!resultsDir.isEmpty() && !QDir().mkpath(resultsDir)) {
+        qWarning() << "无法创建结果目录" << resultsDir;
+        return 1;
+    }
+
+    int failed = 0;
+    for (const Entry &entry : std::as_const(sorted)) {
+        if (!selected.isEmpty() && !selected.contains(entry.name))
+            continue;
+        QStringList testArguments = passThrough;
+        if (!resultsDir.isEmpty()) {
+            testArguments << "-o" << QDir(resultsDir).filePath(entry.name + ".xml") + ",xml"
+                          << "-o" << "-,txt";
+        }
+        QScopedPointer<QObject> test(entry.factory());
+        if (QTest::qExec(test.data(), testArguments) != 0)
+            ++failed;
+    }
+    return failed;
+}
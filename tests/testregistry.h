@@ -0,0 +1,39 @@
+#ifndef TESTREGISTRY_H
+#define TESTREGISTRY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+
+/**
+ * 测试类登记表
+ *
+ * 每个 tst_*.cpp / bench_*.cpp 用 REGISTER_TEST 登记自己的测试类, 测试程序与基准程序
+ * 按类名顺序把登记的类逐个交给 QTest::qExec. 命令行中与类名相同的参数表示只运行这些类,
+ * 其余参数原样传给 QTest(如测试函数名、-maxwarnings).
+ */
+class TestRegistry
+{
+public:
+    using Factory = std::function<QObject *()>;
+
+    static bool add(const char *name, Factory factory);
+
+    // resultsDir 非空时, 每个类的结果另以 XML 写入 <resultsDir>/<类名>.xml; 返回失败的类数
+    static int run(const QStringList &arguments, const QString &resultsDir = QString());
+
+private:
+    struct Entry {
+        QString name;
+        Factory factory;
+    };
+
+    static QVector<Entry> &entries();
+};
+
+#define REGISTER_TEST(Class) \
+    static const bool registered##Class = TestRegistry::add(#Class, []() -> QObject * { return new Class; });
+
+#endif // TESTREGISTRY_H
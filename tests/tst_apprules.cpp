@@ -0,0 +1,117 @@
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTest>
+#include "actionmacro.h"
+#include "apprules.h"
+#include "hotkeyprofile.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+/**
+ * 程序规则: 索引匹配与逐条比较的结果一致(按文件顺序取第一条); apprules.h 中的示例配置
+ * 连同其宏可以加载, 引用未定义的宏时加载失败
+ */
+class TestAppRules : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void matchesLinear();
+    void documentedExample();
+    void undefinedMacro();
+
+private:
+    static QByteArray profile(const QString &macros);
+};
+
+void TestAppRules::matchesLinear()
+{
+    // 按进程名、按类名、限定热键的规则交错, 同一窗口常有多条候选
+    const int count = 500;
+    const QKeySequence shortcut(QStringLiteral("Ctrl+`"));
+    QJsonArray config;
+    for (int i = 0; i < count; ++i) {
+        QJsonObject rule;
+        if (i % 2 == 0)
+            rule.insert("process", QString("App%1.exe").arg(i % 40));
+        else
+            rule.insert("class", QString("Class%1").arg(i % 30));
+        if (i % 5 == 0)
+            rule.insert("shortcut", "Ctrl+Shift+`");
+        rule.insert("format", TimestampFormatter::IsoPattern);
+        config.append(rule);
+    }
+    AppRules rules;
+    QString error;
+    QVERIFY2(AppRules::parse(config, rules, &error), qPrintable(error));
+
+    int matched = 0;
+    for (int i = 0; i < 256; ++i) {
+        ForegroundApp::Window window;
+        window.process = QString("app%1.exe").arg(i % 60);
+        window.windowClass = QString("class%1").arg(i % 45);
+        const AppRules::Rule *expected = nullptr;
+        for (const AppRules::Rule &rule : rules.rules()) {
+            if ((rule.process.isEmpty() || rule.process == window.process)
+                && (rule.windowClass.isEmpty() || rule.windowClass == window.windowClass)
+                && (rule.shortcut.isEmpty() || rule.shortcut == shortcut)) {
+                expected = &rule;
+                break;
+            }
+        }
+        QCOMPARE(rules.match(window, shortcut), expected);
+        matched += expected != nullptr;
+    }
+    QVERIFY(matched > 0);
+    QVERIFY(matched < 256);
+}
+
+QByteArray TestAppRules::profile(const QString &macros)
+{
+    return QString(R"({
+    "hotkeys": [{ "shortcut": "Ctrl+`", "format": "yyyyMMdd-HHmmsszzz", "action": "paste" }],
+    "macros": { %1 },
+    "apps": [
+        { "process": "windowsterminal.exe", "action": "copy" },
+        { "process": "excel.exe", "format": "yyyy-MM-dd'T'HH:mm:ss.zzzttt" },
+        { "class": "notepad", "shortcut": "Ctrl+`", "action": "enter" }
+    ]
+})")
+        .arg(macros)
+        .toUtf8();
+}
+
+void TestAppRules::documentedExample()
+{
+    QList<HotkeyProfile::Entry> entries;
+    QJsonObject macros;
+    AppRules apps;
+    QString error;
+    QVERIFY2(HotkeyProfile::parse(profile(R"("enter": ["clipboard", "ready", "release", "inject Ctrl+V", "delay 50", "inject Return"])"),
+                                  entries, nullptr, &error, nullptr, &macros, &apps),
+             qPrintable(error));
+    QCOMPARE(apps.size(), 3);
+    ActionMacro enter;
+    QVERIFY2(ActionMacro::parse(macros.value("enter").toArray(), enter, &error), qPrintable(error));
+    QCOMPARE(enter.steps.size(), 6);
+
+    ForegroundApp::Window notepad;
+    notepad.windowClass = "notepad";
+    const AppRules::Rule *rule = apps.match(notepad, QKeySequence(QStringLiteral("Ctrl+`")));
+    QVERIFY(rule);
+    QCOMPARE(rule->action, QString("enter"));
+    QVERIFY(!apps.match(notepad, QKeySequence(QStringLiteral("Ctrl+Shift+`"))));
+}
+
+void TestAppRules::undefinedMacro()
+{
+    QList<HotkeyProfile::Entry> entries;
+    AppRules apps;
+    QString error;
+    QVERIFY(!HotkeyProfile::parse(profile(QString()), entries, nullptr, &error, nullptr, nullptr, &apps));
+    QVERIFY(error.contains("enter"));
+}
+
+REGISTER_TEST(TestAppRules)
+
+#include "tst_apprules.moc"
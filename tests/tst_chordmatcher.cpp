@@ -0,0 +1,186 @@
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTest>
+#include <qhotkey.h>
+#include "chordmatcher.h"
+#include "clocksource.h"
+#include "testregistry.h"
+
+/**
+ * 多段热键: 前缀树按组合键逐层查找; ChordMatcher 在无头模式下由 postNativeEvent 送入按键,
+ * 与真实热键一样经监听线程分发. 检查各层各自的超时、本身也绑定了动作的前缀要等超时才触发,
+ * 以及序列中途按了其他首段时放弃当前序列、已注销的后续按键不再生效
+ */
+class TestChordMatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void trieLookup();
+    void secondStroke();
+    void levelTimeouts();
+    void boundPrefix();
+    void resetAfterMismatch();
+    void cleanupTestCase();
+
+private:
+    static ChordTrie trie(const QList<QPair<QString, int>> &bindings);
+    // 按下 key 对应的原生热键
+    static void press(const QString &key);
+};
+
+void TestChordMatcher::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+ChordTrie TestChordMatcher::trie(const QList<QPair<QString, int>> &bindings)
+{
+    ChordTrie result;
+    for (const auto &binding : bindings)
+        result.insert(QKeySequence(binding.first, QKeySequence::PortableText), binding.second);
+    return result;
+}
+
+void TestChordMatcher::press(const QString &key)
+{
+    const QHotkey hotkey(QKeySequence(key, QKeySequence::PortableText));
+    QVERIFY(hotkey.currentNativeShortcut().isValid());
+    QHotkey::postNativeEvent(hotkey.currentNativeShortcut());
+}
+
+void TestChordMatcher::trieLookup()
+{
+    const ChordTrie chords = trie({{"Ctrl+`", 0}, {"Ctrl+`, D", 1}, {"Ctrl+`, D, E", 2}, {"Ctrl+Shift+`", 3}});
+    const QKeySequence sequence("Ctrl+`, D, E", QKeySequence::PortableText);
+
+    int node = chords.root();
+    for (int i = 0; i < sequence.count(); ++i) {
+        node = chords.child(node, ChordTrie::chordAt(sequence, i));
+        QVERIFY(node != ChordTrie::NoNode);
+        QCOMPARE(chords.depth(node), i + 1);
+        QCOMPARE(chords.value(node), i);
+    }
+    QVERIFY(!chords.hasChildren(node));
+    QCOMPARE(chords.childChords(chords.root()).size(), 2);
+    QCOMPARE(chords.child(chords.root(), ChordTrie::chordAt(QKeySequence("D", QKeySequence::PortableText), 0)),
+             ChordTrie::NoNode);
+}
+
+void TestChordMatcher::secondStroke()
+{
+    ChordMatcher matcher;
+    matcher.setTrie(trie({{"Ctrl+`, D", 1}}));
+    QVERIFY(matcher.failedShortcuts().isEmpty());
+    QSignalSpy matched(&matcher, &ChordMatcher::matched);
+
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    QCOMPARE(matched.count(), 0);
+    press("D");
+    QTRY_COMPARE(matched.count(), 1);
+    QCOMPARE(matched.at(0).at(0).toInt(), 1);
+    QVERIFY(!matcher.isPending());
+    // 只是一次分发, 远小于等待下一段的超时
+    QVERIFY2(matcher.lastMatchLatencyNs() >= 0 && matcher.lastMatchLatencyNs() < 100000000,
+             qPrintable(QString("末段按下到匹配 %1 ms").arg(matcher.lastMatchLatencyNs() / 1000000.0)));
+}
+
+void TestChordMatcher::levelTimeouts()
+{
+    ChordMatcher matcher;
+    matcher.setTrie(trie({{"Ctrl+`, D, E", 1}}));
+    matcher.setLevelTimeouts({400, 100});
+    QSignalSpy matched(&matcher, &ChordMatcher::matched);
+    QElapsedTimer timer;
+
+    // 第一层: 400 ms 内没有下一段即放弃
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    timer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(!matcher.isPending(), 2000);
+    QVERIFY2(timer.elapsed() >= 300, qPrintable(QString("第一层 %1 ms 即超时").arg(timer.elapsed())));
+
+    // 第二层使用第二个值
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    press("D");
+    QTest::qWait(50);
+    QVERIFY(matcher.isPending());
+    timer.start();
+    QTRY_VERIFY_WITH_TIMEOUT(!matcher.isPending(), 2000);
+    QVERIFY2(timer.elapsed() < 300, qPrintable(QString("第二层 %1 ms 才超时").arg(timer.elapsed())));
+
+    // 超时后 E 已注销, 不会补上匹配
+    press("E");
+    QTest::qWait(100);
+    QCOMPARE(matched.count(), 0);
+}
+
+void TestChordMatcher::boundPrefix()
+{
+    ChordMatcher matcher;
+    matcher.setTrie(trie({{"Ctrl+`", 1}, {"Ctrl+`, D", 2}}));
+    matcher.setLevelTimeouts({300});
+    QSignalSpy matched(&matcher, &ChordMatcher::matched);
+
+    // 单按前缀: 等满该层超时才触发, 增加的延迟即超时
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    QTRY_COMPARE_WITH_TIMEOUT(matched.count(), 1, 2000);
+    QCOMPARE(matched.at(0).at(0).toInt(), 1);
+    QVERIFY2(matcher.lastMatchLatencyNs() >= 300000000,
+             qPrintable(QString("前缀 %1 ms 即触发").arg(matcher.lastMatchLatencyNs() / 1000000.0)));
+
+    // 超时前按下后续: 只触发较长的序列
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    press("D");
+    QTRY_COMPARE(matched.count(), 2);
+    QCOMPARE(matched.at(1).at(0).toInt(), 2);
+    QTest::qWait(400);
+    QCOMPARE(matched.count(), 2);
+}
+
+void TestChordMatcher::resetAfterMismatch()
+{
+    ChordMatcher matcher;
+    matcher.setTrie(trie({{"Ctrl+`, D", 1}, {"Ctrl+Shift+`, E", 2}}));
+    QSignalSpy matched(&matcher, &ChordMatcher::matched);
+
+    // 序列中途按了另一个首段: 放弃 Ctrl+` 并从新的首段开始
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    press("Ctrl+Shift+`");
+    QTest::qWait(50);
+    QVERIFY(matcher.isPending());
+    // D 随 Ctrl+` 一起注销
+    press("D");
+    QTest::qWait(50);
+    QCOMPARE(matched.count(), 0);
+    QVERIFY(matcher.isPending());
+    press("E");
+    QTRY_COMPARE(matched.count(), 1);
+    QCOMPARE(matched.at(0).at(0).toInt(), 2);
+
+    // 主动放弃后不再等待
+    press("Ctrl+`");
+    QTRY_VERIFY(matcher.isPending());
+    matcher.reset();
+    QVERIFY(!matcher.isPending());
+    press("D");
+    QTest::qWait(50);
+    QCOMPARE(matched.count(), 1);
+}
+
+void TestChordMatcher::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestChordMatcher)
+
+#include "tst_chordmatcher.moc"
@@ -0,0 +1,46 @@
+#include <QTest>
+#include <QThread>
+#include "clocksource.h"
+#include "testregistry.h"
+
+class TestClockSource : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void steps();
+    void tracksRealtime();
+};
+
+void TestClockSource::steps()
+{
+    for (ClockSource::Kind kind : ClockSource::available()) {
+        const ClockSource *source = ClockSource::get(kind);
+        const qint64 first = source->nowNs();
+        QThread::msleep(50);
+        QVERIFY2(source->nowNs() > first, qPrintable(source->name()));
+        QVERIFY(source->measure(1000).readCostNs > 0);
+    }
+}
+
+void TestClockSource::tracksRealtime()
+{
+    // 超过重新锚定的间隔(1 s)后, 各时钟与 Realtime 的差不超过各自的分辨率加 1 ms
+    QThread::msleep(1500);
+    const ClockSource *realtime = ClockSource::get(ClockSource::Realtime);
+    for (int round = 0; round < 3; ++round) {
+        for (ClockSource::Kind kind : ClockSource::available()) {
+            const ClockSource *source = ClockSource::get(kind);
+            const qint64 referenceNs = realtime->nowNs();
+            const qint64 differenceNs = source->nowNs() - referenceNs;
+            const qint64 toleranceNs = 1000000 + 2 * source->nominalResolutionNs();
+            QVERIFY2(qAbs(differenceNs) < toleranceNs,
+                     qPrintable(QString("%1 相差 %2 ns").arg(source->name()).arg(differenceNs)));
+        }
+        QThread::msleep(600);
+    }
+}
+
+REGISTER_TEST(TestClockSource)
+
+#include "tst_clocksource.moc"
@@ -0,0 +1,168 @@
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <limits>
+#include "historymerger.h"
+#include "stamphistory.h"
+#include "testregistry.h"
+
+/**
+ * 多台机器历史的归并: 输出按时间有序、来源带机器名; 未封存的日志与段都参与且只计一次;
+ * 读取失败与非空的输出目录使归并失败
+ */
+class TestHistoryMerger : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void mergeOrdered();
+    void unsealedLogs();
+    void residualSealingLog();
+    void corruptSegmentFails();
+    void nonEmptyOutputRefused();
+
+private:
+    static constexpr qint64 BaseNs = 1700000000000000000ll;
+
+    // 在 directory 的历史中追加 count 条, 时间从 fromNs 起每 step 一条
+    static void fill(const QString &directory, qint64 fromNs, qint64 stepNs, int count, bool seal);
+    // 归并到 merged, 返回输出的条数; 输出时间须单调不减
+    qint64 mergeInto(const QList<HistoryMerger::Input> &inputs, QStringList *sources = nullptr);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestHistoryMerger::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+void TestHistoryMerger::fill(const QString &directory, qint64 fromNs, qint64 stepNs, int count, bool seal)
+{
+    StampHistory history(directory);
+    QVERIFY(history.open());
+    for (int i = 0; i < count; ++i)
+        history.append(fromNs + i * stepNs, "HH:mm", "Ctrl+`");
+    history.flush();
+    if (seal) {
+        history.compact();
+        history.waitForCompaction();
+    }
+}
+
+qint64 TestHistoryMerger::mergeInto(const QList<HistoryMerger::Input> &inputs, QStringList *sources)
+{
+    StampHistory output(m_dir->filePath("merged"));
+    HistoryMerger merger(inputs);
+    QString error;
+    if (!output.open(&error) || !merger.merge(&output, &error)) {
+        qWarning("%s", qPrintable(error));
+        return -1;
+    }
+    qint64 previousNs = std::numeric_limits<qint64>::min();
+    qint64 disorder = 0;
+    const qint64 total = output.query(std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                                      [&](qint64 timeNs, const QString &, const QString &source) {
+                                          if (timeNs < previousNs)
+                                              ++disorder;
+                                          previousNs = timeNs;
+                                          if (sources)
+                                              sources->append(source);
+                                      });
+    if (disorder != 0 || total != merger.stats().entries)
+        return -1;
+    return total;
+}
+
+void TestHistoryMerger::mergeOrdered()
+{
+    fill(m_dir->filePath("a"), BaseNs, 2000, 3000, true);
+    fill(m_dir->filePath("b"), BaseNs + 1000, 2000, 3000, true);
+    // b 还有一段未封存的 active.log
+    fill(m_dir->filePath("b"), BaseNs + 10000000, 1000, 10, false);
+
+    QStringList sources;
+    QCOMPARE(mergeInto({HistoryMerger::parseInput("b=" + m_dir->filePath("b")),
+                        HistoryMerger::parseInput(m_dir->filePath("a"))},
+                       &sources),
+             qint64(6010));
+    // 交替出现, 机器名取自参数或目录名
+    QCOMPARE(sources.at(0), QString("a:Ctrl+`"));
+    QCOMPARE(sources.at(1), QString("b:Ctrl+`"));
+    QCOMPARE(sources.last(), QString("b:Ctrl+`"));
+}
+
+void TestHistoryMerger::unsealedLogs()
+{
+    // seg-0.tss, 未封存完的 sealing-1.log, 以及 active.log: 三者都要计入
+    const QString host = m_dir->filePath("host");
+    fill(host, BaseNs, 1000, 100, true);
+    fill(host, BaseNs + 1000000, 1000, 20, false);
+    QVERIFY(QFile::rename(QDir(host).filePath("active.log"), QDir(host).filePath("sealing-1.log")));
+
+    const QString other = m_dir->filePath("other");
+    fill(other, BaseNs + 2000000, 1000, 7, false);
+    QVERIFY(QFile::copy(QDir(other).filePath("active.log"), QDir(host).filePath("active.log")));
+
+    QCOMPARE(mergeInto({{"host", host}}), qint64(127));
+}
+
+void TestHistoryMerger::residualSealingLog()
+{
+    // 封存完成后未删除的日志: 记录已在 seg-0.tss 中, 不能再计一次
+    const QString host = m_dir->filePath("host");
+    fill(host, BaseNs, 1000, 50, false);
+    QVERIFY(QFile::copy(QDir(host).filePath("active.log"), m_dir->filePath("sealing-0.log")));
+    {
+        StampHistory history(host);
+        QVERIFY(history.open());
+        history.compact();
+        history.waitForCompaction();
+    }
+    QVERIFY(QFile::exists(QDir(host).filePath("seg-0.tss")));
+    QVERIFY(QFile::copy(m_dir->filePath("sealing-0.log"), QDir(host).filePath("sealing-0.log")));
+
+    QCOMPARE(mergeInto({{"host", host}}), qint64(50));
+}
+
+void TestHistoryMerger::corruptSegmentFails()
+{
+    const QString host = m_dir->filePath("host");
+    fill(host, BaseNs, 1000, 100, true);
+    // 最后一个 varint 延伸到文件末尾之外: 头部正常, 读到最后一条时失败
+    QFile segment(QDir(host).filePath("seg-0.tss"));
+    QVERIFY(segment.open(QIODevice::ReadWrite));
+    QVERIFY(segment.seek(segment.size() - 1));
+    segment.write("\x80", 1);
+    segment.close();
+
+    StampHistory output(m_dir->filePath("merged"));
+    QVERIFY(output.open());
+    HistoryMerger merger({{"host", host}});
+    QString error;
+    QVERIFY(!merger.merge(&output, &error));
+    QVERIFY2(error.contains("seg-0.tss"), qPrintable(error));
+}
+
+void TestHistoryMerger::nonEmptyOutputRefused()
+{
+    const QString host = m_dir->filePath("host");
+    fill(host, BaseNs, 1000, 10, true);
+    fill(m_dir->filePath("merged"), BaseNs, 1000, 1, true);
+
+    StampHistory output(m_dir->filePath("merged"));
+    QVERIFY(output.open());
+    HistoryMerger merger({{"host", host}});
+    QString error;
+    QVERIFY(!merger.merge(&output, &error));
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(output.stats().entries, qint64(1));
+}
+
+REGISTER_TEST(TestHistoryMerger)
+
+#include "tst_historymerger.moc"
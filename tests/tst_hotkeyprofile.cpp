@@ -0,0 +1,146 @@
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+#include <qhotkey.h>
+#include "clocksource.h"
+#include "hotkeyprofile.h"
+#include "testregistry.h"
+
+/**
+ * 热键配置的差量重新加载: 200 项的配置在无头模式下加载后只改一项, 检查只注销旧键、注册新键
+ * 各一次(QHotkey::nativeCallCounts 在无头模式下照常计数), 其余 199 项不动, 以及重新加载的耗时
+ */
+class TestHotkeyProfile : public QObject
+{
+    Q_OBJECT
+
+    static constexpr int Entries = 200;
+    // 重新加载 200 项的耗时上限; 实际在百微秒量级, 留足慢机器与调试构建的余量
+    static constexpr qint64 ReloadLimitUs = 50000;
+
+private slots:
+    void initTestCase();
+    void editShortcut();
+    void editFormat();
+    void cleanupTestCase();
+
+private:
+    // 第 i 项的热键: 8 组修饰键 x 26 个字母, 互不相同
+    static QString shortcutAt(int i);
+    static bool writeProfile(const QString &path, const QStringList &shortcuts, const QString &lastFormat);
+    static HotkeyProfile::ReloadStats reload(HotkeyProfile &profile);
+};
+
+void TestHotkeyProfile::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+QString TestHotkeyProfile::shortcutAt(int i)
+{
+    static const char *modifiers[] = {"Ctrl+Alt+", "Ctrl+Shift+", "Alt+Shift+", "Ctrl+Alt+Shift+",
+                                      "Meta+Ctrl+", "Meta+Alt+", "Meta+Shift+", "Meta+Ctrl+Alt+"};
+    return QString::fromLatin1(modifiers[i / 26]) + QChar('A' + i % 26);
+}
+
+bool TestHotkeyProfile::writeProfile(const QString &path, const QStringList &shortcuts, const QString &lastFormat)
+{
+    QJsonArray hotkeys;
+    for (int i = 0; i < shortcuts.size(); ++i) {
+        QJsonObject entry;
+        entry.insert("shortcut", shortcuts.at(i));
+        entry.insert("format", i + 1 == shortcuts.size() ? lastFormat : QString(TimestampFormatter::DefaultPattern));
+        entry.insert("action", i % 2 ? "copy" : "paste");
+        hotkeys.append(entry);
+    }
+    QJsonObject root;
+    root.insert("hotkeys", hotkeys);
+
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return file.write(QJsonDocument(root).toJson()) > 0;
+}
+
+HotkeyProfile::ReloadStats TestHotkeyProfile::reload(HotkeyProfile &profile)
+{
+    HotkeyProfile::ReloadStats result;
+    const QMetaObject::Connection connection = connect(&profile, &HotkeyProfile::reloaded,
+                                                       [&result](const HotkeyProfile::ReloadStats &stats) { result = stats; });
+    const bool ok = profile.reload();
+    disconnect(connection);
+    if (!ok)
+        result.elapsedUs = -1;
+    return result;
+}
+
+void TestHotkeyProfile::editShortcut()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QStringList shortcuts;
+    for (int i = 0; i < Entries; ++i)
+        shortcuts.append(shortcutAt(i));
+    const QString path = dir.filePath("profile.json");
+    QVERIFY(writeProfile(path, shortcuts, TimestampFormatter::DefaultPattern));
+
+    HotkeyProfile profile(path);
+    HotkeyProfile::ReloadStats stats = reload(profile);
+    QVERIFY(stats.elapsedUs >= 0);
+    QCOMPARE(stats.added, Entries);
+    QCOMPARE(stats.registerCalls, quint64(Entries));
+    QCOMPARE(stats.unregisterCalls, quint64(0));
+    QVERIFY(profile.failedShortcuts().isEmpty());
+
+    // 只改第一项的热键: 注销旧键、注册新键各一次
+    shortcuts[0] = "Ctrl+Alt+F5";
+    QVERIFY(writeProfile(path, shortcuts, TimestampFormatter::DefaultPattern));
+    stats = reload(profile);
+    QVERIFY(stats.elapsedUs >= 0);
+    QCOMPARE(stats.added, 1);
+    QCOMPARE(stats.removed, 1);
+    QCOMPARE(stats.changed, 0);
+    QCOMPARE(stats.unchanged, Entries - 1);
+    QCOMPARE(stats.registerCalls, quint64(1));
+    QCOMPARE(stats.unregisterCalls, quint64(1));
+    QVERIFY2(stats.elapsedUs < ReloadLimitUs, qPrintable(QString("重新加载 %1 us").arg(stats.elapsedUs)));
+    QCOMPARE(profile.entries().size(), Entries);
+}
+
+void TestHotkeyProfile::editFormat()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QStringList shortcuts;
+    for (int i = 0; i < Entries; ++i)
+        shortcuts.append(shortcutAt(i));
+    const QString path = dir.filePath("profile.json");
+    QVERIFY(writeProfile(path, shortcuts, TimestampFormatter::DefaultPattern));
+
+    HotkeyProfile profile(path);
+    QVERIFY(reload(profile).elapsedUs >= 0);
+
+    // 只改格式: 原地更新, 不调用系统注册
+    QVERIFY(writeProfile(path, shortcuts, "yyyy-MM-dd"));
+    const HotkeyProfile::ReloadStats stats = reload(profile);
+    QVERIFY(stats.elapsedUs >= 0);
+    QCOMPARE(stats.changed, 1);
+    QCOMPARE(stats.unchanged, Entries - 1);
+    QCOMPARE(stats.registerCalls, quint64(0));
+    QCOMPARE(stats.unregisterCalls, quint64(0));
+    QVERIFY2(stats.elapsedUs < ReloadLimitUs, qPrintable(QString("重新加载 %1 us").arg(stats.elapsedUs)));
+}
+
+void TestHotkeyProfile::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestHotkeyProfile)
+
+#include "tst_hotkeyprofile.moc"
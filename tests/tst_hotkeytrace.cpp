@@ -0,0 +1,128 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <qhotkey.h>
+#include "clocksource.h"
+#include "hotkeytrace.h"
+#include "testregistry.h"
+
+/**
+ * 热键事件记录的文件读写与无头重放
+ */
+class TestHotkeyTrace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void saveAndLoad();
+    void loadRejectsGarbage();
+    void replay_data();
+    void replay();
+    void cleanupTestCase();
+
+private:
+    // 每 1 ms 一条, 每 10 条中 1 条为两个热键之一的按下
+    static HotkeyTrace synthetic(int count);
+};
+
+void TestHotkeyTrace::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+HotkeyTrace TestHotkeyTrace::synthetic(int count)
+{
+    HotkeyTrace trace;
+    for (int i = 0; i < count; ++i) {
+        HotkeyTrace::Event event;
+        event.timeNs = 1000000000ll + i * 1000000ll;
+        if (i % 10 == 9) {
+            event.kind = HotkeyTrace::Press;
+            event.key = i % 20 == 9 ? 0x41 : 0x42;
+            event.modifiers = 0x2;
+            event.message = 0x0312;
+        } else {
+            event.message = 0x0200;
+        }
+        trace.events.append(event);
+    }
+    return trace;
+}
+
+void TestHotkeyTrace::saveAndLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const HotkeyTrace trace = synthetic(100);
+    QString error;
+    QVERIFY2(trace.save(dir.filePath("trace.hktr"), &error), qPrintable(error));
+
+    HotkeyTrace loaded;
+    QVERIFY2(loaded.load(dir.filePath("trace.hktr"), &error), qPrintable(error));
+    QCOMPARE(loaded.events.size(), trace.events.size());
+    for (int i = 0; i < trace.events.size(); ++i) {
+        QCOMPARE(loaded.events.at(i).timeNs, trace.events.at(i).timeNs);
+        QCOMPARE(loaded.events.at(i).kind, trace.events.at(i).kind);
+        QCOMPARE(loaded.events.at(i).key, trace.events.at(i).key);
+        QCOMPARE(loaded.events.at(i).modifiers, trace.events.at(i).modifiers);
+        QCOMPARE(loaded.events.at(i).message, trace.events.at(i).message);
+    }
+}
+
+void TestHotkeyTrace::loadRejectsGarbage()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("garbage.hktr"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("HKTR but not really a trace");
+    file.close();
+
+    HotkeyTrace trace;
+    QString error;
+    QVERIFY(!trace.load(file.fileName(), &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestHotkeyTrace::replay_data()
+{
+    QTest::addColumn<double>("speed");
+    QTest::newRow("no wait") << 0.0;
+    QTest::newRow("10x") << 10.0;
+}
+
+void TestHotkeyTrace::replay()
+{
+    QFETCH(double, speed);
+    const HotkeyTrace trace = synthetic(1000);
+    HotkeyTrace::ReplayOptions options;
+    options.speed = speed;
+
+    const HotkeyTrace::ReplayStats stats = trace.replay(options);
+    QCOMPARE(stats.events, qint64(1000));
+    QCOMPARE(stats.presses, qint64(100));
+    QCOMPARE(stats.delivered, qint64(100));
+    QCOMPARE(stats.dropped, qint64(0));
+    QVERIFY(stats.latencyP50Ns <= stats.latencyP99Ns);
+    QVERIFY(stats.latencyP99Ns <= stats.latencyMaxNs);
+    // 10 倍速: 约 1 秒的记录约需 100 ms 投递完
+    if (speed > 0)
+        QVERIFY(stats.elapsedNs >= 99000000ll);
+
+    // 输入只取决于记录与 speed, 再次重放的计数相同
+    const HotkeyTrace::ReplayStats again = trace.replay(options);
+    QCOMPARE(again.presses, stats.presses);
+    QCOMPARE(again.delivered, stats.delivered);
+}
+
+void TestHotkeyTrace::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestHotkeyTrace)
+
+#include "tst_hotkeytrace.moc"
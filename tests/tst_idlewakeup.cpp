@@ -0,0 +1,114 @@
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimer>
+#include <qhotkey.h>
+#include "clocksource.h"
+#include "hotkeyprofile.h"
+#include "idlemanager.h"
+#include "pastesequence.h"
+#include "stamphistory.h"
+#include "stampsinks.h"
+#include "testregistry.h"
+#include "timestampformatter.h"
+#include "traynotifier.h"
+#include "wakeupmonitor.h"
+
+/**
+ * 空闲时没有周期性唤醒: 按程序中的方式装配热键配置、监听线程、历史、输出与通知,
+ * 生成一个时间戳并等空闲计时到期后, 统计一段空闲时间内 GUI 线程的定时器触发与
+ * 监听线程的唤醒, 均应为 0.
+ *
+ * 空闲时长默认 3 秒, 可由环境变量 TIMESTAMPHOTKEY_IDLE_SECS 加长.
+ */
+class TestIdleWakeup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void idleAfterStamp();
+    void cleanupTestCase();
+};
+
+void TestIdleWakeup::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+void TestIdleWakeup::idleAfterStamp()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    WakeupMonitor monitor;
+    monitor.watchThread(QHotkey::listenerThread(), "hotkey");
+
+    const QString profilePath = dir.filePath("profile.json");
+    QVERIFY(HotkeyProfile::writeDefault(profilePath));
+    HotkeyProfile profile(profilePath);
+    profile.reload();
+    QVERIFY(!profile.entries().isEmpty());
+
+    StampHistory history(dir.filePath("history"));
+    QString error;
+    QVERIFY2(history.open(&error), qPrintable(error));
+
+    IdleManager idleManager(1000);
+    QSignalSpy idleSpy(&idleManager, &IdleManager::idle);
+
+    PasteSequence pasteSequence;
+    TrayNotifier notifier([](const QString &, const QString &) {});
+    notifier.setBusy([&pasteSequence]() { return pasteSequence.isRunning(); });
+    connect(&pasteSequence, &PasteSequence::finished, &notifier, &TrayNotifier::resume, Qt::QueuedConnection);
+
+    StampPipeline pipeline;
+    const QJsonArray sinks{QJsonObject{{"type", "file"}, {"path", dir.filePath("stamps.txt")}}};
+    QVERIFY2(pipeline.configure(sinks, &pasteSequence, &error), qPrintable(error));
+
+    // 一次按键: 经监听线程送达, 然后写入剪贴板、文件、历史并显示通知
+    QHotkey::postNativeEvent({0x7b, 0x7});
+    const qint64 pressNs = ClockSource::current()->nowNs();
+    const QString timestamp = TimestampFormatter().format(pressNs, 0);
+    idleManager.touch();
+    pipeline.publish(timestamp, pressNs, false);
+    notifier.addStamp(timestamp);
+    history.append(pressNs, TimestampFormatter::DefaultPattern, "Ctrl+`");
+    history.flush();
+
+    QTRY_COMPARE_WITH_TIMEOUT(notifier.stats().shown, quint64(1), 5000);
+    QTRY_VERIFY_WITH_TIMEOUT(!pasteSequence.isRunning(), 5000);
+    QTRY_COMPARE_WITH_TIMEOUT(idleSpy.count(), 1, 5000);
+
+    const int seconds = qEnvironmentVariableIsSet("TIMESTAMPHOTKEY_IDLE_SECS")
+                            ? qMax(1, qEnvironmentVariableIntValue("TIMESTAMPHOTKEY_IDLE_SECS"))
+                            : 3;
+    const WakeupMonitor::Snapshot start = monitor.snapshot();
+    QEventLoop loop;
+    QTimer done;
+    done.setObjectName("idleCheck");
+    done.setSingleShot(true);
+    connect(&done, &QTimer::timeout, &loop, &QEventLoop::quit);
+    done.start(seconds * 1000);
+    loop.exec();
+
+    WakeupMonitor::Snapshot delta = WakeupMonitor::difference(monitor.snapshot(), start);
+    delta.timerFires.remove("idleCheck");
+    qInfo("%d 秒空闲:\n%s", seconds, qPrintable(WakeupMonitor::format(delta)));
+    QCOMPARE(delta.totalTimerFires(), quint64(0));
+    QCOMPARE(delta.wakeups.value("hotkey"), quint64(0));
+}
+
+void TestIdleWakeup::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestIdleWakeup)
+
+#include "tst_idlewakeup.moc"
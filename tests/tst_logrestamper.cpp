@@ -0,0 +1,171 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimeZone>
+#include "logrestamper.h"
+#include "testregistry.h"
+
+class TestLogRestamper : public QObject
+{
+    Q_OBJECT
+
+    static constexpr int Repeat = 4000;
+
+private slots:
+    void parseOffset_data();
+    void parseOffset();
+    void convert_data();
+    void convert();
+    void zoneConvert_data();
+    void zoneConvert();
+    void invalidFormat();
+};
+
+void TestLogRestamper::parseOffset_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<bool>("ok");
+    QTest::addColumn<int>("offset");
+
+    QTest::newRow("Z") << "Z" << true << 0;
+    QTest::newRow("+08:00") << "+08:00" << true << 8 * 3600;
+    QTest::newRow("-0530") << "-0530" << true << -(5 * 3600 + 1800);
+    QTest::newRow("+09") << "+09" << true << 9 * 3600;
+    QTest::newRow("seconds") << "3600" << true << 3600;
+    QTest::newRow("minutes 60") << "+08:60" << false << 0;
+    QTest::newRow("garbage") << "abc" << false << 0;
+}
+
+void TestLogRestamper::parseOffset()
+{
+    QFETCH(QString, text);
+    QFETCH(bool, ok);
+    QFETCH(int, offset);
+
+    int parsed = 0;
+    QCOMPARE(LogRestamper::parseOffset(text, parsed), ok);
+    if (ok)
+        QCOMPARE(parsed, offset);
+}
+
+void TestLogRestamper::convert_data()
+{
+    QTest::addColumn<QString>("format");
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<QByteArray>("expected");
+
+    const QByteArray lines[] = {"a 2025-11-19T07:30:45.789+00:00 b\n", "2024-02-29T15:59:59.000+00:00\n",
+                                "month 20251319-153045789, digits 120251119-153045789\n"};
+    QTest::newRow("iso") << "iso" << 1 << lines[0] + lines[1] + lines[2];
+    QTest::newRow("iso, 4 threads") << "iso" << 4 << lines[0] + lines[1] + lines[2];
+    QTest::newRow("epoch-ms") << "epoch-ms" << 1
+                              << QByteArray("a 1763537445789 b\n1709222399000\n") + lines[2];
+    QTest::newRow("pattern") << "yyyy/MM/dd HH:mm" << 1 << QByteArray("a 2025/11/19 07:30 b\n2024/02/29 15:59\n") + lines[2];
+}
+
+void TestLogRestamper::convert()
+{
+    QFETCH(QString, format);
+    QFETCH(int, threads);
+    QFETCH(QByteArray, expected);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile input(dir.filePath("in.log"));
+    QVERIFY(input.open(QIODevice::WriteOnly));
+    // 输入按 +08:00, 不合法的月份与前面多一位数字的不转换.
+    // 重复到超过几个最小块(64 KB), 多线程时切成多块并按原顺序写出
+    const QByteArray lines("a 20251119-153045789 b\n20240229-235959000\n"
+                           "month 20251319-153045789, digits 120251119-153045789\n");
+    input.write(lines.repeated(Repeat));
+    input.close();
+
+    LogRestamper::Options options;
+    options.inputPath = input.fileName();
+    options.outputPath = dir.filePath("out.log");
+    options.outputFormat = format;
+    options.inputOffsetSecs = 8 * 3600;
+    options.outputOffsetSecs = 0;
+    options.threads = threads;
+    options.chunkBytes = 64 * 1024;
+    LogRestamper::Stats stats;
+    QString error;
+    QVERIFY2(LogRestamper(options).run(&stats, &error), qPrintable(error));
+    QCOMPARE(stats.stamps, qint64(2) * Repeat);
+
+    QFile output(options.outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QCOMPARE(output.readAll(), expected.repeated(Repeat));
+}
+
+void TestLogRestamper::zoneConvert_data()
+{
+    QTest::addColumn<QByteArray>("inputZone");
+    QTest::addColumn<QByteArray>("outputZone");
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<QByteArray>("expected");
+
+    // 柏林 2025-03-30 01:00Z 由 +01:00 切到 +02:00, 2025-10-26 01:00Z 切回;
+    // 回拨时重复的 02:00-03:00 按标准时间理解
+    QTest::newRow("spring, input") << QByteArray("Europe/Berlin") << QByteArray()
+                                   << QByteArray("20250330-015959000\n20250330-030000000\n")
+                                   << QByteArray("2025-03-30T00:59:59.000+00:00\n2025-03-30T01:00:00.000+00:00\n");
+    QTest::newRow("autumn, input") << QByteArray("Europe/Berlin") << QByteArray()
+                                   << QByteArray("20251026-015959000\n20251026-023000000\n20251026-030000000\n")
+                                   << QByteArray("2025-10-25T23:59:59.000+00:00\n2025-10-26T01:30:00.000+00:00\n"
+                                                 "2025-10-26T02:00:00.000+00:00\n");
+    QTest::newRow("spring, output") << QByteArray() << QByteArray("Europe/Berlin")
+                                    << QByteArray("20250330-005959000\n20250330-010000000\n")
+                                    << QByteArray("2025-03-30T01:59:59.000+01:00\n2025-03-30T03:00:00.000+02:00\n");
+    QTest::newRow("both") << QByteArray("Europe/Berlin") << QByteArray("America/New_York")
+                          << QByteArray("20250115-120000000\n20250715-120000000\n")
+                          << QByteArray("2025-01-15T06:00:00.000-05:00\n2025-07-15T06:00:00.000-04:00\n");
+}
+
+void TestLogRestamper::zoneConvert()
+{
+    QFETCH(QByteArray, inputZone);
+    QFETCH(QByteArray, outputZone);
+    QFETCH(QByteArray, input);
+    QFETCH(QByteArray, expected);
+
+    for (const QByteArray &id : {inputZone, outputZone}) {
+        if (!id.isEmpty() && !QTimeZone::isTimeZoneIdAvailable(id))
+            QSKIP(qPrintable("时区不可用: " + QString::fromLatin1(id)));
+    }
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QFile file(dir.filePath("in.log"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(input);
+    file.close();
+
+    LogRestamper::Options options;
+    options.inputPath = file.fileName();
+    options.outputPath = dir.filePath("out.log");
+    options.outputFormat = "iso";
+    if (!inputZone.isEmpty())
+        options.inputZone = QTimeZone(inputZone);
+    if (!outputZone.isEmpty())
+        options.outputZone = QTimeZone(outputZone);
+    QString error;
+    QVERIFY2(LogRestamper(options).run(nullptr, &error), qPrintable(error));
+
+    QFile output(options.outputPath);
+    QVERIFY(output.open(QIODevice::ReadOnly));
+    QCOMPARE(output.readAll(), expected);
+}
+
+void TestLogRestamper::invalidFormat()
+{
+    LogRestamper::Options options;
+    options.outputFormat = "dddd HH:mm";
+    QString error;
+    QVERIFY(!LogRestamper(options).run(nullptr, &error));
+    QVERIFY(error.contains("dddd"));
+}
+
+REGISTER_TEST(TestLogRestamper)
+
+#include "tst_logrestamper.moc"
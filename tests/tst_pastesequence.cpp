@@ -0,0 +1,285 @@
+#include <QClipboard>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QJsonArray>
+#include <QMimeData>
+#include <QSignalSpy>
+#include <QTest>
+#include <QTimer>
+#include <functional>
+#include <qhotkey.h>
+#include "actionmacro.h"
+#include "clipboardsnapshot.h"
+#include "clocksource.h"
+#include "pastesequence.h"
+#include "testregistry.h"
+
+#ifdef Q_OS_WIN
+#include <qt_windows.h>
+#endif
+
+/**
+ * 粘贴序列的剪贴板握手: 就绪时剪贴板里一定是这次写入的内容; 被其他程序抢先改写时
+ * 判为 stale 并结束宏, 不会走到后面的等待松开与组合键.
+ *
+ * 等待松开: 热键按住若干毫秒后松开, 按住短于超时的, 门控在松开之后很快打开; 长于超时的
+ * 放弃发送. 无头模式下按住与松开由 QHotkey::postNativeHold/postNativeRelease 经监听线程
+ * 送入; Windows 上另用 keybd_event 按住物理的 Ctrl 再检查一次.
+ *
+ * 恢复剪贴板: 宏结束时放回原有内容; 就绪之后剪贴板被其他程序改写的, 不覆盖新内容.
+ * 快照同组的文本/图片格式只取一个, 放回后各格式仍可读出
+ */
+class TestPasteSequence : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void readyMatchesWritten();
+    void staleClipboardStopsMacro();
+    void releaseGate_data();
+    void releaseGate();
+    void physicalModifier_data();
+    void physicalModifier();
+    void restoreOriginal();
+    void restoreSkippedAfterForeignWrite();
+    void snapshotFormats();
+    void cleanupTestCase();
+
+private:
+    static ActionMacro macro(const QStringList &steps);
+    // 执行只有一步 "release" 的宏, press 后按住 holdMs 再 release; 检查门控打开的时刻
+    static void checkGate(int holdMs, const std::function<void()> &press, const std::function<void()> &release);
+
+    const QHotkey::NativeShortcut m_hotkey{0xc0, 0x2};
+};
+
+void TestPasteSequence::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+}
+
+ActionMacro TestPasteSequence::macro(const QStringList &steps)
+{
+    ActionMacro result;
+    QString error;
+    if (!ActionMacro::parse(QJsonArray::fromStringList(steps), result, &error))
+        qWarning("%s", qPrintable(error));
+    return result;
+}
+
+void TestPasteSequence::readyMatchesWritten()
+{
+    PasteSequence sequence;
+    QString expected;
+    int mismatched = 0;
+    connect(&sequence, &PasteSequence::clipboardReady, this, [&](qint64, bool, bool stale) {
+        // 就绪时读回的内容即随后 Ctrl+V 会粘贴的内容
+        if (stale || QGuiApplication::clipboard()->text() != expected)
+            ++mismatched;
+    });
+    QSignalSpy finished(&sequence, &PasteSequence::finished);
+
+    const int runs = 50;
+    for (int i = 0; i < runs; ++i) {
+        expected = QString("stamp #%1").arg(i);
+        sequence.run(expected, false);
+        QTRY_COMPARE(finished.count(), i + 1);
+    }
+    const PasteSequence::Stats stats = sequence.stats();
+    QCOMPARE(mismatched, 0);
+    QCOMPARE(stats.stale, quint64(0));
+    QCOMPARE(stats.confirmed + stats.timedOut, quint64(runs));
+}
+
+void TestPasteSequence::staleClipboardStopsMacro()
+{
+    // 先于 PasteSequence 连接: 时间戳一写入就被"其他程序"改写, 序列收到的确认信号读回的已是别的内容
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    bool armed = false;
+    QObject interferer;
+    connect(clipboard, &QClipboard::dataChanged, &interferer, [&]() {
+        if (!armed)
+            return;
+        armed = false;
+        clipboard->setText("written by another program");
+    });
+
+    PasteSequence sequence;
+    QSignalSpy ready(&sequence, &PasteSequence::clipboardReady);
+    QSignalSpy finished(&sequence, &PasteSequence::finished);
+
+    armed = true;
+    sequence.runMacro("20251119-153045789", macro({"clipboard", "ready 50", "release 10", "inject Ctrl+V"}));
+    QTRY_COMPARE(finished.count(), 1);
+
+    QCOMPARE(ready.count(), 1);
+    QCOMPARE(ready.at(0).at(1).toBool(), false);
+    QCOMPARE(ready.at(0).at(2).toBool(), true);
+    const PasteSequence::Stats stats = sequence.stats();
+    QCOMPARE(stats.stale, quint64(1));
+    QCOMPARE(stats.confirmed, quint64(0));
+    // 宏在 ready 处结束, 没有等待松开(也就不会发送 Ctrl+V)
+    QCOMPARE(stats.releaseWaits, quint64(0));
+    QCOMPARE(clipboard->text(), QString("written by another program"));
+}
+
+void TestPasteSequence::checkGate(int holdMs, const std::function<void()> &press, const std::function<void()> &release)
+{
+    const int timeoutMs = ActionMacro::DefaultReleaseTimeoutMs;
+    ActionMacro gate;
+    ActionMacro::Step step;
+    step.kind = ActionMacro::Release;
+    step.ms = timeoutMs;
+    gate.steps.append(step);
+
+    PasteSequence sequence;
+    QElapsedTimer timer;
+    qint64 gateNs = -1;
+    qint64 releasedNs = -1;
+    connect(&sequence, &PasteSequence::finished, &sequence, [&]() { gateNs = timer.nsecsElapsed(); });
+
+    timer.start();
+    if (holdMs > 0) {
+        press();
+        QTRY_VERIFY(PasteSequence::modifiersDown());
+        QTimer::singleShot(holdMs, &sequence, [&]() {
+            release();
+            releasedNs = timer.nsecsElapsed();
+        });
+    } else {
+        releasedNs = 0;
+    }
+    sequence.runMacro(QString(), gate);
+    QTRY_VERIFY(gateNs >= 0 && releasedNs >= 0);
+    QTRY_VERIFY(!PasteSequence::modifiersDown());
+
+    const PasteSequence::Stats stats = sequence.stats();
+    QCOMPARE(stats.releaseWaits, quint64(1));
+    if (holdMs >= timeoutMs) {
+        QCOMPARE(stats.releaseTimedOut, quint64(1));
+        return;
+    }
+    QCOMPARE(stats.releaseTimedOut, quint64(0));
+    // 门控在松开后打开, 延迟不超过两个轮询间隔加调度余量
+    const qint64 afterReleaseNs = gateNs - releasedNs;
+    QVERIFY2(afterReleaseNs >= 0, qPrintable(QString::number(afterReleaseNs)));
+    QVERIFY2(afterReleaseNs < 30000000, qPrintable(QString::number(afterReleaseNs)));
+}
+
+void TestPasteSequence::releaseGate_data()
+{
+    QTest::addColumn<int>("holdMs");
+    QTest::newRow("not held") << 0;
+    QTest::newRow("20 ms") << 20;
+    QTest::newRow("60 ms") << 60;
+    QTest::newRow("150 ms") << 150;
+    QTest::newRow("300 ms") << 300;
+    QTest::newRow("beyond timeout") << ActionMacro::DefaultReleaseTimeoutMs + 200;
+}
+
+void TestPasteSequence::releaseGate()
+{
+    QFETCH(int, holdMs);
+    QHotkey hotkey(m_hotkey, true);
+    QVERIFY(hotkey.isRegistered());
+    checkGate(holdMs, [this]() { QHotkey::postNativeHold(m_hotkey); },
+              [this]() { QHotkey::postNativeRelease(m_hotkey); });
+}
+
+void TestPasteSequence::physicalModifier_data()
+{
+    releaseGate_data();
+}
+
+void TestPasteSequence::physicalModifier()
+{
+#ifdef Q_OS_WIN
+    QFETCH(int, holdMs);
+    checkGate(
+        holdMs,
+        []() { keybd_event(VK_CONTROL, 0, 0, 0); },
+        []() { keybd_event(VK_CONTROL, 0, KEYEVENTF_KEYUP, 0); });
+#else
+    QSKIP("按住物理按键需要 keybd_event, 仅 Windows");
+#endif
+}
+
+void TestPasteSequence::restoreOriginal()
+{
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setText("original");
+
+    PasteSequence sequence;
+    sequence.setRestoreClipboard(true);
+    QSignalSpy finished(&sequence, &PasteSequence::finished);
+    sequence.runMacro("20251119-153045789", macro({"clipboard", "ready 200", "delay 20"}));
+    QTRY_COMPARE(finished.count(), 1);
+
+    QCOMPARE(clipboard->text(), QString("original"));
+    QCOMPARE(sequence.stats().restored, quint64(1));
+    QCOMPARE(sequence.stats().snapshotsDropped, quint64(0));
+}
+
+void TestPasteSequence::restoreSkippedAfterForeignWrite()
+{
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setText("original");
+
+    PasteSequence sequence;
+    sequence.setRestoreClipboard(true);
+    QSignalSpy finished(&sequence, &PasteSequence::finished);
+    // 就绪之后、放回之前, "其他程序"写入新内容
+    connect(&sequence, &PasteSequence::clipboardReady, &sequence, [clipboard]() {
+        QTimer::singleShot(5, clipboard, [clipboard]() { clipboard->setText("written by another program"); });
+    });
+    sequence.runMacro("20251119-153045789", macro({"clipboard", "ready 200", "delay 50"}));
+    QTRY_COMPARE(finished.count(), 1);
+
+    QCOMPARE(clipboard->text(), QString("written by another program"));
+    QCOMPARE(sequence.stats().restored, quint64(0));
+    QCOMPARE(sequence.stats().snapshotsDropped, quint64(1));
+}
+
+void TestPasteSequence::snapshotFormats()
+{
+    QImage image(8, 8, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    auto *data = new QMimeData;
+    data->setText("plain");
+    // 与 text/plain 同组, 不再单独保存
+    data->setData("text/plain;charset=utf-8", "plain");
+    data->setHtml("<b>html</b>");
+    data->setData("application/x-timestamphotkey-test", "raw");
+    data->setImageData(image);
+    QClipboard *clipboard = QGuiApplication::clipboard();
+    clipboard->setMimeData(data);
+
+    ClipboardSnapshot snapshot;
+    QVERIFY(snapshot.capture());
+#ifndef Q_OS_WIN
+    QCOMPARE(snapshot.formatCount(), 4);
+#endif
+
+    clipboard->setText("20251119-153045789");
+    QVERIFY(snapshot.restore());
+    QVERIFY(snapshot.isEmpty());
+    const QMimeData *restored = clipboard->mimeData();
+    QVERIFY(restored);
+    QCOMPARE(restored->text(), QString("plain"));
+    QCOMPARE(restored->html(), QString("<b>html</b>"));
+    QCOMPARE(restored->data("application/x-timestamphotkey-test"), QByteArray("raw"));
+    QCOMPARE(qvariant_cast<QImage>(restored->imageData()).size(), image.size());
+}
+
+void TestPasteSequence::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestPasteSequence)
+
+#include "tst_pastesequence.moc"
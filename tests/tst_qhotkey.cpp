@@ -0,0 +1,237 @@
+#include <QScopedPointer>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+#include <atomic>
+#include <qhotkey.h>
+#include "clocksource.h"
+#include "testregistry.h"
+
+namespace {
+
+/**
+ * 在 GUI 线程记录 activated 的时间戳. 信号在监听线程发出, 与程序中的接收方一样经队列送达
+ */
+class Activations
+{
+public:
+    explicit Activations(QHotkey *hotkey)
+    {
+        QObject::connect(hotkey, &QHotkey::activated, &m_context, [this](qint64 timestampNs) {
+            m_stamps.append(timestampNs);
+        });
+    }
+
+    int count() const { return m_stamps.size(); }
+    qint64 at(int i) const { return m_stamps.at(i); }
+
+private:
+    QObject m_context;
+    QVector<qint64> m_stamps;
+};
+
+} // namespace
+
+/**
+ * 热键注册表: 无头模式下不调用系统注册, 按键由 postNativeEvent 经监听线程的事件队列送入,
+ * 与真实的原生消息走同一条分发路径
+ */
+class TestQHotkey : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void registerAndActivate();
+    void sharedShortcut();
+    void unregistered();
+    void changeShortcut();
+    void keySequence();
+    void headlessCountsSkippedCalls();
+    void guiThreadBlocked();
+    void stopAndRestart();
+    void cleanupTestCase();
+
+private:
+    // 送入 shortcut 后再送入一个标记; 同一队列按顺序分发, 标记到达时 shortcut 已处理完
+    void postAndFlush(QHotkey::NativeShortcut shortcut);
+
+    const QHotkey::NativeShortcut m_first{0x41, 0x2};
+    const QHotkey::NativeShortcut m_second{0x42, 0x2};
+    const QHotkey::NativeShortcut m_marker{0x7b, 0x7};
+};
+
+void TestQHotkey::initTestCase()
+{
+    QHotkey::setHeadless(true);
+    QHotkey::setTimestampClock([]() { return ClockSource::current()->nowNs(); });
+    QVERIFY(QHotkey::startListenerThread());
+    QVERIFY(QHotkey::listenerThread());
+}
+
+void TestQHotkey::postAndFlush(QHotkey::NativeShortcut shortcut)
+{
+    QHotkey marker(m_marker, true);
+    Activations markerActivations(&marker);
+    QHotkey::postNativeEvent(shortcut);
+    QHotkey::postNativeEvent(m_marker);
+    QTRY_COMPARE(markerActivations.count(), 1);
+}
+
+void TestQHotkey::registerAndActivate()
+{
+    QHotkey hotkey;
+    QSignalSpy registeredSpy(&hotkey, &QHotkey::registeredChanged);
+    QVERIFY(hotkey.setNativeShortcut(m_first, true));
+    QVERIFY(hotkey.isRegistered());
+    QCOMPARE(registeredSpy.count(), 1);
+
+    Activations activations(&hotkey);
+    const qint64 beforeNs = ClockSource::current()->nowNs();
+    QHotkey::postNativeEvent(m_first);
+    QTRY_COMPARE(activations.count(), 1);
+    // 时间戳在监听线程分发时记录
+    const qint64 stampNs = activations.at(0);
+    QVERIFY(stampNs >= beforeNs);
+    QVERIFY(stampNs <= ClockSource::current()->nowNs());
+}
+
+void TestQHotkey::sharedShortcut()
+{
+    QHotkey a(m_first, true);
+    QHotkey b(m_first, true);
+    Activations activationsA(&a);
+    Activations activationsB(&b);
+
+    postAndFlush(m_first);
+    QCOMPARE(activationsA.count(), 1);
+    QCOMPARE(activationsB.count(), 1);
+
+    // 注销其中一个, 另一个仍然有效
+    QVERIFY(a.setRegistered(false));
+    QVERIFY(!a.isRegistered());
+    postAndFlush(m_first);
+    QCOMPARE(activationsA.count(), 1);
+    QCOMPARE(activationsB.count(), 2);
+}
+
+void TestQHotkey::unregistered()
+{
+    QHotkey hotkey(m_first, false);
+    QVERIFY(!hotkey.isRegistered());
+    Activations activations(&hotkey);
+
+    postAndFlush(m_first);
+    postAndFlush(m_second);
+    QCOMPARE(activations.count(), 0);
+
+    // 无效的快捷键只计入收到的事件
+    const QHotkey::FilterStats before = QHotkey::nativeFilterStats();
+    postAndFlush(QHotkey::NativeShortcut());
+    const QHotkey::FilterStats after = QHotkey::nativeFilterStats();
+    QCOMPARE(after.eventsSeen - before.eventsSeen, quint64(2));
+    QCOMPARE(after.eventsAccepted - before.eventsAccepted, quint64(1));
+}
+
+void TestQHotkey::changeShortcut()
+{
+    QHotkey hotkey(m_first, true);
+    Activations activations(&hotkey);
+    QVERIFY(hotkey.setNativeShortcut(m_second, true));
+    QVERIFY(hotkey.isRegistered());
+    QCOMPARE(hotkey.currentNativeShortcut(), m_second);
+
+    postAndFlush(m_first);
+    QCOMPARE(activations.count(), 0);
+    postAndFlush(m_second);
+    QCOMPARE(activations.count(), 1);
+
+    // 未开启自动注册时, 已注册的热键不能改
+    QVERIFY(!hotkey.setNativeShortcut(m_first, false));
+    QCOMPARE(hotkey.currentNativeShortcut(), m_second);
+}
+
+void TestQHotkey::keySequence()
+{
+    QHotkey hotkey(QKeySequence(QStringLiteral("Ctrl+`")), true);
+    QVERIFY(hotkey.isRegistered());
+    QCOMPARE(hotkey.keyCode(), Qt::Key_QuoteLeft);
+    QCOMPARE(hotkey.modifiers(), Qt::KeyboardModifiers(Qt::ControlModifier));
+    QVERIFY(hotkey.currentNativeShortcut().isValid());
+
+    Activations activations(&hotkey);
+    postAndFlush(hotkey.currentNativeShortcut());
+    QCOMPARE(activations.count(), 1);
+
+    QVERIFY(hotkey.resetShortcut());
+    QVERIFY(!hotkey.isRegistered());
+    QCOMPARE(hotkey.shortcut(), QKeySequence());
+}
+
+void TestQHotkey::headlessCountsSkippedCalls()
+{
+    // 无头模式不调用系统注册, 但照常计数应有的调用, 供差量重新加载的测试核对;
+    // 共用同一快捷键的第二个热键不产生调用
+    const QPair<quint64, quint64> before = QHotkey::nativeCallCounts();
+    {
+        QHotkey a(m_first, true);
+        QHotkey b(m_second, true);
+        QHotkey c(m_first, true);
+        QVERIFY(a.isRegistered() && b.isRegistered() && c.isRegistered());
+        QCOMPARE(QHotkey::nativeCallCounts().first - before.first, quint64(2));
+        QCOMPARE(QHotkey::nativeCallCounts().second, before.second);
+    }
+    QCOMPARE(QHotkey::nativeCallCounts().first - before.first, quint64(2));
+    QCOMPARE(QHotkey::nativeCallCounts().second - before.second, quint64(2));
+}
+
+void TestQHotkey::guiThreadBlocked()
+{
+    // GUI 线程阻塞 500 ms, 期间另一线程按下热键: 监听线程照常分发, 时间戳仍是按下时刻
+    QHotkey hotkey(m_first, true);
+    Activations activations(&hotkey);
+    std::atomic<qint64> pressedNs{0};
+    QScopedPointer<QThread> presser(QThread::create([this, &pressedNs]() {
+        QThread::msleep(100);
+        pressedNs.store(ClockSource::current()->nowNs());
+        QHotkey::postNativeEvent(m_first);
+    }));
+    presser->start();
+    QThread::msleep(500);
+    const qint64 unblockedNs = ClockSource::current()->nowNs();
+    QVERIFY(presser->wait(5000));
+
+    QTRY_COMPARE(activations.count(), 1);
+    const qint64 lagNs = activations.at(0) - pressedNs.load();
+    QVERIFY2(lagNs >= 0 && lagNs < 20000000, qPrintable(QString("按下到时间戳 %1 us").arg(lagNs / 1000)));
+    QVERIFY(activations.at(0) < unblockedNs - 300000000);
+}
+
+void TestQHotkey::stopAndRestart()
+{
+    QHotkey kept(m_second, true);
+    QHotkey::stopListenerThread();
+    QVERIFY(!QHotkey::listenerThread());
+
+    // 停止后在 GUI 线程中监听, 仍注册着的热键照常触发
+    Activations activations(&kept);
+    postAndFlush(m_second);
+    QCOMPARE(activations.count(), 1);
+
+    // 有已注册的热键时不能再启动
+    QVERIFY(!QHotkey::startListenerThread());
+    QVERIFY(kept.setRegistered(false));
+    QVERIFY(QHotkey::startListenerThread());
+    QVERIFY(kept.setRegistered(true));
+    postAndFlush(m_second);
+    QCOMPARE(activations.count(), 2);
+}
+
+void TestQHotkey::cleanupTestCase()
+{
+    QHotkey::stopListenerThread();
+}
+
+REGISTER_TEST(TestQHotkey)
+
+#include "tst_qhotkey.moc"
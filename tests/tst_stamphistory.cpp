@@ -0,0 +1,185 @@
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+#include "stamphistory.h"
+#include "testregistry.h"
+
+/**
+ * 段文件的读写与损坏处理: 头部、索引与列不一致的段在打开时跳过, 列中截断的 varint
+ * 只让解码提前结束, 不越过列末尾读取
+ */
+class TestStampHistory : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void roundTrip();
+    void reopen();
+    void corruptSegment_data();
+    void corruptSegment();
+    void truncatedVarint();
+
+private:
+    static constexpr qint64 Entries = 3000;
+    static constexpr qint64 BaseNs = 1700000000000000000ll;
+    // SegmentHeader 的大小与 count/indexCount 字段位置, 其后为 formatCount/sourceCount
+    static constexpr int HeaderBytes = 64;
+    static constexpr int CountOffset = 8;
+    static constexpr int IndexCountOffset = 36;
+
+    // 写入 Entries 条(3 个索引块)并封存为一个段, 返回段文件路径
+    QString writeSegment();
+    // 段文件中索引的起始位置(跳过字典)
+    static int indexOffset(const QByteArray &data);
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestStampHistory::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+QString TestStampHistory::writeSegment()
+{
+    StampHistory history(m_dir->path());
+    if (!history.open())
+        return QString();
+    for (qint64 i = 0; i < Entries; ++i)
+        history.append(BaseNs + i * 1000000, i % 2 ? "yyyy" : "HH:mm", i % 3 ? "Ctrl+`" : "Ctrl+Shift+`");
+    history.compact();
+    history.waitForCompaction();
+    const QStringList segments = QDir(m_dir->path()).entryList({"seg-*.tss"}, QDir::Files);
+    return segments.size() == 1 ? QDir(m_dir->path()).filePath(segments.first()) : QString();
+}
+
+int TestStampHistory::indexOffset(const QByteArray &data)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const quint32 strings = qFromLittleEndian<quint32>(p + 40) + qFromLittleEndian<quint32>(p + 44);
+    int offset = HeaderBytes;
+    for (quint32 i = 0; i < strings; ++i)
+        offset += 2 + qFromLittleEndian<quint16>(p + offset);
+    return offset;
+}
+
+void TestStampHistory::roundTrip()
+{
+    const QString path = writeSegment();
+    QVERIFY(!path.isEmpty());
+
+    StampHistory::SegmentReader reader(path, 64);
+    QString error;
+    QVERIFY2(reader.open(&error), qPrintable(error));
+    QCOMPARE(reader.count(), Entries);
+    QCOMPARE(reader.minNs(), BaseNs);
+    QCOMPARE(reader.maxNs(), BaseNs + (Entries - 1) * 1000000);
+
+    qint64 timeNs;
+    quint32 format, source;
+    for (qint64 i = 0; i < Entries; ++i) {
+        QVERIFY(reader.next(timeNs, format, source));
+        QCOMPARE(timeNs, BaseNs + i * 1000000);
+        QCOMPARE(reader.formats().at(int(format)), QString(i % 2 ? "yyyy" : "HH:mm"));
+        QCOMPARE(reader.sources().at(int(source)), QString(i % 3 ? "Ctrl+`" : "Ctrl+Shift+`"));
+    }
+    QVERIFY(!reader.next(timeNs, format, source));
+}
+
+void TestStampHistory::reopen()
+{
+    QVERIFY(!writeSegment().isEmpty());
+    StampHistory history(m_dir->path());
+    QVERIFY(history.open());
+    QCOMPARE(history.stats().segments, qint64(1));
+
+    // 跨块边界的区间
+    QVector<qint64> times;
+    const qint64 visited = history.query(BaseNs + 1000 * 1000000ll, BaseNs + 2100 * 1000000ll,
+                                         [&times](qint64 timeNs, const QString &, const QString &) {
+                                             times.append(timeNs);
+                                         });
+    QCOMPARE(visited, qint64(1100));
+    QCOMPARE(times.first(), BaseNs + 1000 * 1000000ll);
+    QCOMPARE(times.last(), BaseNs + 2099 * 1000000ll);
+    QCOMPARE(history.count(BaseNs, BaseNs + Entries * 1000000), Entries);
+}
+
+void TestStampHistory::corruptSegment_data()
+{
+    QTest::addColumn<QString>("field");
+    QTest::newRow("count") << "count";
+    QTest::newRow("index count") << "indexCount";
+    QTest::newRow("format offset") << "formatOffset";
+    QTest::newRow("time offset") << "timeOffset";
+}
+
+void TestStampHistory::corruptSegment()
+{
+    QFETCH(QString, field);
+    const QString path = writeSegment();
+    QVERIFY(!path.isEmpty());
+
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    uchar *p = reinterpret_cast<uchar *>(data.data());
+    // 第二个索引项: timeNs(8) timeOffset(4) formatOffset(4) sourceOffset(4) reserved(4)
+    uchar *entry = p + indexOffset(data) + 24;
+    if (field == "count")
+        qToLittleEndian<qint64>(Entries + StampHistory::IndexStride, p + CountOffset);
+    else if (field == "indexCount")
+        qToLittleEndian<quint32>(2, p + IndexCountOffset);
+    else if (field == "formatOffset")
+        qToLittleEndian<quint32>(0xffffffffu, entry + 12);
+    else
+        qToLittleEndian<quint32>(0x7fffffffu, entry + 8);
+    QVERIFY(file.seek(0));
+    QCOMPARE(file.write(data), qint64(data.size()));
+    file.close();
+
+    StampHistory::SegmentReader reader(path);
+    QVERIFY(field.endsWith("Offset") || !reader.open());
+
+    // 损坏的段被跳过, 不参与查询
+    StampHistory history(m_dir->path());
+    QVERIFY(history.open());
+    QCOMPARE(history.stats().segments, qint64(0));
+    QCOMPARE(history.query(BaseNs, BaseNs + Entries * 1000000, nullptr), qint64(0));
+}
+
+void TestStampHistory::truncatedVarint()
+{
+    const QString path = writeSegment();
+    QVERIFY(!path.isEmpty());
+
+    // 来源列的最后一个字节带上续位: 最后一个 varint 延伸到列(文件)末尾之外
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.seek(file.size() - 1));
+    QCOMPARE(file.write("\x80", 1), qint64(1));
+    file.close();
+
+    StampHistory::SegmentReader reader(path, 64);
+    QVERIFY(reader.open());
+    qint64 timeNs;
+    quint32 format, source;
+    qint64 read = 0;
+    while (reader.next(timeNs, format, source))
+        ++read;
+    QCOMPARE(read, Entries - 1);
+
+    StampHistory history(m_dir->path());
+    QVERIFY(history.open());
+    QCOMPARE(history.stats().segments, qint64(1));
+    QCOMPARE(history.query(BaseNs, BaseNs + Entries * 1000000, nullptr), Entries - 1);
+}
+
+REGISTER_TEST(TestStampHistory)
+
+#include "tst_stamphistory.moc"
@@ -0,0 +1,176 @@
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTest>
+#include "stamphistory.h"
+#include "testregistry.h"
+
+/**
+ * 计数汇总与逐条扫描一致: 随机区间、各小时桶, 以及重新打开读入 rollup.idx 之后;
+ * 只读打开看到全部记录, 但不改动目录中的任何文件
+ */
+class TestStampRollup : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void matchesScan();
+    void readOnlyOpen();
+    void readOnlyMissingDirectory();
+
+private:
+    static constexpr qint64 BaseNs = 1700000000000000000ll;
+
+    // 比较 count 与 scanCount(随机区间)以及小时桶与全量扫描, 返回不一致数
+    static int mismatches(const StampHistory &history, qint64 startNs, qint64 endNs);
+    // 目录中各文件的内容
+    QHash<QString, QByteArray> snapshot(const QString &directory) const;
+
+    QScopedPointer<QTemporaryDir> m_dir;
+};
+
+void TestStampRollup::init()
+{
+    m_dir.reset(new QTemporaryDir);
+    QVERIFY(m_dir->isValid());
+}
+
+int TestStampRollup::mismatches(const StampHistory &history, qint64 startNs, qint64 endNs)
+{
+    const qint64 hourNs = StampRollup::widthNs(StampRollup::Hour);
+    const qint64 dayNs = StampRollup::widthNs(StampRollup::Day);
+    int mismatches = 0;
+
+    QHash<qint64, qint64> scannedHours;
+    history.query(startNs, endNs, [&scannedHours, hourNs](qint64 timeNs, const QString &, const QString &) {
+        ++scannedHours[timeNs / hourNs];
+    });
+    const QVector<StampRollup::Bucket> hours = history.rollup(StampRollup::Hour, startNs, endNs);
+    if (hours.size() != scannedHours.size())
+        ++mismatches;
+    for (const StampRollup::Bucket &bucket : hours) {
+        if (scannedHours.value(bucket.startNs / hourNs) != bucket.count)
+            ++mismatches;
+    }
+
+    quint64 random = 2463534242ull;
+    for (int i = 0; i < 200; ++i) {
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        const qint64 fromNs = startNs + qint64(random % quint64(endNs - startNs));
+        const qint64 toNs = fromNs + qint64((random >> 16) % quint64(3 * dayNs));
+        if (history.count(fromNs, toNs) != history.scanCount(fromNs, toNs))
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+QHash<QString, QByteArray> TestStampRollup::snapshot(const QString &directory) const
+{
+    QHash<QString, QByteArray> files;
+    const QDir dir(directory);
+    for (const QString &name : dir.entryList(QDir::Files)) {
+        QFile file(dir.filePath(name));
+        if (file.open(QIODevice::ReadOnly))
+            files.insert(name, file.readAll());
+    }
+    return files;
+}
+
+void TestStampRollup::matchesScan()
+{
+    // 7 天, 平均每 3 秒一条, 分成多个段
+    const qint64 spanNs = 7 * StampRollup::widthNs(StampRollup::Day);
+    qint64 endNs = BaseNs;
+    qint64 entries = 0;
+    {
+        StampHistory history(m_dir->path());
+        QVERIFY(history.open());
+        history.setSealThreshold(50000);
+        quint64 random = 88172645463325252ull;
+        for (qint64 timeNs = BaseNs; timeNs < BaseNs + spanNs; ++entries) {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            timeNs += 1000000 + qint64(random % 6000000000ull);
+            history.append(timeNs, "HH:mm", "Ctrl+`");
+            endNs = timeNs + 1;
+        }
+        history.waitForCompaction();
+        QCOMPARE(history.count(BaseNs, endNs), entries);
+        QCOMPARE(mismatches(history, BaseNs, endNs), 0);
+        history.compact();
+        history.waitForCompaction();
+    }
+
+    StampHistory history(m_dir->path());
+    QVERIFY(history.open());
+    QVERIFY(history.stats().segments > 1);
+    QCOMPARE(history.count(BaseNs, endNs), entries);
+    QCOMPARE(mismatches(history, BaseNs, endNs), 0);
+}
+
+void TestStampRollup::readOnlyOpen()
+{
+    // seg-0.tss, 未封存完的 sealing-1.log 与 active.log
+    const QString directory = m_dir->filePath("history");
+    {
+        StampHistory history(directory);
+        QVERIFY(history.open());
+        for (int i = 0; i < 100; ++i)
+            history.append(BaseNs + i * 1000000000ll, "HH:mm", "Ctrl+`");
+        history.compact();
+        history.waitForCompaction();
+        for (int i = 0; i < 20; ++i)
+            history.append(BaseNs + (200 + i) * 1000000000ll, "HH:mm", "Ctrl+`");
+    }
+    QVERIFY(QFile::rename(QDir(directory).filePath("active.log"), QDir(directory).filePath("sealing-1.log")));
+    {
+        StampHistory other(m_dir->filePath("other"));
+        QVERIFY(other.open());
+        for (int i = 0; i < 7; ++i)
+            other.append(BaseNs + (300 + i) * 1000000000ll, "HH:mm", "Ctrl+`");
+    }
+    QVERIFY(QFile::copy(m_dir->filePath("other/active.log"), QDir(directory).filePath("active.log")));
+
+    const QHash<QString, QByteArray> before = snapshot(directory);
+    QVERIFY(before.contains("rollup.idx"));
+    {
+        StampHistory history(directory);
+        QString error;
+        QVERIFY2(history.openReadOnly(&error), qPrintable(error));
+        const qint64 endNs = BaseNs + 400 * 1000000000ll;
+        QCOMPARE(history.count(BaseNs, endNs), qint64(127));
+        QCOMPARE(history.scanCount(BaseNs, endNs), qint64(127));
+        QCOMPARE(mismatches(history, BaseNs, endNs), 0);
+
+        history.append(endNs, "HH:mm", "Ctrl+`");
+        history.compact();
+        history.waitForCompaction();
+        QCOMPARE(history.stats().entries, qint64(127));
+    }
+    QCOMPARE(snapshot(directory), before);
+
+    // 可写打开才重新封存
+    StampHistory history(directory);
+    QVERIFY(history.open());
+    QVERIFY(QFile::exists(QDir(directory).filePath("seg-1.tss")));
+    QCOMPARE(history.count(BaseNs, BaseNs + 400 * 1000000000ll), qint64(127));
+}
+
+void TestStampRollup::readOnlyMissingDirectory()
+{
+    const QString directory = m_dir->filePath("missing");
+    StampHistory history(directory);
+    QVERIFY(history.openReadOnly());
+    QCOMPARE(history.stats().entries, qint64(0));
+    QVERIFY(!QDir(directory).exists());
+}
+
+REGISTER_TEST(TestStampRollup)
+
+#include "tst_stamprollup.moc"
@@ -0,0 +1,138 @@
+#include <QElapsedTimer>
+#include <QSemaphore>
+#include <QTemporaryDir>
+#include <QTest>
+#include "stampsinks.h"
+#include "testregistry.h"
+
+namespace {
+
+/**
+ * 写入时先通知 entered, 再等 release 放行; 析构时置 destroyed
+ */
+class GateSink : public StampSink
+{
+public:
+    GateSink(QSemaphore *entered, QSemaphore *release, bool *destroyed) :
+        StampSink(QStringLiteral("gate")),
+        m_entered(entered),
+        m_release(release),
+        m_destroyed(destroyed)
+    {
+    }
+    ~GateSink() override { *m_destroyed = true; }
+
+    bool write(const QVector<Stamp> &batch) override
+    {
+        m_entered->release();
+        m_release->acquire();
+        m_written += batch.size();
+        return true;
+    }
+
+private:
+    QSemaphore *m_entered;
+    QSemaphore *m_release;
+    bool *m_destroyed;
+    int m_written = 0;
+};
+
+} // namespace
+
+/**
+ * 输出管线: 重新配置不在 GUI 线程中等待旧的输出线程; drain() 之后发布给异步输出的时间戳计为丢弃
+ */
+class TestStampSinks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fileSink();
+    void clearDoesNotWait();
+    void publishAfterDrain();
+    void queueOverflow();
+};
+
+void TestStampSinks::fileSink()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("out/stamps.log");
+    {
+        StampPipeline pipeline;
+        pipeline.addSink(new FileSink(path));
+        pipeline.publish("20251119-153045789", 0, false);
+        pipeline.publish("20251119-153045790", 0, false);
+        pipeline.drain();
+        QCOMPARE(pipeline.sinks().first()->counters().written, quint64(2));
+    }
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("20251119-153045789\n20251119-153045790\n"));
+}
+
+void TestStampSinks::clearDoesNotWait()
+{
+    QSemaphore entered;
+    QSemaphore release;
+    bool destroyed = false;
+    StampPipeline pipeline;
+    pipeline.addSink(new GateSink(&entered, &release, &destroyed));
+    pipeline.publish("a", 0, false);
+    pipeline.publish("b", 0, false);
+    QVERIFY(entered.tryAcquire(1, 5000));
+
+    // 输出线程阻塞在一次写入中, clear() 仍立即返回
+    QElapsedTimer timer;
+    timer.start();
+    pipeline.clear();
+    QVERIFY2(timer.elapsed() < 100, qPrintable(QString::number(timer.elapsed())));
+    QVERIFY(pipeline.sinks().isEmpty());
+    QVERIFY(!destroyed);
+
+    // 放行后写完队列中剩下的时间戳, 线程结束, sink 随之删除
+    release.release(2);
+    QTRY_VERIFY(destroyed);
+}
+
+void TestStampSinks::publishAfterDrain()
+{
+    QSemaphore entered;
+    QSemaphore release(100);
+    bool destroyed = false;
+    StampPipeline pipeline;
+    pipeline.addSink(new GateSink(&entered, &release, &destroyed));
+    pipeline.publish("a", 0, false);
+    pipeline.publish("b", 0, false);
+    pipeline.drain();
+
+    for (int i = 0; i < 3; ++i)
+        pipeline.publish("late", 0, false);
+    const StampSink::Counters counters = pipeline.sinks().first()->counters();
+    QCOMPARE(counters.written, quint64(2));
+    QCOMPARE(counters.dropped, quint64(3));
+}
+
+void TestStampSinks::queueOverflow()
+{
+    QSemaphore entered;
+    QSemaphore release;
+    bool destroyed = false;
+    StampPipeline pipeline;
+    pipeline.addSink(new GateSink(&entered, &release, &destroyed), 4);
+    pipeline.publish("first", 0, false);
+    QVERIFY(entered.tryAcquire(1, 5000));
+
+    // 第一条正在写入, 队列容量 4, 其余丢弃
+    for (int i = 0; i < 10; ++i)
+        pipeline.publish("queued", 0, false);
+    release.release(100);
+    pipeline.drain();
+    const StampSink::Counters counters = pipeline.sinks().first()->counters();
+    QCOMPARE(counters.written, quint64(5));
+    QCOMPARE(counters.dropped, quint64(6));
+}
+
+REGISTER_TEST(TestStampSinks)
+
+#include "tst_stampsinks.moc"
@@ -0,0 +1,132 @@
+#include <QDateTime>
+#include <QTest>
+#include "testregistry.h"
+#include "timestampformatter.h"
+
+namespace {
+
+// 2025-11-19T15:30:45.789123456Z
+constexpr qint64 kSampleNs = 1763566245LL * 1000000000LL + 789123456;
+
+} // namespace
+
+class TestTimestampFormatter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void format_data();
+    void format();
+    void matchesQDateTime_data();
+    void matchesQDateTime();
+    void maxLength();
+    void formatUtf8();
+    void unsupported_data();
+    void unsupported();
+};
+
+void TestTimestampFormatter::format_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<qint64>("ns");
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("default") << QString(TimestampFormatter::DefaultPattern) << kSampleNs << 0 << "20251119-153045789";
+    QTest::newRow("micro/nano") << "yyyyMMdd-HHmmsszzzuuunnn" << kSampleNs << 0 << "20251119-153045789123456";
+    QTest::newRow("iso +08:00") << QString(TimestampFormatter::IsoPattern) << kSampleNs << 8 * 3600
+                                << "2025-11-19T23:30:45.789+08:00";
+    QTest::newRow("offset -05:30") << "HH:mm tt" << kSampleNs << -(5 * 3600 + 1800) << "10:00 -0530";
+    QTest::newRow("day rollover") << "yyyy-MM-dd HH" << kSampleNs << 9 * 3600 << "2025-11-20 00";
+    QTest::newRow("short fields") << "yy M d H m s" << 946663507LL * 1000000000LL << 0 << "99 12 31 18 5 7";
+    QTest::newRow("before epoch") << "yyyy-MM-dd HH:mm:ss.zzz" << -1000000LL << 0 << "1969-12-31 23:59:59.999";
+    QTest::newRow("leap day") << "yyyy-MM-dd" << 1709251199LL * 1000000000LL << 0 << "2024-02-29";
+    QTest::newRow("quoted") << "'at' HH'h' ''mm''" << kSampleNs << 0 << "at 15h '30'";
+    QTest::newRow("unicode literal") << "yyyy年MM月dd日" << kSampleNs << 0 << "2025年11月19日";
+}
+
+void TestTimestampFormatter::format()
+{
+    QFETCH(QString, pattern);
+    QFETCH(qint64, ns);
+    QFETCH(int, offset);
+    QFETCH(QString, expected);
+
+    QCOMPARE(TimestampFormatter(pattern).format(ns, offset), expected);
+}
+
+void TestTimestampFormatter::matchesQDateTime_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<qint64>("ms");
+    QTest::addColumn<int>("offset");
+
+    const QString patterns[] = {"yyyy-MM-dd HH:mm:ss.zzz", "yyMMdd H:m:s", "d/M/yyyy hh:mm", "'T'HH'h'mm"};
+    const qint64 instants[] = {0, 946684800000LL, 1709251199999LL, 1763566245789LL, 4102444799999LL};
+    const int offsets[] = {0, 8 * 3600, -(3 * 3600 + 1800), 14 * 3600};
+    for (const QString &pattern : patterns) {
+        for (qint64 ms : instants) {
+            for (int offset : offsets)
+                QTest::addRow("%s @%lld %+d", qPrintable(pattern), ms, offset) << pattern << ms << offset;
+        }
+    }
+}
+
+void TestTimestampFormatter::matchesQDateTime()
+{
+    QFETCH(QString, pattern);
+    QFETCH(qint64, ms);
+    QFETCH(int, offset);
+
+    const QString expected = QDateTime::fromMSecsSinceEpoch(ms).toOffsetFromUtc(offset).toString(pattern);
+    QCOMPARE(TimestampFormatter(pattern).format(ms * 1000000, offset), expected);
+}
+
+void TestTimestampFormatter::maxLength()
+{
+    const TimestampFormatter formatter("yyyy-MM-dd'T'HH:mm:ss.zzzuuunnnttt '时间'");
+    // 含纳秒时间能表示的范围两端(约 1678 与 2262 年)
+    for (qint64 ns : {qint64(0), kSampleNs, qint64(-9000000000000000000LL), qint64(9000000000000000000LL)}) {
+        const QByteArray utf8 = formatter.formatUtf8(ns, -12 * 3600);
+        QVERIFY2(utf8.size() <= formatter.maxLength(), utf8.constData());
+    }
+}
+
+void TestTimestampFormatter::formatUtf8()
+{
+    const TimestampFormatter formatter("yyyy年MM月dd日 HH:mm:ss.zzzuuunnn");
+    QCOMPARE(QString::fromUtf8(formatter.formatUtf8(kSampleNs, 0)), formatter.format(kSampleNs, 0));
+}
+
+void TestTimestampFormatter::unsupported_data()
+{
+    QTest::addColumn<QString>("pattern");
+    QTest::addColumn<bool>("valid");
+
+    QTest::newRow("weekday") << "ddd yyyy-MM-dd" << false;
+    QTest::newRow("long weekday") << "dddd" << false;
+    QTest::newRow("month name") << "d MMM yyyy" << false;
+    QTest::newRow("long month name") << "MMMM" << false;
+    QTest::newRow("z") << "ss.z" << false;
+    QTest::newRow("zz") << "ss.zz" << false;
+    QTest::newRow("AP") << "hh:mm AP" << false;
+    QTest::newRow("ap") << "h:mm ap" << false;
+    QTest::newRow("quoted") << "'ddd MMM z AP' HH" << true;
+    QTest::newRow("single A/a") << "A a HH" << true;
+    QTest::newRow("24h h") << "h:mm" << true;
+    QTest::newRow("zzz") << "ss.zzzuuunnn" << true;
+}
+
+void TestTimestampFormatter::unsupported()
+{
+    QFETCH(QString, pattern);
+    QFETCH(bool, valid);
+
+    const TimestampFormatter formatter(pattern);
+    QCOMPARE(formatter.isValid(), valid);
+    QCOMPARE(formatter.errorString().isEmpty(), valid);
+}
+
+REGISTER_TEST(TestTimestampFormatter)
+
+#include "tst_timestampformatter.moc"
@@ -0,0 +1,137 @@
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QPixmap>
+#include <QSignalSpy>
+#include <QSystemTrayIcon>
+#include <QTest>
+#include "actionmacro.h"
+#include "pastesequence.h"
+#include "testregistry.h"
+#include "traynotifier.h"
+
+/**
+ * 时间戳通知: 与程序一样经 TrayNotifier::trayPresenter 在托盘图标上显示(offscreen 平台
+ * 没有系统托盘, showMessage 不显示任何东西, 但调用路径相同). 连按合并为一个气泡;
+ * 粘贴序列进行中不显示, 结束后由 resume() 补上; 成组按下时每次显示都落在两次粘贴之间,
+ * 按下到剪贴板就绪不受通知影响
+ */
+class TestTrayNotifier : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void coalesce();
+    void deferWhilePasting();
+    void showsBetweenPastes();
+
+private:
+    struct Shown {
+        QString message;
+        bool duringPaste;
+    };
+
+    // 记下每次显示后交给托盘图标
+    TrayNotifier::Presenter recording(const PasteSequence *sequence);
+
+    QSystemTrayIcon m_icon;
+    QVector<Shown> m_shown;
+};
+
+void TestTrayNotifier::initTestCase()
+{
+    QPixmap pixmap(16, 16);
+    pixmap.fill(Qt::darkCyan);
+    m_icon.setIcon(QIcon(pixmap));
+    m_icon.show();
+}
+
+TrayNotifier::Presenter TestTrayNotifier::recording(const PasteSequence *sequence)
+{
+    m_shown.clear();
+    const TrayNotifier::Presenter show = TrayNotifier::trayPresenter(&m_icon);
+    return [this, sequence, show](const QString &title, const QString &message) {
+        m_shown.append({message, sequence && sequence->isRunning()});
+        show(title, message);
+    };
+}
+
+void TestTrayNotifier::coalesce()
+{
+    TrayNotifier notifier(recording(nullptr));
+    for (int i = 0; i < 5; ++i)
+        notifier.addStamp(QString("20251119-15304%1000").arg(i));
+    QTRY_COMPARE_WITH_TIMEOUT(m_shown.size(), 1, 2000);
+    QCOMPARE(m_shown.at(0).message, TrayNotifier::message(5, "20251119-153044000"));
+
+    // 与上一个气泡至少间隔 MinIntervalMs
+    QElapsedTimer timer;
+    timer.start();
+    notifier.addStamp("20251119-153050000");
+    QTRY_COMPARE_WITH_TIMEOUT(m_shown.size(), 2, 3000);
+    QVERIFY2(timer.elapsed() >= TrayNotifier::MinIntervalMs - 300, qPrintable(QString("%1 ms 后即显示").arg(timer.elapsed())));
+    QCOMPARE(notifier.stats().stamps, quint64(6));
+    QCOMPARE(notifier.stats().shown, quint64(2));
+}
+
+void TestTrayNotifier::deferWhilePasting()
+{
+    PasteSequence sequence;
+    TrayNotifier notifier(recording(&sequence));
+    notifier.setBusy([&sequence]() { return sequence.isRunning(); });
+    connect(&sequence, &PasteSequence::finished, &notifier, &TrayNotifier::resume, Qt::QueuedConnection);
+    QSignalSpy finished(&sequence, &PasteSequence::finished);
+
+    ActionMacro macro;
+    QString error;
+    QVERIFY2(ActionMacro::parse(QJsonArray::fromStringList({"clipboard", "ready", "delay 800"}), macro, &error), qPrintable(error));
+    notifier.addStamp("20251119-153045789");
+    sequence.runMacro("20251119-153045789", macro);
+
+    // 合并窗口早已过去, 序列仍在进行
+    QTest::qWait(TrayNotifier::CoalesceMs + 200);
+    QVERIFY(sequence.isRunning());
+    QCOMPARE(m_shown.size(), 0);
+
+    QTRY_COMPARE_WITH_TIMEOUT(finished.count(), 1, 3000);
+    QTRY_COMPARE(m_shown.size(), 1);
+    QVERIFY(!m_shown.at(0).duringPaste);
+}
+
+void TestTrayNotifier::showsBetweenPastes()
+{
+    PasteSequence sequence;
+    TrayNotifier notifier(recording(&sequence));
+    notifier.setBusy([&sequence]() { return sequence.isRunning(); });
+    connect(&sequence, &PasteSequence::finished, &notifier, &TrayNotifier::resume, Qt::QueuedConnection);
+
+    QElapsedTimer clock;
+    qint64 maxReadyNs = 0;
+    connect(&sequence, &PasteSequence::clipboardReady, this, [&](qint64, bool, bool) {
+        maxReadyNs = qMax(maxReadyNs, clock.nsecsElapsed());
+    });
+
+    // 3 组, 每组 5 次, 组内间隔 30 ms; 组间留出合并窗口与最小间隔
+    const int groups = 3;
+    for (int group = 0; group < groups; ++group) {
+        for (int i = 0; i < 5; ++i) {
+            const QString text = QString("notify #%1.%2").arg(group).arg(i);
+            clock.start();
+            notifier.addStamp(text);
+            sequence.run(text, false);
+            QTest::qWait(30);
+        }
+        QTRY_COMPARE_WITH_TIMEOUT(m_shown.size(), group + 1, TrayNotifier::MinIntervalMs + 2000);
+        QTest::qWait(TrayNotifier::MinIntervalMs);
+    }
+
+    for (const Shown &shown : std::as_const(m_shown))
+        QVERIFY(!shown.duringPaste);
+    QCOMPARE(m_shown.last().message, TrayNotifier::message(5, "notify #2.4"));
+    QVERIFY2(maxReadyNs < 30000000, qPrintable(QString("按下到就绪最长 %1 ms").arg(maxReadyNs / 1000000.0)));
+    qInfo("托盘气泡显示最长 %.2f ms", notifier.stats().maxShowNs / 1000000.0);
+}
+
+REGISTER_TEST(TestTrayNotifier)
+
+#include "tst_traynotifier.moc"
@@ -0,0 +1,333 @@
+#include "timestampformatter.h"
+
+#include <QDateTime>
+#include <cstring>
+
+namespace {
+
+inline qint64 floorDiv(qint64 a, qint64 b)
+{
+    qint64 q = a / b;
+    if ((a % b != 0) && ((a < 0) != (b < 0)))
+        --q;
+    return q;
+}
+
+/**
+ * 由自 1970-01-01 起的天数求公历年月日 (Howard Hinnant 的 civil_from_days)
+ */
+inline void civilFromDays(qint64 days, int &year, int &month, int &day)
+{
+    days += 719468;
+    const qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    year = static_cast<int>(yoe + era * 400 + (month <= 2 ? 1 : 0));
+}
+
+inline char *put2(char *p, int v)
+{
+    p[0] = static_cast<char>('0' + v / 10);
+    p[1] = static_cast<char>('0' + v % 10);
+    return p + 2;
+}
+
+inline char *put3(char *p, int v)
+{
+    p[0] = static_cast<char>('0' + v / 100);
+    p[1] = static_cast<char>('0' + (v / 10) % 10);
+    p[2] = static_cast<char>('0' + v % 10);
+    return p + 3;
+}
+
+inline char *put1or2(char *p, int v)
+{
+    if (v >= 10)
+        return put2(p, v);
+    *p = static_cast<char>('0' + v);
+    return p + 1;
+}
+
+inline char *put4(char *p, int v)
+{
+    if (v < 0 || v > 9999) {
+        // 超出 4 位的年份按实际位数输出
+        char buf[12];
+        int n = 0;
+        unsigned u = v < 0 ? static_cast<unsigned>(-v) : static_cast<unsigned>(v);
+        do {
+            buf[n++] = static_cast<char>('0' + u % 10);
+            u /= 10;
+        } while (u);
+        if (v < 0)
+            *p++ = '-';
+        while (n)
+            *p++ = buf[--n];
+        return p;
+    }
+    p = put2(p, v / 100);
+    return put2(p, v % 100);
+}
+
+} // namespace
+
+TimestampFormatter::TimestampFormatter(const QString &pattern) :
+    m_pattern(pattern)
+{
+    compile();
+}
+
+void TimestampFormatter::reject(const QString &token, const QString &reason)
+{
+    if (m_error.isEmpty())
+        m_error = QString("不支持的格式 \"%1\": %2").arg(token, reason);
+}
+
+void TimestampFormatter::compile()
+{
+    m_tokens.clear();
+    m_literals.clear();
+    m_error.clear();
+    m_maxLength = 0;
+
+    auto addLiteral = [this](const QString &text) {
+        if (text.isEmpty())
+            return;
+        const QByteArray utf8 = text.toUtf8();
+        if (!m_tokens.isEmpty() && m_tokens.last().kind == Literal) {
+            m_tokens.last().length += utf8.size();
+        } else {
+            m_tokens.append({Literal, static_cast<int>(m_literals.size()), static_cast<int>(utf8.size())});
+        }
+        m_literals.append(utf8);
+        m_maxLength += utf8.size();
+    };
+    auto addField = [this](TokenKind kind, int width) {
+        m_tokens.append({kind, 0, 0});
+        m_maxLength += width;
+    };
+
+    const int n = m_pattern.size();
+    int i = 0;
+    while (i < n) {
+        const QChar c = m_pattern.at(i);
+
+        if (c == QLatin1Char('\'')) {
+            // 引号内为原样文本, '' 表示单引号
+            if (i + 1 < n && m_pattern.at(i + 1) == QLatin1Char('\'')) {
+                addLiteral(QStringLiteral("'"));
+                i += 2;
+                continue;
+            }
+            QString text;
+            ++i;
+            while (i < n) {
+                if (m_pattern.at(i) == QLatin1Char('\'')) {
+                    if (i + 1 < n && m_pattern.at(i + 1) == QLatin1Char('\'')) {
+                        text += QLatin1Char('\'');
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    break;
+                }
+                text += m_pattern.at(i++);
+            }
+            addLiteral(text);
+            continue;
+        }
+
+        int run = 1;
+        while (i + run < n && m_pattern.at(i + run) == c)
+            ++run;
+
+        switch (c.unicode()) {
+        case 'y':
+            if (run >= 4) {
+                addField(Year4, 11);
+                run = 4;
+            } else if (run >= 2) {
+                addField(Year2, 2);
+                run = 2;
+            } else {
+                addLiteral(QString(c));
+            }
+            break;
+        case 'M':
+        case 'd':
+            if (run >= 3)
+                reject(m_pattern.mid(i, run), c == QLatin1Char('M') ? QStringLiteral("月份名") : QStringLiteral("星期名"));
+            Q_FALLTHROUGH();
+        case 'H':
+        case 'h':
+        case 'm':
+        case 's': {
+            static const struct { char ch; TokenKind two; TokenKind one; } table[] = {
+                {'M', Month2, Month1},   {'d', Day2, Day1},       {'H', Hour2, Hour1},
+                {'h', Hour2, Hour1},     {'m', Minute2, Minute1}, {'s', Second2, Second1},
+            };
+            for (const auto &entry : table) {
+                if (entry.ch == c.unicode()) {
+                    addField(run >= 2 ? entry.two : entry.one, 2);
+                    break;
+                }
+            }
+            run = qMin(run, 2);
+            break;
+        }
+        case 't':
+            // 与 Qt 6.5 一致: tt -> +HHmm, ttt -> +HH:mm; 单个 t 原样输出
+            if (run >= 3) {
+                addField(OffsetColon, 6);
+                run = 3;
+            } else if (run == 2) {
+                addField(Offset, 5);
+            } else {
+                addLiteral(QString(c));
+            }
+            break;
+        case 'z':
+        case 'u':
+        case 'n':
+            if (run >= 3) {
+                addField(c == QLatin1Char('z') ? Milli3 : (c == QLatin1Char('u') ? Micro3 : Nano3), 3);
+                run = 3;
+            } else {
+                if (c == QLatin1Char('z'))
+                    reject(m_pattern.mid(i, run), QStringLiteral("毫秒请写作 zzz"));
+                addLiteral(m_pattern.mid(i, run));
+            }
+            break;
+        case 'A':
+        case 'a':
+            // QDateTime 的 AP/ap 为上午/下午, 单独的 A/a 原样输出
+            if (i + 1 < n && m_pattern.at(i + 1) == QLatin1Char(c == QLatin1Char('A') ? 'P' : 'p')) {
+                reject(m_pattern.mid(i, 2), QStringLiteral("没有 12 小时制, h/hh 为 24 小时制"));
+                addLiteral(m_pattern.mid(i, 2));
+                run = 2;
+            } else {
+                addLiteral(QString(c));
+                run = 1;
+            }
+            break;
+        default:
+            addLiteral(QString(c));
+            run = 1;
+            break;
+        }
+        i += run;
+    }
+}
+
+int TimestampFormatter::formatTo(char *out, qint64 nsSinceEpoch, int utcOffsetSecs) const
+{
+    const qint64 local = nsSinceEpoch + static_cast<qint64>(utcOffsetSecs) * 1000000000LL;
+    const qint64 secs = floorDiv(local, 1000000000LL);
+    const int subNs = static_cast<int>(local - secs * 1000000000LL);
+    const qint64 days = floorDiv(secs, 86400);
+    const int secOfDay = static_cast<int>(secs - days * 86400);
+
+    int year = 1970, month = 1, day = 1;
+    civilFromDays(days, year, month, day);
+    const int hour = secOfDay / 3600;
+    const int minute = (secOfDay / 60) % 60;
+    const int second = secOfDay % 60;
+
+    char *p = out;
+    for (const Token &token : m_tokens) {
+        switch (token.kind) {
+        case Literal:
+            std::memcpy(p, m_literals.constData() + token.offset, static_cast<size_t>(token.length));
+            p += token.length;
+            break;
+        case Year4:
+            p = put4(p, year);
+            break;
+        case Year2:
+            p = put2(p, ((year % 100) + 100) % 100);
+            break;
+        case Month2:
+            p = put2(p, month);
+            break;
+        case Month1:
+            p = put1or2(p, month);
+            break;
+        case Day2:
+            p = put2(p, day);
+            break;
+        case Day1:
+            p = put1or2(p, day);
+            break;
+        case Hour2:
+            p = put2(p, hour);
+            break;
+        case Hour1:
+            p = put1or2(p, hour);
+            break;
+        case Minute2:
+            p = put2(p, minute);
+            break;
+        case Minute1:
+            p = put1or2(p, minute);
+            break;
+        case Second2:
+            p = put2(p, second);
+            break;
+        case Second1:
+            p = put1or2(p, second);
+            break;
+        case Milli3:
+            p = put3(p, subNs / 1000000);
+            break;
+        case Micro3:
+            p = put3(p, (subNs / 1000) % 1000);
+            break;
+        case Nano3:
+            p = put3(p, subNs % 1000);
+            break;
+        case Offset:
+        case OffsetColon: {
+            const int absOffset = utcOffsetSecs < 0 ? -utcOffsetSecs : utcOffsetSecs;
+            *p++ = utcOffsetSecs < 0 ? '-' : '+';
+            p = put2(p, absOffset / 3600);
+            if (token.kind == OffsetColon)
+                *p++ = ':';
+            p = put2(p, (absOffset / 60) % 60);
+            break;
+        }
+        }
+    }
+    return static_cast<int>(p - out);
+}
+
+QByteArray TimestampFormatter::formatUtf8(qint64 nsSinceEpoch, int utcOffsetSecs) const
+{
+    QByteArray result(m_maxLength, Qt::Uninitialized);
+    result.truncate(formatTo(result.data(), nsSinceEpoch, utcOffsetSecs));
+    return result;
+}
+
+QString TimestampFormatter::format(qint64 nsSinceEpoch, int utcOffsetSecs) const
+{
+    char stackBuffer[128];
+    if (m_maxLength <= static_cast<int>(sizeof(stackBuffer))) {
+        const int length = formatTo(stackBuffer, nsSinceEpoch, utcOffsetSecs);
+        return QString::fromUtf8(stackBuffer, length);
+    }
+    return QString::fromUtf8(formatUtf8(nsSinceEpoch, utcOffsetSecs));
+}
+
+QString TimestampFormatter::formatLocal(qint64 nsSinceEpoch) const
+{
+    return format(nsSinceEpoch, localUtcOffset(nsSinceEpoch));
+}
+
+int TimestampFormatter::localUtcOffset(qint64 nsSinceEpoch)
+{
+    const qint64 msecs = nsSinceEpoch / 1000000;
+    return QDateTime::fromMSecsSinceEpoch(msecs).offsetFromUtc();
+}
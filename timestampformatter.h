@@ -0,0 +1,95 @@
+#ifndef TIMESTAMPFORMATTER_H
+#define TIMESTAMPFORMATTER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * 时间戳格式化器
+ *
+ * 格式串在构造时编译为 token 列表, 之后每次格式化只做整数拆分和写缓冲,
+ * 不经过 QDateTime. 输入为纳秒精度的 Unix 时间加 UTC 偏移.
+ *
+ * 支持的 token (与 QDateTime::toString 保持一致的部分):
+ *   yyyy yy  年         MM M  月        dd d  日
+ *   HH H hh h  时(24h)  mm m  分        ss s  秒
+ *   zzz  毫秒(3位)
+ * 扩展 token:
+ *   uuu  微秒(毫秒内的 3 位)   nnn  纳秒(微秒内的 3 位)
+ *   tt   UTC 偏移 +HHmm         ttt  UTC 偏移 +HH:mm
+ * 例: "yyyyMMdd-HHmmsszzzuuunnn" -> 20251119-153045789123456
+ * 不支持的 token, 出现时 isValid() 为 false, 配置加载时报错:
+ *   ddd dddd  星期名    MMM MMMM  月份名    z zz  不定长毫秒(写 zzz)
+ *   AP ap     上午/下午; 没有 12 小时制, h/hh 与不带 AP 的 QDateTime 一样是 24 小时制
+ * 单引号内为原样文本, '' 表示一个单引号, 其余字符(包括单独的 A/a)原样输出.
+ */
+class TimestampFormatter
+{
+public:
+    static constexpr const char *DefaultPattern = "yyyyMMdd-HHmmsszzz";
+    static constexpr const char *IsoPattern = "yyyy-MM-dd'T'HH:mm:ss.zzzttt";
+
+    explicit TimestampFormatter(const QString &pattern = QString::fromLatin1(DefaultPattern));
+
+    QString pattern() const { return m_pattern; }
+
+    // 格式串含不支持的 token 时为 false, errorString() 指出第一个
+    bool isValid() const { return m_error.isEmpty(); }
+    QString errorString() const { return m_error; }
+
+    // 输出的最大字节数(UTF-8), 用于预先分配缓冲
+    int maxLength() const { return m_maxLength; }
+
+    // 写入 out(至少 maxLength() 字节), 返回实际字节数, 不分配内存
+    int formatTo(char *out, qint64 nsSinceEpoch, int utcOffsetSecs) const;
+
+    QByteArray formatUtf8(qint64 nsSinceEpoch, int utcOffsetSecs) const;
+    QString format(qint64 nsSinceEpoch, int utcOffsetSecs) const;
+
+    // 按本地时区格式化
+    QString formatLocal(qint64 nsSinceEpoch) const;
+
+    // 本地时区在给定时刻的 UTC 偏移(秒)
+    static int localUtcOffset(qint64 nsSinceEpoch);
+
+private:
+    enum TokenKind : quint8 {
+        Literal,
+        Year4,
+        Year2,
+        Month2,
+        Month1,
+        Day2,
+        Day1,
+        Hour2,
+        Hour1,
+        Minute2,
+        Minute1,
+        Second2,
+        Second1,
+        Milli3,
+        Micro3,
+        Nano3,
+        Offset,
+        OffsetColon
+    };
+
+    struct Token {
+        TokenKind kind;
+        int offset; // Literal: 在 m_literals 中的起始位置
+        int length; // Literal: 字节数
+    };
+
+    void compile();
+    void reject(const QString &token, const QString &reason);
+
+    QString m_pattern;
+    QString m_error;
+    QByteArray m_literals;
+    QVector<Token> m_tokens;
+    int m_maxLength = 0;
+};
+
+#endif // TIMESTAMPFORMATTER_H
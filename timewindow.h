@@ -12,6 +12,10 @@
 #include <QTimer>
 #include <QApplication>
 #include <QDebug>
+#include "clocksource.h"
+#include "stamphistory.h"
+#include "timestampformatter.h"
+#include "worldclock.h"
 
 /**
  * 时间显示窗口类
@@ -21,10 +25,14 @@ class TimeWindow : public QWidget
     Q_OBJECT
 
 public:
-    TimeWindow(QWidget *parent = nullptr) : QWidget(parent)
+    TimeWindow(WorldClock *worldClock = nullptr, StampHistory *history = nullptr, QWidget *parent = nullptr)
+        : QWidget(parent)
+        , worldClock(worldClock)
+        , history(history)
+        , friendlyFormatter("yyyy年MM月dd日 HH:mm:ss.zzz")
+        , zoneFormatter("yyyy-MM-dd HH:mm:ss ttt")
     {
         setWindowTitle("格式化时间");
-        setFixedSize(400, 150);
 
         // 创建布局
         QVBoxLayout *mainLayout = new QVBoxLayout(this);
@@ -40,6 +48,19 @@ public:
         timestampEdit->setStyleSheet("font-size: 11pt; padding: 5px;");
         mainLayout->addWidget(timestampEdit);
 
+        // 世界时钟: 每个时区一行
+        zonesLabel = new QLabel(this);
+        zonesLabel->setStyleSheet("font-family: Consolas, monospace; font-size: 10pt;");
+        zonesLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+        zonesLabel->setVisible(worldClock && worldClock->zoneCount() > 0);
+        mainLayout->addWidget(zonesLabel);
+
+        // 时间戳计数: 本小时/今天/近 7 天, 来自历史的计数汇总
+        countsLabel = new QLabel(this);
+        countsLabel->setStyleSheet("font-size: 10pt; color: gray;");
+        countsLabel->setVisible(history != nullptr);
+        mainLayout->addWidget(countsLabel);
+
         // 按钮布局
         QHBoxLayout *buttonLayout = new QHBoxLayout();
 
@@ -49,6 +70,14 @@ public:
         connect(copyButton, &QPushButton::clicked, this, &TimeWindow::copyTimestamp);
         buttonLayout->addWidget(copyButton);
 
+        // 复制世界时间按钮
+        if (zonesLabel->isVisibleTo(this)) {
+            QPushButton *copyZonesButton = new QPushButton("复制世界时间", this);
+            copyZonesButton->setStyleSheet("font-size: 10pt; padding: 8px;");
+            connect(copyZonesButton, &QPushButton::clicked, this, &TimeWindow::copyZones);
+            buttonLayout->addWidget(copyZonesButton);
+        }
+
         // 刷新按钮
         QPushButton *refreshButton = new QPushButton("刷新", this);
         refreshButton->setStyleSheet("font-size: 10pt; padding: 8px;");
@@ -57,23 +86,50 @@ public:
 
         mainLayout->addLayout(buttonLayout);
 
+        // 窗口可见时每秒刷新一次, 隐藏时停止, 空闲时不产生唤醒
+        tickTimer.setObjectName("timeWindowTick");
+        tickTimer.setTimerType(Qt::CoarseTimer);
+        tickTimer.setInterval(1000);
+        connect(&tickTimer, &QTimer::timeout, this, &TimeWindow::updateTime);
+
         // 初始化时间
         updateTime();
+        setFixedSize(400, qMax(150, sizeHint().height()));
     }
 
 public slots:
     // 更新时间显示
     void updateTime()
     {
-        QDateTime now = QDateTime::currentDateTime();
+        const qint64 now = ClockSource::current()->nowNs();
+        const int offset = TimestampFormatter::localUtcOffset(now);
 
         // 友好的时间显示
-        QString friendlyTime = now.toString("yyyy年MM月dd日 HH:mm:ss.zzz");
+        QString friendlyTime = friendlyFormatter.format(now, offset);
         timeLabel->setText("当前时间: " + friendlyTime);
 
         // 时间戳格式
-        currentTimestamp = now.toString("yyyyMMdd-HHmmsszzz");
+        currentTimestamp = stampFormatter.format(now, offset);
         timestampEdit->setText(currentTimestamp);
+
+        // 各时区时间, 偏移取自预先计算的切换表
+        if (zonesLabel->isVisibleTo(this)) {
+            currentZones = worldClock->render(now, zoneFormatter);
+            zonesLabel->setText(currentZones);
+        }
+
+        // 区间两端都是整分钟, 每项只是两次二分查找
+        if (history) {
+            const qint64 hourNs = StampRollup::widthNs(StampRollup::Hour);
+            const qint64 dayNs = StampRollup::widthNs(StampRollup::Day);
+            const qint64 localNs = now + offset * 1000000000ll;
+            const qint64 hourStart = now - localNs % hourNs;
+            const qint64 dayStart = now - localNs % dayNs;
+            countsLabel->setText(QString("时间戳: 本小时 %1 次, 今天 %2 次, 近 7 天 %3 次")
+                                     .arg(history->count(hourStart, hourStart + hourNs))
+                                     .arg(history->count(dayStart, dayStart + dayNs))
+                                     .arg(history->count(dayStart - 6 * dayNs, dayStart + dayNs)));
+        }
     }
 
     // 复制时间戳到剪贴板
@@ -95,17 +151,42 @@ public slots:
         qDebug() << "已复制时间戳:" << currentTimestamp;
     }
 
+    // 复制全部时区的时间到剪贴板
+    void copyZones()
+    {
+        updateTime();
+        QApplication::clipboard()->setText(currentZones);
+        qDebug() << "已复制世界时间:" << currentZones;
+    }
+
     // 显示窗口时刷新时间
     void showEvent(QShowEvent *event) override
     {
         QWidget::showEvent(event);
         updateTime();
+        tickTimer.start();
+    }
+
+    // 隐藏时停止刷新
+    void hideEvent(QHideEvent *event) override
+    {
+        QWidget::hideEvent(event);
+        tickTimer.stop();
     }
 
 private:
     QLabel *timeLabel;
     QLineEdit *timestampEdit;
+    QLabel *zonesLabel;
+    QLabel *countsLabel;
     QString currentTimestamp;
+    QString currentZones;
+    WorldClock *worldClock;
+    StampHistory *history;
+    QTimer tickTimer;
+    TimestampFormatter friendlyFormatter;
+    TimestampFormatter stampFormatter;
+    TimestampFormatter zoneFormatter;
 };
 
 #endif // TIMEWINDOW_H
@@ -0,0 +1,78 @@
+#include "traynotifier.h"
+
+TrayNotifier::TrayNotifier(Presenter presenter, QObject *parent) :
+    QObject(parent),
+    m_presenter(std::move(presenter))
+{
+    m_timer.setObjectName(QStringLiteral("trayNotify"));
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &TrayNotifier::flush);
+}
+
+void TrayNotifier::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    if (!enabled) {
+        m_timer.stop();
+        m_deferred = false;
+        m_pending = 0;
+        m_last.clear();
+    }
+}
+
+void TrayNotifier::addStamp(const QString &timestamp)
+{
+    if (!m_enabled)
+        return;
+    ++m_stats.stamps;
+    if (m_pending++ == 0)
+        m_firstPending.start();
+    m_last = timestamp;
+    m_lastStamp.start();
+    if (m_timer.isActive() || m_deferred)
+        return;
+    // 与上一个气泡保持间隔
+    const qint64 sinceShown = m_sinceShown.isValid() ? m_sinceShown.elapsed() : MinIntervalMs;
+    m_timer.start(int(qMax<qint64>(CoalesceMs, MinIntervalMs - sinceShown)));
+}
+
+void TrayNotifier::resume()
+{
+    if (!m_deferred)
+        return;
+    m_deferred = false;
+    flush();
+}
+
+void TrayNotifier::flush()
+{
+    if (m_pending == 0)
+        return;
+    // 仍在连按: 等停下 CoalesceMs 后再显示, 一直连按时最多等 MaxDelayMs
+    const qint64 quietMs = m_lastStamp.elapsed();
+    if (quietMs < CoalesceMs && m_firstPending.elapsed() < MaxDelayMs) {
+        m_timer.start(int(CoalesceMs - quietMs));
+        return;
+    }
+    if (m_busy && m_busy()) {
+        m_deferred = true;
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    m_presenter(QStringLiteral("时间戳已生成"), message(m_pending, m_last));
+    m_stats.lastShowNs = timer.nsecsElapsed();
+    m_stats.maxShowNs = qMax(m_stats.maxShowNs, m_stats.lastShowNs);
+    ++m_stats.shown;
+    m_pending = 0;
+    m_last.clear();
+    m_sinceShown.start();
+}
+
+QString TrayNotifier::message(int count, const QString &last)
+{
+    if (count == 1)
+        return last;
+    return QString("%1 个时间戳, 最后: %2").arg(count).arg(last);
+}
@@ -0,0 +1,86 @@
+#ifndef TRAYNOTIFIER_H
+#define TRAYNOTIFIER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <functional>
+
+/**
+ * 时间戳通知调度
+ *
+ * 热键处理中只记下时间戳(addStamp 不碰界面), 气泡由定时器在事件循环中稍后显示:
+ * 间隔不到 CoalesceMs 的连续时间戳合并为一个气泡("5 个时间戳, 最后: ..."), 连按停下后
+ * 才显示, 两个气泡至少间隔 MinIntervalMs. 到时若粘贴序列仍在进行(busy 返回 true),
+ * 推迟到 resume() 再显示.
+ *
+ * 气泡在 GUI 线程中显示(QSystemTrayIcon 只能在 GUI 线程使用), 调度只保证它落在按键间隙,
+ * 不在热键处理与粘贴序列之中. 显示本身阻塞时(通知服务无响应), 其间按下的热键要等它返回
+ * 才写入剪贴板; 显示耗时记在 Stats 中.
+ */
+class TrayNotifier : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 实际显示气泡, 在 GUI 线程中调用
+    using Presenter = std::function<void(const QString &title, const QString &message)>;
+
+    static constexpr int CoalesceMs = 250;
+    static constexpr int MinIntervalMs = 1000;
+    // 一直连按时, 第一个未显示的时间戳最多等待的时长
+    static constexpr int MaxDelayMs = 3000;
+    // 气泡的显示时长
+    static constexpr int BubbleMs = 1000;
+
+    struct Stats {
+        quint64 stamps = 0;
+        // 显示的气泡数, 以及显示本身的耗时
+        quint64 shown = 0;
+        qint64 lastShowNs = 0;
+        qint64 maxShowNs = 0;
+    };
+
+    explicit TrayNotifier(Presenter presenter, QObject *parent = nullptr);
+
+    // 关闭时丢弃尚未显示的时间戳
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+    void setBusy(std::function<bool()> busy) { m_busy = std::move(busy); }
+
+    void addStamp(const QString &timestamp);
+    Stats stats() const { return m_stats; }
+
+    static QString message(int count, const QString &last);
+
+    // 以托盘图标(QSystemTrayIcon)显示气泡, 程序与测试共用; 模板使核心库不必链接 Widgets
+    template<typename TrayIcon>
+    static Presenter trayPresenter(TrayIcon *icon)
+    {
+        return [icon](const QString &title, const QString &message) {
+            icon->showMessage(title, message, TrayIcon::Information, BubbleMs);
+        };
+    }
+
+public slots:
+    // 忙碌结束, 显示被推迟的气泡
+    void resume();
+
+private:
+    void flush();
+
+    Presenter m_presenter;
+    std::function<bool()> m_busy;
+    bool m_enabled = true;
+    bool m_deferred = false;
+    int m_pending = 0;
+    QString m_last;
+    QTimer m_timer;
+    QElapsedTimer m_sinceShown;
+    QElapsedTimer m_firstPending;
+    QElapsedTimer m_lastStamp;
+    Stats m_stats;
+};
+
+#endif // TRAYNOTIFIER_H
@@ -0,0 +1,96 @@
+#include "wakeupmonitor.h"
+
+#include <QAbstractEventDispatcher>
+#include <QCoreApplication>
+#include <QEvent>
+#include <QThread>
+
+quint64 WakeupMonitor::Snapshot::totalTimerFires() const
+{
+    quint64 total = 0;
+    for (quint64 count : timerFires)
+        total += count;
+    return total;
+}
+
+WakeupMonitor::WakeupMonitor(QObject *parent) :
+    QObject(parent)
+{
+    // 应用级事件过滤器只能看到 GUI 线程对象的事件, 定时器来源统计限于 GUI 线程
+    qApp->installEventFilter(this);
+    watchThread(qApp->thread(), QStringLiteral("gui"));
+}
+
+WakeupMonitor::~WakeupMonitor()
+{
+    if (qApp)
+        qApp->removeEventFilter(this);
+    qDeleteAll(m_threads);
+}
+
+void WakeupMonitor::watchThread(QThread *thread, const QString &name)
+{
+    QAbstractEventDispatcher *dispatcher = thread ? QAbstractEventDispatcher::instance(thread) : nullptr;
+    if (!dispatcher)
+        return;
+
+    ThreadCounter *counter = new ThreadCounter;
+    counter->name = name;
+    m_threads.append(counter);
+    // awake 在被监视的线程中发出, 直接连接并用原子计数
+    connect(dispatcher, &QAbstractEventDispatcher::awake, this, [counter]() {
+        counter->wakeups.fetchAndAddRelaxed(1);
+    }, Qt::DirectConnection);
+}
+
+WakeupMonitor::Snapshot WakeupMonitor::snapshot() const
+{
+    Snapshot snapshot;
+    for (const ThreadCounter *counter : m_threads)
+        snapshot.wakeups.insert(counter->name, counter->wakeups.loadRelaxed());
+    snapshot.timerFires = m_timerFires;
+    return snapshot;
+}
+
+void WakeupMonitor::reset()
+{
+    for (ThreadCounter *counter : std::as_const(m_threads))
+        counter->wakeups.storeRelaxed(0);
+    m_timerFires.clear();
+}
+
+QString WakeupMonitor::format(const Snapshot &snapshot)
+{
+    QStringList lines;
+    for (auto it = snapshot.wakeups.cbegin(); it != snapshot.wakeups.cend(); ++it)
+        lines.append(QString("唤醒 %1: %2").arg(it.key()).arg(it.value()));
+    for (auto it = snapshot.timerFires.cbegin(); it != snapshot.timerFires.cend(); ++it)
+        lines.append(QString("定时器 %1: %2").arg(it.key()).arg(it.value()));
+    if (snapshot.timerFires.isEmpty())
+        lines.append(QStringLiteral("定时器: 0"));
+    return lines.join('\n');
+}
+
+WakeupMonitor::Snapshot WakeupMonitor::difference(const Snapshot &now, const Snapshot &since)
+{
+    Snapshot delta;
+    for (auto it = now.wakeups.cbegin(); it != now.wakeups.cend(); ++it)
+        delta.wakeups.insert(it.key(), it.value() - since.wakeups.value(it.key()));
+    for (auto it = now.timerFires.cbegin(); it != now.timerFires.cend(); ++it) {
+        const quint64 count = it.value() - since.timerFires.value(it.key());
+        if (count)
+            delta.timerFires.insert(it.key(), count);
+    }
+    return delta;
+}
+
+bool WakeupMonitor::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Timer) {
+        const QString source = watched->objectName().isEmpty()
+                                   ? QString::fromLatin1(watched->metaObject()->className())
+                                   : watched->objectName();
+        ++m_timerFires[source];
+    }
+    return QObject::eventFilter(watched, event);
+}
@@ -0,0 +1,59 @@
+#ifndef WAKEUPMONITOR_H
+#define WAKEUPMONITOR_H
+
+#include <QAtomicInteger>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+
+class QThread;
+
+/**
+ * 唤醒统计
+ *
+ * 统计各线程事件循环被唤醒的次数(QAbstractEventDispatcher::awake),
+ * 以及 GUI 线程中按来源(对象名, 未命名时为类名)区分的定时器触发次数.
+ * 用于确认空闲时没有周期性唤醒.
+ */
+class WakeupMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Snapshot {
+        // 线程名 -> 唤醒次数
+        QHash<QString, quint64> wakeups;
+        // 定时器来源 -> 触发次数
+        QHash<QString, quint64> timerFires;
+
+        quint64 totalTimerFires() const;
+    };
+
+    explicit WakeupMonitor(QObject *parent = nullptr);
+    ~WakeupMonitor() override;
+
+    // 开始统计指定线程的事件循环唤醒(线程须已启动)
+    void watchThread(QThread *thread, const QString &name);
+
+    Snapshot snapshot() const;
+    void reset();
+
+    // 自 since 之后的增量, 多行文本
+    static QString format(const Snapshot &snapshot);
+    static Snapshot difference(const Snapshot &now, const Snapshot &since);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct ThreadCounter {
+        QString name;
+        QAtomicInteger<quint64> wakeups;
+    };
+
+    QList<ThreadCounter *> m_threads;
+    QHash<QString, quint64> m_timerFires;
+};
+
+#endif // WAKEUPMONITOR_H
@@ -0,0 +1,132 @@
+#include "worldclock.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QDebug>
+#include <QVarLengthArray>
+#include <algorithm>
+#include <cstring>
+#include "timestampformatter.h"
+
+namespace {
+
+constexpr qint64 kNsPerMs = 1000000;
+
+QTimeZone utcZone()
+{
+    return QTimeZone(0);
+}
+
+qint64 yearStartNs(int year)
+{
+    return QDateTime(QDate(year, 1, 1), QTime(0, 0), utcZone()).toMSecsSinceEpoch() * kNsPerMs;
+}
+
+} // namespace
+
+// ---------- ZoneOffsetTable ----------
+
+ZoneOffsetTable::ZoneOffsetTable(const QTimeZone &zone, qint64 fromNs, qint64 toNs) :
+    m_fromNs(fromNs),
+    m_toNs(toNs)
+{
+    const QDateTime from = QDateTime::fromMSecsSinceEpoch(fromNs / kNsPerMs, utcZone());
+    const QDateTime to = QDateTime::fromMSecsSinceEpoch(toNs / kNsPerMs, utcZone());
+
+    m_startsNs.append(fromNs);
+    m_offsets.append(zone.offsetFromUtc(from));
+    if (!zone.hasTransitions())
+        return;
+
+    const QTimeZone::OffsetDataList transitions = zone.transitions(from, to);
+    for (const QTimeZone::OffsetData &transition : transitions) {
+        const qint64 atNs = transition.atUtc.toMSecsSinceEpoch() * kNsPerMs;
+        if (atNs <= m_startsNs.last())
+            continue;
+        m_startsNs.append(atNs);
+        m_offsets.append(transition.offsetFromUtc);
+    }
+}
+
+int ZoneOffsetTable::offsetAt(qint64 ns) const
+{
+    if (m_startsNs.isEmpty())
+        return 0;
+    // 一年通常只有 0~2 个切换点
+    const auto it = std::upper_bound(m_startsNs.cbegin(), m_startsNs.cend(), ns);
+    const int index = it == m_startsNs.cbegin() ? 0 : static_cast<int>(it - m_startsNs.cbegin()) - 1;
+    return m_offsets.at(index);
+}
+
+// ---------- WorldClock ----------
+
+WorldClock::WorldClock(const QStringList &zoneIds)
+{
+    setZones(zoneIds.isEmpty() ? defaultZones() : zoneIds);
+}
+
+void WorldClock::setZones(const QStringList &zoneIds)
+{
+    m_zones.clear();
+    m_labelWidth = 0;
+    for (const QString &id : zoneIds) {
+        const QTimeZone timeZone(id.toUtf8());
+        if (!timeZone.isValid()) {
+            qDebug() << "忽略无效时区:" << id;
+            continue;
+        }
+        m_zones.append({id, id.toUtf8(), timeZone, ZoneOffsetTable()});
+        m_labelWidth = qMax(m_labelWidth, static_cast<int>(m_zones.last().label.size()));
+    }
+    // 置空区间, 下次渲染时按当年重新计算
+    m_fromNs = m_toNs = 0;
+}
+
+QStringList WorldClock::zoneIds() const
+{
+    QStringList ids;
+    for (const Zone &zone : m_zones)
+        ids.append(zone.id);
+    return ids;
+}
+
+QString WorldClock::render(qint64 nsSinceEpoch, const TimestampFormatter &formatter)
+{
+    if (nsSinceEpoch < m_fromNs || nsSinceEpoch >= m_toNs)
+        buildTables(nsSinceEpoch);
+
+    // 每行: 标签 + 两个空格 + 时间 + 换行
+    const int lineLength = m_labelWidth + 2 + formatter.maxLength() + 1;
+    QVarLengthArray<char, 2048> buffer(lineLength * m_zones.size());
+    char *p = buffer.data();
+    for (const Zone &zone : m_zones) {
+        const QByteArray &label = zone.label;
+        std::memcpy(p, label.constData(), static_cast<size_t>(label.size()));
+        std::memset(p + label.size(), ' ', static_cast<size_t>(m_labelWidth - label.size() + 2));
+        p += m_labelWidth + 2;
+        p += formatter.formatTo(p, nsSinceEpoch, zone.table.offsetAt(nsSinceEpoch));
+        *p++ = '\n';
+    }
+    if (p != buffer.data())
+        --p; // 去掉末尾换行
+    return QString::fromUtf8(buffer.data(), p - buffer.data());
+}
+
+QStringList WorldClock::defaultZones()
+{
+    QStringList zones{QStringLiteral("UTC")};
+    const QString local = QString::fromUtf8(QTimeZone::systemTimeZoneId());
+    if (!local.isEmpty() && local != zones.first())
+        zones.append(local);
+    return zones;
+}
+
+void WorldClock::buildTables(qint64 nsSinceEpoch)
+{
+    const int year = QDateTime::fromMSecsSinceEpoch(nsSinceEpoch / kNsPerMs, utcZone()).date().year();
+    // 前后各多留一天, 覆盖所有时区在当地跨年时的时刻
+    m_fromNs = yearStartNs(year) - 86400LL * 1000 * kNsPerMs;
+    m_toNs = yearStartNs(year + 1) + 86400LL * 1000 * kNsPerMs;
+    for (Zone &zone : m_zones)
+        zone.table = ZoneOffsetTable(zone.timeZone, m_fromNs, m_toNs);
+}
@@ -0,0 +1,71 @@
+#ifndef WORLDCLOCK_H
+#define WORLDCLOCK_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTimeZone>
+#include <QVector>
+
+class TimestampFormatter;
+
+/**
+ * 单个时区在一段时间内的 UTC 偏移表
+ *
+ * 构造时一次性向 QTimeZone 取出区间内的全部夏令时切换点,
+ * 之后查询只在几个切换点中二分查找, 不再调用 QTimeZone.
+ */
+class ZoneOffsetTable
+{
+public:
+    ZoneOffsetTable() = default;
+    ZoneOffsetTable(const QTimeZone &zone, qint64 fromNs, qint64 toNs);
+
+    bool covers(qint64 ns) const { return ns >= m_fromNs && ns < m_toNs; }
+    int offsetAt(qint64 ns) const;
+
+private:
+    qint64 m_fromNs = 0;
+    qint64 m_toNs = 0;
+    QVector<qint64> m_startsNs; // 每段偏移的起始时刻, 升序
+    QVector<int> m_offsets;
+};
+
+/**
+ * 世界时钟: 按配置的时区列表同时显示/复制多个时区的时间
+ *
+ * 偏移表在启动时按当年预先计算, 跨年时才重新计算一次.
+ */
+class WorldClock
+{
+public:
+    explicit WorldClock(const QStringList &zoneIds = QStringList());
+
+    void setZones(const QStringList &zoneIds);
+    QStringList zoneIds() const;
+    int zoneCount() const { return m_zones.size(); }
+
+    // 每个时区一行: "<时区>  <时间>", 时间按 formatter 格式化
+    QString render(qint64 nsSinceEpoch, const TimestampFormatter &formatter);
+
+    // 默认时区列表: UTC 与本机时区
+    static QStringList defaultZones();
+
+private:
+    struct Zone {
+        QString id;
+        QByteArray label; // id 的 UTF-8 形式, 渲染时直接拷贝
+        QTimeZone timeZone;
+        ZoneOffsetTable table;
+    };
+
+    void buildTables(qint64 nsSinceEpoch);
+
+    QList<Zone> m_zones;
+    qint64 m_fromNs = 0;
+    qint64 m_toNs = 0;
+    int m_labelWidth = 0;
+};
+
+#endif // WORLDCLOCK_H